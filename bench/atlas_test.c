@@ -0,0 +1,249 @@
+// Checks glyph eviction and compaction of the fontstash atlas. Text is drawn into a small atlas
+// at a new size every few frames, so that the glyphs of older sizes have to be evicted, then the
+// atlas is compacted, once with glyphs waiting for asynchronous rasterization. After every step:
+//  - glyphs in the atlas do not overlap each other or the white rect,
+//  - each glyph holds the same bitmap as the glyph rasterized into an atlas of its own,
+//  - pixels not covered by a glyph are 0, the space of evicted glyphs has been cleared,
+//  - queued jobs point at the current glyph record of their entry.
+//
+//   atlas_test [font.ttf]
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#define FONTSTASH_IMPLEMENTATION
+#include "../nanovg/fontstash.h"
+
+#define ATLAS_SIZE 128
+#define REF_ATLAS_SIZE 1024
+#define SIZE_FRAMES 30 // Frames drawn at each size.
+#define SIZES 10
+#define LETTERS "abcdefghij"
+
+static int atlasFull = 0;
+
+static void countError(void *uptr, int error, int val)
+{
+    (void)uptr;
+    (void)val;
+    if (error == FONS_ATLAS_FULL)
+        atlasFull++;
+}
+
+FONScontext *createStash(int size, const char *path)
+{
+    FONSparams params;
+    memset(&params, 0, sizeof(params));
+    params.width = size;
+    params.height = size;
+    params.flags = FONS_ZERO_TOPLEFT;
+    FONScontext *stash = fonsCreateInternal(&params);
+    if (stash == NULL)
+        return NULL;
+    if (fonsAddFont(stash, "sans", path, 0) == FONS_INVALID)
+    {
+        fonsDeleteInternal(stash);
+        return NULL;
+    }
+    fonsSetFont(stash, 0);
+    return stash;
+}
+
+// Returns 1 if the bitmap of the glyph matches the same glyph rasterized by the reference stash.
+int sameBitmap(FONScontext *stash, FONScontext *ref, const FONSglyph *g)
+{
+    FONSglyph *r = fons__getGlyph(ref, ref->fonts[0], g->codepoint, g->size, g->blur, g->phase,
+                                  FONS_GLYPH_BITMAP_REQUIRED);
+    int w = g->x1 - g->x0, h = g->y1 - g->y0;
+    if (r == NULL || r->x1 - r->x0 != w || r->y1 - r->y0 != h)
+        return 0;
+    for (int y = 0; y < h; ++y)
+    {
+        if (memcmp(&stash->texData[g->x0 + (g->y0 + y) * stash->params.width],
+                   &ref->texData[r->x0 + (r->y0 + y) * ref->params.width], w) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+// Returns the number of problems found in the atlas, each is printed.
+int checkAtlas(FONScontext *stash, FONScontext *ref, const char *when)
+{
+    int width = stash->params.width, height = stash->params.height;
+    unsigned char *covered = calloc(width * height, 1);
+    int problems = 0;
+
+    if (covered == NULL)
+        return 1;
+    // The white rect.
+    for (int y = 0; y < 2; ++y)
+        covered[y * width] = covered[y * width + 1] = 1;
+
+    for (int i = 0; i < stash->nentries; ++i)
+    {
+        FONSatlasEntry *e = &stash->entries[i];
+        FONSglyph *g = e->glyph;
+        if (g == NULL)
+            continue;
+        int w = g->x1 - g->x0, h = g->y1 - g->y0;
+        if (g->entry != i || g->x0 != e->x || g->y0 != e->y)
+        {
+            printf("%s: glyph %u of entry %d is not at its entry\n", when, g->codepoint, i);
+            problems++;
+            continue;
+        }
+        if (e->x < 0 || e->y < 0 || e->x + w > width || e->y + h > height)
+        {
+            printf("%s: glyph %u is outside the atlas\n", when, g->codepoint);
+            problems++;
+            continue;
+        }
+        int overlaps = 0;
+        for (int y = e->y; y < e->y + h; ++y)
+        {
+            for (int x = e->x; x < e->x + w; ++x)
+            {
+                overlaps += covered[x + y * width];
+                covered[x + y * width] = 1;
+            }
+        }
+        if (overlaps > 0)
+        {
+            printf("%s: glyph %u size %d overlaps %d pixels of other glyphs\n", when, g->codepoint, g->size, overlaps);
+            problems++;
+        }
+        if (!g->pending && !sameBitmap(stash, ref, g))
+        {
+            printf("%s: glyph %u size %d does not hold its bitmap\n", when, g->codepoint, g->size);
+            problems++;
+        }
+    }
+
+    int dirty = 0;
+    for (int i = 0; i < width * height; ++i)
+        dirty += !covered[i] && stash->texData[i] != 0;
+    if (dirty > 0)
+    {
+        printf("%s: %d pixels outside the glyphs are not cleared\n", when, dirty);
+        problems++;
+    }
+    free(covered);
+
+    for (int i = 0; i < stash->njobs; ++i)
+    {
+        FONSglyph *g = stash->jobs[i]->glyph;
+        if (g != NULL && (g->entry < 0 || stash->entries[g->entry].glyph != g || !g->pending))
+        {
+            printf("%s: queued glyph %u does not point at the glyph of its entry\n", when, g->codepoint);
+            problems++;
+        }
+    }
+    return problems;
+}
+
+int sizeOf(int step)
+{
+    return 8 + step * 2;
+}
+
+int main(int argc, char **argv)
+{
+    int failed = 0;
+    char when[64];
+
+    if (argc < 2)
+    {
+        printf("atlas: skipped, no font\n");
+        return 0;
+    }
+    FONScontext *stash = createStash(ATLAS_SIZE, argv[1]);
+    FONScontext *ref = createStash(REF_ATLAS_SIZE, argv[1]);
+    if (stash == NULL || ref == NULL)
+    {
+        printf("Could not load %s.\n", argv[1]);
+        return 2;
+    }
+    fonsSetErrorCallback(stash, countError, NULL);
+
+    // Eviction, every SIZE_FRAMES frames the letters are drawn at a new size.
+    int frame = 0;
+    for (int step = 0; step < SIZES; ++step)
+    {
+        fonsSetSize(stash, sizeOf(step));
+        for (int f = 0; f < SIZE_FRAMES; ++f, ++frame)
+        {
+            fonsDrawText(stash, 10.0, 50.0, LETTERS, NULL);
+            fonsEndFrame(stash);
+            snprintf(when, sizeof(when), "frame %d", frame);
+            failed |= checkAtlas(stash, ref, when) != 0;
+        }
+    }
+    int live = 0;
+    for (int i = 0; i < stash->nentries; ++i)
+        live += stash->entries[i].glyph != NULL;
+    printf("eviction: %d of %d glyphs left in the atlas, compacted in frame %d\n", live, SIZES * (int)strlen(LETTERS),
+           stash->compactFrame);
+    if (live >= SIZES * (int)strlen(LETTERS))
+    {
+        printf("eviction: all %d glyphs are still in the atlas, it is too large for the test\n", live);
+        failed = 1;
+    }
+    if (atlasFull > 0)
+    {
+        printf("eviction: the atlas was reported full %d times\n", atlasFull);
+        failed = 1;
+    }
+
+    // Compaction keeps the glyphs drawn last.
+    fonsCompactAtlas(stash, ATLAS_SIZE, ATLAS_SIZE);
+    failed |= checkAtlas(stash, ref, "compacted") != 0;
+    for (const char *c = LETTERS; *c != '\0'; ++c)
+    {
+        FONSglyph *g = fons__findGlyph(stash->fonts[0], *c, sizeOf(SIZES - 1) * 10, 0, 0);
+        if (g == NULL || g->entry == -1)
+        {
+            printf("compacted: glyph %c of the last size was evicted\n", *c);
+            failed = 1;
+        }
+    }
+
+    // Compaction with queued glyphs moves their rects, the jobs have to follow.
+    fonsSetAsyncGlyphs(stash, 1);
+    fonsSetSize(stash, sizeOf(SIZES));
+    fonsDrawText(stash, 10.0, 50.0, LETTERS, NULL);
+    int queued = stash->njobs;
+    short *was = malloc(sizeof(short) * 2 * (queued > 0 ? queued : 1));
+    for (int i = 0; i < queued; ++i)
+    {
+        was[i * 2] = stash->jobs[i]->glyph->x0;
+        was[i * 2 + 1] = stash->jobs[i]->glyph->y0;
+    }
+    fonsCompactAtlas(stash, ATLAS_SIZE, ATLAS_SIZE);
+    failed |= checkAtlas(stash, ref, "compacted with queued glyphs") != 0;
+    int moved = 0;
+    for (int i = 0; i < stash->njobs && i < queued; ++i)
+    {
+        const FONSglyph *g = stash->jobs[i]->glyph;
+        moved += g != NULL && (g->x0 != was[i * 2] || g->y0 != was[i * 2 + 1]);
+    }
+    free(was);
+    if (queued == 0 || moved == 0)
+    {
+        printf("async: %d glyphs queued, %d moved by compaction, the test needs both\n", queued, moved);
+        failed = 1;
+    }
+    int dirty[4];
+    fonsRasterizeGlyphs(stash, 0);
+    fonsValidateTexture(stash, dirty);
+    if (stash->njobs != 0)
+    {
+        printf("async: %d glyphs did not land\n", stash->njobs);
+        failed = 1;
+    }
+    failed |= checkAtlas(stash, ref, "landed") != 0;
+
+    fonsDeleteInternal(stash);
+    fonsDeleteInternal(ref);
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
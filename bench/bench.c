@@ -0,0 +1,313 @@
+// Draws the scenes of scenes.h through the GL3 back-end with the recording GL stub
+// and prints one report of GL work per scene, measured on a steady frame.
+// Every scene is drawn once per configuration of creation flags, so that each
+// optional path of the back-end has a baseline of its own.
+//
+//   bench [-font file.ttf] [-frames n] [-config name] [-compare baseline.json]
+//
+// Without -compare the reports are written to stdout, which is how baseline.json is
+// made. With -compare every counter is checked against the baseline, and the exit
+// status is 1 if one of them grew, or dropped for counters of saved work like
+// mergedCalls or culledFills. CPU time per frame goes to stderr, it is not compared.
+
+#include <time.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glcorearb.h>
+#endif
+#include "../nanovg/nanovg.h"
+#define NANOVG_GL_RECORD
+#define NANOVG_GL3_IMPLEMENTATION
+#include "../nanovg/nanovg_gl.h"
+#include "scenes.h"
+
+#define WARMUP_FRAMES 4
+
+enum
+{
+    SCENE_FLOCK,
+    SCENE_EDGES,
+    SCENE_TEXT,
+    SCENE_SHAPES,
+    SCENE_OFFSCREEN,
+    SCENE_CORPUS,
+    SCENE_COUNT
+};
+
+static const char *sceneNames[SCENE_COUNT] = {"flock", "edges", "text", "shapes", "offscreen", "corpus"};
+
+typedef struct
+{
+    const char *name;
+    int flags;
+} config;
+
+// "default" is how the demo creates its context, "merge" leaves out stencil strokes
+// so that the call merging applies, and "all" turns on every optional path at once.
+static const config configs[] = {
+    {"default", NVG_ANTIALIAS | NVG_STENCIL_STROKES},
+    {"merge", NVG_ANTIALIAS},
+    {"ring", NVG_ANTIALIAS | NVG_STENCIL_STROKES | NVG_RING_BUFFERS},
+    {"triangulate", NVG_ANTIALIAS | NVG_TRIANGULATE_FILLS},
+    {"atlas", NVG_ANTIALIAS | NVG_STENCIL_STROKES | NVG_IMAGE_ATLAS},
+    {"variants", NVG_ANTIALIAS | NVG_STENCIL_STROKES | NVG_SHADER_VARIANTS},
+    {"async", NVG_ANTIALIAS | NVG_STENCIL_STROKES | NVG_ASYNC_UPLOADS},
+    {"all", NVG_ANTIALIAS | NVG_RING_BUFFERS | NVG_TRIANGULATE_FILLS | NVG_IMAGE_ATLAS | NVG_SHADER_VARIANTS |
+                NVG_ASYNC_UPLOADS},
+};
+
+#define CONFIG_COUNT (int)(sizeof(configs) / sizeof(configs[0]))
+
+void drawScene(NVGcontext *vg, scene *s, int *images, int which, int frame)
+{
+    float t = frame * 0.016;
+    nvgBeginFrame(vg, s->view.x, s->view.y, 1.0);
+    if (which == SCENE_FLOCK)
+        flockScene(vg, s, t);
+    else if (which == SCENE_EDGES)
+        edgesScene(vg, s);
+    else if (which == SCENE_TEXT)
+        textScene(vg, s);
+    else if (which == SCENE_OFFSCREEN)
+        offscreenScene(vg, s, t);
+    else if (which == SCENE_CORPUS)
+        corpusScene(vg, s, frame);
+    else
+    {
+        updateShapeImages(vg, images, frame);
+        shapesScene(vg, s, images, t);
+    }
+    nvgEndFrame(vg);
+}
+
+char *readFile(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return NULL;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *data = malloc(size + 1);
+    if (data != NULL)
+    {
+        size = fread(data, 1, size, fp);
+        data[size] = '\0';
+    }
+    fclose(fp);
+    return data;
+}
+
+// Copies the line of the baseline holding the report named name, returns 0 if there is none.
+int findBaseline(const char *baseline, const char *name, char *line, int size)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"name\": \"%s\"", name);
+    const char *p = strstr(baseline, pattern);
+    if (p == NULL)
+        return 0;
+    while (p > baseline && p[-1] != '\n')
+        p--;
+    int n = 0;
+    while (p[n] != '\0' && p[n] != '\n' && n < size - 1)
+    {
+        line[n] = p[n];
+        n++;
+    }
+    line[n] = '\0';
+    return 1;
+}
+
+// Counters of work saved, for which a drop is the regression.
+static const char *savedCounters[] = {"\"mergedCalls\":", "\"culledFills\":", "\"culledStrokes\":"};
+
+int isSavedCounter(const char *pattern)
+{
+    for (int i = 0; i < (int)(sizeof(savedCounters) / sizeof(savedCounters[0])); ++i)
+    {
+        if (strcmp(pattern, savedCounters[i]) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+// Compares every counter of the report with the baseline, returns the number of counters which got worse.
+int compareReport(const char *name, const char *report, const char *baseline)
+{
+    char pattern[64];
+    int regressions = 0;
+    const char *p = report;
+    while ((p = strchr(p, '"')) != NULL)
+    {
+        const char *end = strchr(p + 1, '"');
+        if (end == NULL)
+            break;
+        const char *key = p;
+        int len = (int)(end - key) + 1;
+        snprintf(pattern, sizeof(pattern), "%.*s:", len, key);
+        p = end + 1;
+        // Skips string values and the name.
+        if (*p != ':' || strcmp(pattern, "\"name\":") == 0)
+            continue;
+        long long now = strtoll(p + 1, NULL, 10);
+        const char *b = strstr(baseline, pattern);
+        if (b == NULL)
+        {
+            printf("%s: %.*s missing from the baseline\n", name, len, key);
+            regressions++;
+            continue;
+        }
+        long long was = strtoll(b + strlen(pattern), NULL, 10);
+        int saved = isSavedCounter(pattern);
+        if (now > was)
+        {
+            printf("%s: %.*s grew from %lld to %lld%s\n", name, len, key, was, now, saved ? ", update the baseline" : "");
+            regressions += !saved;
+        }
+        else if (now < was)
+        {
+            printf("%s: %.*s dropped from %lld to %lld%s\n", name, len, key, was, now, saved ? "" : ", update the baseline");
+            regressions += saved;
+        }
+    }
+    return regressions;
+}
+
+// Draws every scene with one configuration, returns the number of regressions or -1 on error.
+int benchConfig(const config *c, const char *fontPath, int frames, const char *baseline)
+{
+    int regressions = 0;
+    int images[SHAPE_IMAGES];
+    char name[64];
+    char report[1024];
+    char line[1024];
+    scene s;
+
+    NVGcontext *vg = nvgCreateGL3(c->flags);
+    if (vg == NULL)
+    {
+        printf("%s: could not init nanovg.\n", c->name);
+        return -1;
+    }
+    int hasFont = fontPath != NULL && nvgCreateFont(vg, "sans", fontPath) != -1;
+    if (fontPath != NULL && !hasFont)
+        fprintf(stderr, "Could not load %s.\n", fontPath);
+    createShapeImages(vg, images);
+
+    initScene(&s);
+    // Far enough out to see all four edges of the world.
+    sceneCamera(&s, new_vec2(-50.0, -50.0), 1.8);
+
+    for (int which = 0; which < SCENE_COUNT; ++which)
+    {
+        snprintf(name, sizeof(name), "%s/%s", c->name, sceneNames[which]);
+        if ((which == SCENE_TEXT || which == SCENE_CORPUS) && !hasFont)
+        {
+            fprintf(stderr, "%s: skipped, no font\n", name);
+            continue;
+        }
+
+        for (int f = 0; f < WARMUP_FRAMES; ++f)
+            drawScene(vg, &s, images, which, f);
+        nvgglRecordReset();
+        drawScene(vg, &s, images, which, WARMUP_FRAMES);
+        int n = nvgglRecordReport(report, sizeof(report), name);
+        // The culling happens in front of the back-end, its counters are added to the report.
+        int culledFills, culledStrokes;
+        nvgCulledCount(vg, &culledFills, &culledStrokes);
+        snprintf(report + n - 1, sizeof(report) - (n - 1), ", \"culledFills\": %d, \"culledStrokes\": %d}",
+                 culledFills, culledStrokes);
+
+        clock_t start = clock();
+        for (int f = 0; f < frames; ++f)
+            drawScene(vg, &s, images, which, WARMUP_FRAMES + 1 + f);
+        double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+        fprintf(stderr, "%s: %.4f ms/frame\n", name, frames > 0 ? elapsed * 1000.0 / frames : 0.0);
+
+        if (baseline == NULL)
+        {
+            printf("%s\n", report);
+        }
+        else if (!findBaseline(baseline, name, line, sizeof(line)))
+        {
+            printf("%s: missing from the baseline\n", name);
+            regressions++;
+        }
+        else
+        {
+            regressions += compareReport(name, report, line);
+        }
+    }
+
+    for (int i = 0; i < SHAPE_IMAGES; ++i)
+        nvgDeleteImage(vg, images[i]);
+    nvgDeleteGL3(vg);
+    return regressions;
+}
+
+int main(int argc, char **argv)
+{
+    const char *fontPath = NULL;
+    const char *comparePath = NULL;
+    const char *configName = NULL;
+    char *baseline = NULL;
+    int frames = 100;
+    int regressions = 0;
+    int found = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-font") == 0 && i + 1 < argc)
+            fontPath = argv[++i];
+        else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-config") == 0 && i + 1 < argc)
+            configName = argv[++i];
+        else if (strcmp(argv[i], "-compare") == 0 && i + 1 < argc)
+            comparePath = argv[++i];
+        else
+        {
+            printf("usage: %s [-font file.ttf] [-frames n] [-config name] [-compare baseline.json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (comparePath != NULL)
+    {
+        baseline = readFile(comparePath);
+        if (baseline == NULL)
+        {
+            printf("Could not read %s.\n", comparePath);
+            return 2;
+        }
+    }
+
+    for (int i = 0; i < CONFIG_COUNT; ++i)
+    {
+        if (configName != NULL && strcmp(configName, configs[i].name) != 0)
+            continue;
+        found = 1;
+        int n = benchConfig(&configs[i], fontPath, frames, baseline);
+        if (n < 0)
+        {
+            free(baseline);
+            return 2;
+        }
+        regressions += n;
+    }
+    free(baseline);
+
+    if (!found)
+    {
+        printf("Unknown configuration %s.\n", configName);
+        return 2;
+    }
+    if (comparePath != NULL)
+        printf("%s\n", regressions == 0 ? "OK" : "FAILED");
+    return regressions == 0 ? 0 : 1;
+}
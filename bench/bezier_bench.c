@@ -0,0 +1,151 @@
+// Flattens random cubic beziers at several tolerances and prints, per tolerance, the
+// segments per curve, the largest distance between a curve and its segments, and the
+// time per curve. nanovg.c is included to call the flattener directly, without the
+// rest of the path pipeline. Built with -DNVG_NO_SIMD it measures the plain C flattener.
+//
+//   bezier_bench [-curves n] [-repeat n]
+//
+// The exit status is 1 if a curve is further than the tolerance from its segments.
+// Time goes to stderr, it depends on the machine.
+
+#include <time.h>
+#include "../nanovg/nanovg.c"
+#include "null_backend.h"
+
+#define SAMPLES 256
+
+typedef struct
+{
+    float p[8];
+} cubic;
+
+unsigned int rnd(unsigned int *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+// Random control points in squares of 20, 200 and 800 pixels, a third of the curves each.
+void randomCubics(cubic *curves, int n)
+{
+    static const float scales[3] = {20.0, 200.0, 800.0};
+    unsigned int seed = 1;
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = 0; j < 8; ++j)
+            curves[i].p[j] = (rnd(&seed) / 16777216.0f) * scales[i % 3];
+    }
+}
+
+void flatten(NVGcontext *ctx, const cubic *c)
+{
+    const float *p = c->p;
+    ctx->cache->npoints = 0;
+    ctx->cache->npaths = 0;
+    nvg__addPath(ctx);
+    nvg__addPoint(ctx, p[0], p[1], NVG_PT_CORNER);
+    nvg__flattenBezier(ctx, p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], NVG_PT_CORNER);
+}
+
+float segmentDistance(float px, float py, const NVGpoint *a, const NVGpoint *b)
+{
+    float dx = b->x - a->x, dy = b->y - a->y;
+    float d = dx * dx + dy * dy, t = 0.0;
+    if (d > 0.0)
+        t = nvg__clampf(((px - a->x) * dx + (py - a->y) * dy) / d, 0.0, 1.0);
+    dx = a->x + t * dx - px;
+    dy = a->y + t * dy - py;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+// Largest distance from points sampled on the curve to the flattened points of the cache.
+float deviation(NVGcontext *ctx, const cubic *c)
+{
+    const float *p = c->p;
+    const NVGpoint *pts = ctx->cache->points;
+    int n = ctx->cache->npoints;
+    float worst = 0.0;
+    for (int k = 0; k <= SAMPLES; ++k)
+    {
+        float t = (float)k / SAMPLES, u = 1.0 - t;
+        float x = u * u * u * p[0] + 3 * u * u * t * p[2] + 3 * u * t * t * p[4] + t * t * t * p[6];
+        float y = u * u * u * p[1] + 3 * u * u * t * p[3] + 3 * u * t * t * p[5] + t * t * t * p[7];
+        float d = 1e9;
+        for (int i = 0; i + 1 < n; ++i)
+            d = nvg__minf(d, segmentDistance(x, y, &pts[i], &pts[i + 1]));
+        worst = nvg__maxf(worst, d);
+    }
+    return worst;
+}
+
+int main(int argc, char **argv)
+{
+    static const float ratios[] = {0.5, 1.0, 2.0, 4.0};
+    int ncurves = 3000;
+    int repeat = 20;
+    int failed = 0;
+    NVGparams params;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-curves") == 0 && i + 1 < argc)
+            ncurves = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-repeat") == 0 && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else
+        {
+            printf("usage: %s [-curves n] [-repeat n]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    initNullParams(&params);
+    NVGcontext *ctx = nvgCreateInternal(&params);
+    cubic *curves = malloc(sizeof(cubic) * ncurves);
+    if (ctx == NULL || curves == NULL)
+    {
+        printf("Could not init nanovg.\n");
+        return 2;
+    }
+    randomCubics(curves, ncurves);
+
+#ifdef NVG_SSE2
+    printf("bezier: SSE2\n");
+#else
+    printf("bezier: plain C\n");
+#endif
+    for (int r = 0; r < (int)(sizeof(ratios) / sizeof(ratios[0])); ++r)
+    {
+        long long segments = 0;
+        float worst = 0.0;
+        nvg__setDevicePixelRatio(ctx, ratios[r]);
+
+        clock_t start = clock();
+        for (int k = 0; k < repeat; ++k)
+        {
+            for (int i = 0; i < ncurves; ++i)
+                flatten(ctx, &curves[i]);
+        }
+        double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        for (int i = 0; i < ncurves; ++i)
+        {
+            flatten(ctx, &curves[i]);
+            segments += ctx->cache->npoints - 1;
+            worst = nvg__maxf(worst, deviation(ctx, &curves[i]));
+        }
+        // A little slack for the rounding of the sampled curve.
+        int ok = worst <= ctx->tessTol * 1.01f;
+        printf("tolerance %.4f: %.1f segments/curve, max deviation %.4f px%s\n", ctx->tessTol,
+               (double)segments / ncurves, worst, ok ? "" : ", too far");
+        fprintf(stderr, "tolerance %.4f: %.1f ns/curve\n", ctx->tessTol,
+                repeat > 0 ? elapsed * 1e9 / ((double)repeat * ncurves) : 0.0);
+        if (!ok)
+            failed = 1;
+    }
+
+    free(curves);
+    nvgDeleteInternal(ctx);
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
@@ -0,0 +1,165 @@
+// Checks and measures the glyph blur of fontstash, nvgFontBlur(). The blur of fons__blur() is
+// compared with the plain C row and column passes on random rects, sizes and strides, at every
+// radius from 1 to 20, the cap of fontstash. They have to match bit for bit, and the pixels
+// around the rect must be left alone. Then the time per pixel of both, at every radius on a
+// glyph sized rect, goes to stderr. Built with -DFONS_NO_SIMD both are the plain C passes.
+//
+//   blur_bench [-cases n] [-repeat n]
+//
+// fontstash.h is included to call the passes directly.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#define FONTSTASH_IMPLEMENTATION
+#include "../nanovg/fontstash.h"
+
+#define MAX_RADIUS 20
+#define MAX_SIZE 160
+#define MAX_PAD 16
+#define BENCH_W 48 // A 32px glyph with its blur padding.
+#define BENCH_H 56
+
+unsigned int rnd(unsigned int *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+// The four plain C passes of fons__blur().
+void scalarBlur(unsigned char *dst, int w, int h, int stride, int blur)
+{
+    float sigma = (float)blur * 0.57735f;
+    int alpha = (int)((1 << APREC) * (1.0f - expf(-2.3f / (sigma + 1.0f))));
+    fons__blurRows(dst, w, h, stride, alpha);
+    fons__blurCols(dst, w, h, stride, alpha);
+    fons__blurRows(dst, w, h, stride, alpha);
+    fons__blurCols(dst, w, h, stride, alpha);
+}
+
+// Glyph-like content: empty with solid strokes and a few pixels of noise, or noise only.
+void fillRect(unsigned char *p, int w, int h, int stride, unsigned int *seed)
+{
+    int noise = rnd(seed) % 4 == 0;
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            unsigned int r = rnd(seed);
+            if (noise)
+                p[x + y * stride] = r & 255;
+            else
+                p[x + y * stride] = (x / 5 + y / 7) % 3 == 0 ? 255 : (r % 16 == 0 ? r & 255 : 0);
+        }
+    }
+}
+
+// Returns the number of cases which differ from the plain C passes or write outside their rect.
+int checkBlur(int cases)
+{
+    int size = (MAX_SIZE + MAX_PAD) * (MAX_SIZE + 2);
+    unsigned char *a = malloc(size);
+    unsigned char *b = malloc(size);
+    unsigned int seed = 5;
+    int mismatches = 0;
+
+    if (a == NULL || b == NULL)
+        return cases;
+    for (int i = 0; i < cases; ++i)
+    {
+        int blur = 1 + i % MAX_RADIUS;
+        int w = 1 + rnd(&seed) % MAX_SIZE;
+        int h = 1 + rnd(&seed) % MAX_SIZE;
+        int stride = w + rnd(&seed) % MAX_PAD;
+        // The rect starts on the second row, at an odd offset, so that nothing is aligned.
+        int offset = stride + rnd(&seed) % (stride - w + 1);
+        memset(a, 0x5a, size);
+        fillRect(a + offset, w, h, stride, &seed);
+        memcpy(b, a, size);
+
+        fons__blur(NULL, a + offset, w, h, stride, blur);
+        scalarBlur(b + offset, w, h, stride, blur);
+        if (memcmp(a, b, size) != 0)
+        {
+            if (mismatches < 10)
+                printf("radius %d, %dx%d stride %d: differs from the plain C blur\n", blur, w, h, stride);
+            mismatches++;
+        }
+        for (int k = 0; k < size; ++k)
+        {
+            int inside = k >= offset && (k - offset) / stride < h && (k - offset) % stride < w;
+            if (!inside && a[k] != 0x5a)
+            {
+                printf("radius %d, %dx%d stride %d: pixels outside the rect changed\n", blur, w, h, stride);
+                mismatches++;
+                break;
+            }
+        }
+    }
+    free(a);
+    free(b);
+    return mismatches;
+}
+
+// Time per pixel of fons__blur() and of the plain C passes at every radius.
+void timeBlur(int repeat)
+{
+    unsigned char src[BENCH_W * BENCH_H];
+    unsigned char dst[BENCH_W * BENCH_H];
+    unsigned int seed = 9;
+
+    fillRect(src, BENCH_W, BENCH_H, BENCH_W, &seed);
+    for (int blur = 1; blur <= MAX_RADIUS; ++blur)
+    {
+        clock_t start = clock();
+        for (int r = 0; r < repeat; ++r)
+        {
+            memcpy(dst, src, sizeof(dst));
+            fons__blur(NULL, dst, BENCH_W, BENCH_H, BENCH_W, blur);
+        }
+        double fast = (double)(clock() - start) / CLOCKS_PER_SEC;
+        start = clock();
+        for (int r = 0; r < repeat; ++r)
+        {
+            memcpy(dst, src, sizeof(dst));
+            scalarBlur(dst, BENCH_W, BENCH_H, BENCH_W, blur);
+        }
+        double plain = (double)(clock() - start) / CLOCKS_PER_SEC;
+        double pixels = (double)repeat * BENCH_W * BENCH_H;
+        fprintf(stderr, "radius %2d: %.2f ns/pixel, plain C %.2f ns/pixel\n", blur, fast * 1e9 / pixels,
+                plain * 1e9 / pixels);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int cases = 4000;
+    int repeat = 2000;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-cases") == 0 && i + 1 < argc)
+            cases = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-repeat") == 0 && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else
+        {
+            printf("usage: %s [-cases n] [-repeat n]\n", argv[0]);
+            return 2;
+        }
+    }
+
+#ifdef FONS_SSE2
+    printf("blur: SSE2\n");
+#else
+    printf("blur: plain C\n");
+#endif
+    int mismatches = checkBlur(cases);
+    printf("%d cases, radius 1 to %d: %d differ\n", cases, MAX_RADIUS, mismatches);
+    if (repeat > 0)
+        timeBlur(repeat);
+
+    printf("%s\n", mismatches == 0 ? "OK" : "FAILED");
+    return mismatches == 0 ? 0 : 1;
+}
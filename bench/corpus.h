@@ -0,0 +1,82 @@
+#pragma once
+
+// A text corpus for the text benchmarks, the same on every run. English-like words, many of them
+// with kerning pairs, in paragraphs of a few lines. With mixed set it also has every new line
+// nanovg breaks rows at, \n, \r\n, \n\r, \r and NEL, runs of CJK and words too long for a row.
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CORPUS_SIZE 100000
+
+static const char *corpusWords[] = {
+    "AVATAR", "Toward", "WAVE",    "Yellow",  "flock", "birds",  "Tower",  "VAT",     "LT",     "Wave",
+    "to",     "the",    "of",      "and",     "a",     "in",     "Away",   "Tyrant",  "Very",   "P.",
+    "Fly",    "ever",   "AWAY",    "Yoke",    "water", "river",  "Valley", "forward", "LAVA",   "Typ",
+    "over",   "Avoid",  "Wolf",    "kerning", "pairs", "TAV",    "Yo",     "we",      "were",   "feather",
+    "Today",  "Voyage", "average", "To",      "Vo",    "Wa",     "Ty",     "F.",      "quickly", "eye",
+};
+
+static const char *corpusNewlines[] = {"\n", "\r\n", "\n\r", "\r", "\xc2\x85"};
+
+// Each is three bytes in UTF-8.
+static const char *corpusCJK[] = {"\xe9\xb3\xa5", "\xe7\xbe\xa4", "\xe9\xa3\x9b", "\xe7\xa9\xba", "\xe6\xa3\xae",
+                                  "\xe6\xb0\xb4", "\xe5\xb1\xb1", "\xe6\x9c\xa8"};
+
+static unsigned int corpusRnd(unsigned int *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+static void corpusAppend(char *text, int *n, const char *s)
+{
+    int len = strlen(s);
+    memcpy(text + *n, s, len);
+    *n += len;
+}
+
+// Returns a corpus of about size bytes, to be freed, or NULL if out of memory.
+char *createCorpus(int size, int mixed)
+{
+    int nwords = sizeof(corpusWords) / sizeof(corpusWords[0]);
+    unsigned int seed = 1;
+    int n = 0, words = 0;
+    // The last word may go past size.
+    char *text = malloc(size + 512);
+    if (text == NULL)
+        return NULL;
+
+    while (n < size)
+    {
+        unsigned int r = corpusRnd(&seed);
+        if (mixed && r % 89 == 0)
+        {
+            int len = 60 + r % 200;
+            for (int i = 0; i < len; ++i)
+                text[n++] = "Wavelength"[i % 10];
+        }
+        else if (mixed && r % 23 == 0)
+        {
+            int len = 3 + r % 30;
+            for (int i = 0; i < len; ++i)
+                corpusAppend(text, &n, corpusCJK[corpusRnd(&seed) % 8]);
+        }
+        else
+            corpusAppend(text, &n, corpusWords[r % nwords]);
+
+        ++words;
+        r = corpusRnd(&seed);
+        if (r % 11 == 0)
+        {
+            corpusAppend(text, &n, mixed ? corpusNewlines[r % 5] : "\n");
+            // An empty line between paragraphs.
+            if (r % 3 == 0)
+                corpusAppend(text, &n, mixed ? corpusNewlines[(r / 5) % 5] : "\n");
+        }
+        else
+            corpusAppend(text, &n, r % 7 == 0 ? ", " : " ");
+    }
+    text[n] = '\0';
+    return text;
+}
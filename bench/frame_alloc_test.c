@@ -0,0 +1,69 @@
+// Checks that a steady frame does no heap allocations in nanovg.
+// The scenes of scenes.h are drawn through a back-end which drops everything,
+// after a few warm-up frames the frame arena has to hold the whole frame.
+//
+//   frame_alloc_test [font.ttf]
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "scenes.h"
+#include "null_backend.h"
+
+#define WARMUP_FRAMES 4
+#define STEADY_FRAMES 8
+
+NVGcontext *createNull()
+{
+    NVGparams params;
+    initNullParams(&params);
+    params.edgeAntiAlias = 1;
+    return nvgCreateInternal(&params);
+}
+
+void drawFrame(NVGcontext *vg, scene *s, int hasFont, float t)
+{
+    nvgBeginFrame(vg, s->view.x, s->view.y, 1.0);
+    flockScene(vg, s, t);
+    edgesScene(vg, s);
+    if (hasFont)
+        textScene(vg, s);
+    nvgEndFrame(vg);
+}
+
+int main(int argc, char **argv)
+{
+    int failed = 0;
+    scene s;
+
+    NVGcontext *vg = createNull();
+    if (vg == NULL)
+    {
+        printf("Could not init nanovg.\n");
+        return 2;
+    }
+    int hasFont = argc > 1 && nvgCreateFont(vg, "sans", argv[1]) != -1;
+    if (!hasFont)
+        fprintf(stderr, "text: skipped, no font\n");
+
+    initScene(&s);
+    sceneCamera(&s, new_vec2(-50.0, -50.0), 1.8);
+
+    for (int f = 0; f < WARMUP_FRAMES; ++f)
+        drawFrame(vg, &s, hasFont, f * 0.016);
+    for (int f = 0; f < STEADY_FRAMES; ++f)
+    {
+        drawFrame(vg, &s, hasFont, (WARMUP_FRAMES + f) * 0.016);
+        int allocs = nvgFrameAllocCount(vg);
+        if (allocs != 0)
+        {
+            printf("frame %d: %d heap allocations, expected 0\n", WARMUP_FRAMES + f, allocs);
+            failed = 1;
+        }
+    }
+
+    nvgDeleteInternal(vg);
+
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
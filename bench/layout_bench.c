@@ -0,0 +1,353 @@
+// Checks and measures text layouts, nvgCreateTextLayout(), on a 100KB corpus with every kind of
+// new line, CJK and words too long for a row. At break widths from 7 to 1000 pixels:
+//  - the rows of a layout are the rows of one nvgTextBreakLines() pass over the whole text,
+//  - appending random pieces gives the rows of a layout given the whole text at once,
+//  - layout bounds match nvgTextBoxBounds() and drawing a layout emits the vertices of
+//    nvgTextBox(), for left, center and right aligned text.
+// Then the time per frame goes to stderr for the bounds and for drawing, of every row and of
+// a 40 row panel, against nvgTextBoxBounds() and nvgTextBox(), and for a log panel which gets
+// a line appended every frame and draws its last 40 rows.
+//
+//   layout_bench [font.ttf] [-frames n]
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "null_backend.h"
+#include "corpus.h"
+
+#define APPEND_SIZE 10000 // Text appended in pieces, every step is checked against a new layout.
+#define PANEL_ROWS 40
+#define LOG_LINES 2000
+
+static unsigned int vertexHash = 2166136261u;
+static int vertexCount = 0;
+
+// Hashes the positions only, texture coordinates change when the atlas grows.
+static void hashTriangles(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                          NVGscissor *scissor, const NVGvertex *verts, int nverts, float fringe)
+{
+    NVG_NOTUSED(uptr);
+    NVG_NOTUSED(paint);
+    NVG_NOTUSED(compositeOperation);
+    NVG_NOTUSED(scissor);
+    NVG_NOTUSED(fringe);
+    for (int i = 0; i < nverts; ++i)
+    {
+        const unsigned char *p = (const unsigned char *)&verts[i];
+        for (int k = 0; k < (int)(2 * sizeof(float)); ++k)
+            vertexHash = (vertexHash ^ p[k]) * 16777619u;
+    }
+    vertexCount += nverts;
+}
+
+int sameRow(const NVGtextRow *a, const char *atext, const NVGtextRow *b, const char *btext)
+{
+    return a->start - atext == b->start - btext && a->end - atext == b->end - btext &&
+           a->next - atext == b->next - btext && a->width == b->width && a->minx == b->minx && a->maxx == b->maxx;
+}
+
+// Layouts keep a copy of the text, rows are compared by their offset into it.
+const char *layoutText(NVGcontext *vg, NVGtextLayout *layout)
+{
+    NVGtextRow row;
+    if (nvgTextLayoutRows(vg, layout, 0, &row, 1) == 0)
+        return NULL;
+    return row.start;
+}
+
+// Returns 1 if the rows of the layout are the rows nvgTextBreakLines() gives for text.
+int checkRows(NVGcontext *vg, NVGtextLayout *layout, const char *text, int length, float width, NVGtextRow *rows,
+              int maxRows, const char *when)
+{
+    NVGtextRow row;
+    int nrows = nvgTextBreakLines(vg, text, text + length, width, rows, maxRows);
+    int lrows = nvgTextLayoutRowCount(vg, layout);
+    const char *ltext = layoutText(vg, layout);
+    if (nrows == maxRows)
+    {
+        printf("%s: more than %d rows\n", when, maxRows);
+        return 0;
+    }
+    if (lrows != nrows)
+    {
+        printf("%s: %d rows, nvgTextBreakLines() gives %d\n", when, lrows, nrows);
+        return 0;
+    }
+    for (int i = 0; i < nrows; ++i)
+    {
+        nvgTextLayoutRows(vg, layout, i, &row, 1);
+        if (!sameRow(&row, ltext, &rows[i], text))
+        {
+            printf("%s: row %d differs\n", when, i);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int checkAppend(NVGcontext *vg, const char *text, float width)
+{
+    char when[64];
+    unsigned int seed = 3;
+    NVGtextLayout *layout = nvgCreateTextLayout(vg, width);
+    NVGtextLayout *fresh = nvgCreateTextLayout(vg, width);
+    NVGtextRow rows[2];
+    int n = 0, ok = 1;
+
+    while (ok && n < APPEND_SIZE)
+    {
+        // Pieces of 1 to 300 bytes, they may split new line pairs and UTF-8 sequences.
+        int piece = 1 + corpusRnd(&seed) % 300;
+        nvgTextLayoutAppend(vg, layout, text + n, text + n + piece);
+        n += piece;
+        nvgTextLayoutSetText(vg, fresh, text, text + n);
+        int nrows = nvgTextLayoutRowCount(vg, layout);
+        if (nrows != nvgTextLayoutRowCount(vg, fresh))
+        {
+            snprintf(when, sizeof(when), "width %g, %d bytes appended", width, n);
+            printf("%s: %d rows, %d in a new layout\n", when, nrows, nvgTextLayoutRowCount(vg, fresh));
+            ok = 0;
+        }
+        const char *a = layoutText(vg, layout), *b = layoutText(vg, fresh);
+        for (int i = 0; ok && i < nrows; ++i)
+        {
+            nvgTextLayoutRows(vg, layout, i, &rows[0], 1);
+            nvgTextLayoutRows(vg, fresh, i, &rows[1], 1);
+            if (!sameRow(&rows[0], a, &rows[1], b))
+            {
+                printf("width %g, %d bytes appended: row %d differs from a new layout\n", width, n, i);
+                ok = 0;
+            }
+        }
+    }
+    nvgDeleteTextLayout(vg, layout);
+    nvgDeleteTextLayout(vg, fresh);
+    return ok;
+}
+
+// Compares bounds and vertices of the layout with nvgTextBoxBounds() and nvgTextBox().
+int checkBox(NVGcontext *vg, NVGtextLayout *layout, const char *text, int length, float width, int align)
+{
+    float lbounds[4], bounds[4];
+    unsigned int hash;
+    int count, ok = 1;
+
+    nvgBeginFrame(vg, 1000.0, 1000.0, 1.0);
+    nvgFontFace(vg, "sans");
+    nvgFontSize(vg, 15.0);
+    nvgTextAlign(vg, align | NVG_ALIGN_TOP);
+    nvgTextLayoutBounds(vg, layout, 10.0, 20.0, lbounds);
+    nvgTextBoxBounds(vg, 10.0, 20.0, width, text, text + length, bounds);
+    for (int i = 0; i < 4; ++i)
+        ok &= fabsf(lbounds[i] - bounds[i]) <= 1e-3f * fmaxf(1.0f, fabsf(bounds[i]));
+    if (!ok)
+        printf("width %g, align %d: bounds %g %g %g %g, nvgTextBoxBounds() gives %g %g %g %g\n", width, align,
+               lbounds[0], lbounds[1], lbounds[2], lbounds[3], bounds[0], bounds[1], bounds[2], bounds[3]);
+
+    vertexHash = 2166136261u;
+    vertexCount = 0;
+    nvgDrawTextLayout(vg, layout, 10.0, 20.0, 0, -1);
+    nvgEndFrame(vg);
+    hash = vertexHash;
+    count = vertexCount;
+
+    nvgBeginFrame(vg, 1000.0, 1000.0, 1.0);
+    nvgFontFace(vg, "sans");
+    nvgFontSize(vg, 15.0);
+    nvgTextAlign(vg, align | NVG_ALIGN_TOP);
+    vertexHash = 2166136261u;
+    vertexCount = 0;
+    nvgTextBox(vg, 10.0, 20.0, width, text, text + length);
+    nvgEndFrame(vg);
+    if (hash != vertexHash || count != vertexCount)
+    {
+        printf("width %g, align %d: %d vertices drawn, nvgTextBox() draws %d, or they differ\n", width, align, count,
+               vertexCount);
+        ok = 0;
+    }
+    return ok;
+}
+
+double seconds(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+void timeLayouts(NVGcontext *vg, const char *text, int frames)
+{
+    NVGtextLayout *layout = nvgCreateTextLayout(vg, 300.0);
+    float bounds[4];
+    clock_t start;
+    double t[5];
+
+    nvgTextLayoutSetText(vg, layout, text, NULL);
+    nvgBeginFrame(vg, 1000.0, 1000.0, 1.0);
+    nvgFontFace(vg, "sans");
+    nvgFontSize(vg, 15.0);
+    nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+    // Warm up, so that the rows are broken and the glyphs are in the atlas.
+    nvgDrawTextLayout(vg, layout, 10.0, 20.0, 0, -1);
+    nvgCancelFrame(vg);
+
+    start = clock();
+    for (int f = 0; f < frames; ++f)
+        nvgTextLayoutBounds(vg, layout, 10.0, 20.0, bounds);
+    t[0] = seconds(start);
+    start = clock();
+    for (int f = 0; f < frames; ++f)
+        nvgTextBoxBounds(vg, 10.0, 20.0, 300.0, text, NULL, bounds);
+    t[1] = seconds(start);
+
+    start = clock();
+    for (int f = 0; f < frames; ++f)
+    {
+        nvgBeginFrame(vg, 1000.0, 1000.0, 1.0);
+        nvgFontFace(vg, "sans");
+        nvgFontSize(vg, 15.0);
+        nvgDrawTextLayout(vg, layout, 10.0, 20.0, 0, -1);
+        nvgEndFrame(vg);
+    }
+    t[2] = seconds(start);
+    start = clock();
+    for (int f = 0; f < frames; ++f)
+    {
+        nvgBeginFrame(vg, 1000.0, 1000.0, 1.0);
+        nvgFontFace(vg, "sans");
+        nvgFontSize(vg, 15.0);
+        nvgTextBox(vg, 10.0, 20.0, 300.0, text, NULL);
+        nvgEndFrame(vg);
+    }
+    t[3] = seconds(start);
+    start = clock();
+    for (int f = 0; f < frames; ++f)
+    {
+        nvgBeginFrame(vg, 1000.0, 1000.0, 1.0);
+        nvgFontFace(vg, "sans");
+        nvgFontSize(vg, 15.0);
+        nvgDrawTextLayout(vg, layout, 10.0, 20.0, f % 1000, PANEL_ROWS);
+        nvgEndFrame(vg);
+    }
+    t[4] = seconds(start);
+    nvgDeleteTextLayout(vg, layout);
+
+    fprintf(stderr, "bounds: layout %.3f ms, nvgTextBoxBounds %.3f ms\n", t[0] * 1000.0 / frames,
+            t[1] * 1000.0 / frames);
+    fprintf(stderr, "draw all rows: layout %.3f ms, nvgTextBox %.3f ms\n", t[2] * 1000.0 / frames,
+            t[3] * 1000.0 / frames);
+    fprintf(stderr, "draw %d rows: layout %.3f ms\n", PANEL_ROWS, t[4] * 1000.0 / frames);
+}
+
+// A log panel, a line is appended every frame and the last rows are drawn.
+void timeLog(NVGcontext *vg)
+{
+    NVGtextLayout *log = nvgCreateTextLayout(vg, 300.0);
+    char line[128];
+    float bounds[4];
+
+    clock_t start = clock();
+    for (int f = 0; f < LOG_LINES; ++f)
+    {
+        snprintf(line, sizeof(line), "frame %d: %d birds Away toward the Valley, %d kerning pairs\n", f, f % 300,
+                 f * 7);
+        nvgTextLayoutAppend(vg, log, line, NULL);
+        nvgBeginFrame(vg, 1000.0, 1000.0, 1.0);
+        nvgFontFace(vg, "sans");
+        nvgFontSize(vg, 13.0);
+        int nrows = nvgTextLayoutRowCount(vg, log);
+        nvgDrawTextLayout(vg, log, 10.0, 20.0 - (nrows > PANEL_ROWS ? nrows - PANEL_ROWS : 0) * 13.0,
+                          nrows - PANEL_ROWS, PANEL_ROWS);
+        nvgEndFrame(vg);
+    }
+    double appended = seconds(start);
+
+    // Breaking the whole log again, which the layout saves.
+    NVGtextRow row;
+    nvgTextLayoutRows(vg, log, 0, &row, 1);
+    start = clock();
+    nvgFontFace(vg, "sans");
+    nvgFontSize(vg, 13.0);
+    nvgTextBoxBounds(vg, 10.0, 20.0, 300.0, row.start, NULL, bounds);
+    double whole = seconds(start);
+    nvgDeleteTextLayout(vg, log);
+
+    fprintf(stderr, "log panel: %.3f ms/frame, breaking the whole log %.3f ms\n", appended * 1000.0 / LOG_LINES,
+            whole * 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+    static const float widths[] = {7.0, 80.0, 300.0, 1000.0};
+    static const int aligns[] = {NVG_ALIGN_LEFT, NVG_ALIGN_CENTER, NVG_ALIGN_RIGHT};
+    const char *path = NULL;
+    int frames = 20;
+    int failed = 0;
+    char when[64];
+    NVGparams params;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else if (argv[i][0] != '-')
+            path = argv[i];
+        else
+        {
+            printf("usage: %s [font.ttf] [-frames n]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (path == NULL)
+    {
+        printf("layout: skipped, no font\n");
+        return 0;
+    }
+
+    initNullParams(&params);
+    params.renderTriangles = hashTriangles;
+    NVGcontext *vg = nvgCreateInternal(&params);
+    char *text = createCorpus(CORPUS_SIZE, 1);
+    int length = text != NULL ? strlen(text) : 0;
+    // Every byte may end a row at width 7.
+    int maxRows = length + 1;
+    NVGtextRow *rows = malloc(sizeof(NVGtextRow) * maxRows);
+    if (vg == NULL || text == NULL || rows == NULL)
+    {
+        printf("Could not init nanovg.\n");
+        return 2;
+    }
+    if (nvgCreateFont(vg, "sans", path) == -1)
+    {
+        printf("Could not load %s.\n", path);
+        return 2;
+    }
+    nvgFontFace(vg, "sans");
+    nvgFontSize(vg, 15.0);
+
+    for (int w = 0; w < (int)(sizeof(widths) / sizeof(widths[0])); ++w)
+    {
+        NVGtextLayout *layout = nvgCreateTextLayout(vg, widths[w]);
+        nvgTextLayoutSetText(vg, layout, text, NULL);
+        snprintf(when, sizeof(when), "width %g", widths[w]);
+        failed |= !checkRows(vg, layout, text, length, widths[w], rows, maxRows, when);
+        printf("%s: %d rows\n", when, nvgTextLayoutRowCount(vg, layout));
+        failed |= !checkAppend(vg, text, widths[w]);
+        for (int a = 0; a < 3; ++a)
+            failed |= !checkBox(vg, layout, text, length, widths[w], aligns[a]);
+        nvgDeleteTextLayout(vg, layout);
+    }
+
+    if (frames > 0)
+    {
+        timeLayouts(vg, text, frames);
+        timeLog(vg);
+    }
+
+    free(rows);
+    free(text);
+    nvgDeleteInternal(vg);
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+// A back-end which drops everything, for tests which only look at what nanovg
+// hands to the back-end or at nanovg itself.
+
+#include <string.h>
+#include "../nanovg/nanovg.h"
+
+static int nullTextures = 0;
+
+static int nullCreate(void *uptr)
+{
+    NVG_NOTUSED(uptr);
+    return 1;
+}
+
+static int nullCreateTexture(void *uptr, int type, int w, int h, int imageFlags, const unsigned char *data)
+{
+    NVG_NOTUSED(uptr);
+    NVG_NOTUSED(type);
+    NVG_NOTUSED(w);
+    NVG_NOTUSED(h);
+    NVG_NOTUSED(imageFlags);
+    NVG_NOTUSED(data);
+    return ++nullTextures;
+}
+
+static int nullDeleteTexture(void *uptr, int image)
+{
+    NVG_NOTUSED(uptr);
+    NVG_NOTUSED(image);
+    return 1;
+}
+
+static int nullUpdateTexture(void *uptr, int image, int x, int y, int w, int h, const unsigned char *data)
+{
+    NVG_NOTUSED(uptr);
+    NVG_NOTUSED(image);
+    NVG_NOTUSED(x);
+    NVG_NOTUSED(y);
+    NVG_NOTUSED(w);
+    NVG_NOTUSED(h);
+    NVG_NOTUSED(data);
+    return 1;
+}
+
+static int nullGetTextureSize(void *uptr, int image, int *w, int *h)
+{
+    NVG_NOTUSED(uptr);
+    NVG_NOTUSED(image);
+    *w = 512;
+    *h = 512;
+    return 1;
+}
+
+static void nullViewport(void *uptr, float width, float height, float devicePixelRatio)
+{
+    NVG_NOTUSED(uptr);
+    NVG_NOTUSED(width);
+    NVG_NOTUSED(height);
+    NVG_NOTUSED(devicePixelRatio);
+}
+
+static void nullFlush(void *uptr)
+{
+    NVG_NOTUSED(uptr);
+}
+
+static void nullFill(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation, NVGscissor *scissor,
+                     float fringe, const float *bounds, const NVGpath *paths, int npaths)
+{
+    NVG_NOTUSED(uptr);
+    NVG_NOTUSED(paint);
+    NVG_NOTUSED(compositeOperation);
+    NVG_NOTUSED(scissor);
+    NVG_NOTUSED(fringe);
+    NVG_NOTUSED(bounds);
+    NVG_NOTUSED(paths);
+    NVG_NOTUSED(npaths);
+}
+
+static void nullStroke(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation, NVGscissor *scissor,
+                       float fringe, float strokeWidth, const NVGpath *paths, int npaths)
+{
+    NVG_NOTUSED(uptr);
+    NVG_NOTUSED(paint);
+    NVG_NOTUSED(compositeOperation);
+    NVG_NOTUSED(scissor);
+    NVG_NOTUSED(fringe);
+    NVG_NOTUSED(strokeWidth);
+    NVG_NOTUSED(paths);
+    NVG_NOTUSED(npaths);
+}
+
+static void nullTriangles(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation, NVGscissor *scissor,
+                          const NVGvertex *verts, int nverts, float fringe)
+{
+    NVG_NOTUSED(uptr);
+    NVG_NOTUSED(paint);
+    NVG_NOTUSED(compositeOperation);
+    NVG_NOTUSED(scissor);
+    NVG_NOTUSED(verts);
+    NVG_NOTUSED(nverts);
+    NVG_NOTUSED(fringe);
+}
+
+static void nullDelete(void *uptr)
+{
+    NVG_NOTUSED(uptr);
+}
+
+// Fills params with the null back-end, tests override the callbacks they look at.
+void initNullParams(NVGparams *params)
+{
+    memset(params, 0, sizeof(*params));
+    params->renderCreate = nullCreate;
+    params->renderCreateTexture = nullCreateTexture;
+    params->renderDeleteTexture = nullDeleteTexture;
+    params->renderUpdateTexture = nullUpdateTexture;
+    params->renderGetTextureSize = nullGetTextureSize;
+    params->renderViewport = nullViewport;
+    params->renderCancel = nullFlush;
+    params->renderFlush = nullFlush;
+    params->renderFill = nullFill;
+    params->renderStroke = nullStroke;
+    params->renderTriangles = nullTriangles;
+    params->renderDelete = nullDelete;
+}
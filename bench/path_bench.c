@@ -0,0 +1,187 @@
+// Measures the recording of path commands, nvgMoveTo() to nvgArc() under a transform,
+// which ends in nvg__appendCommands() encoding the opcodes and transforming the points.
+// Each frame records rotated polygons, curves, rects, rounded rects, ellipses and arcs
+// in one path, and the time per frame and per command point goes to stderr. The time
+// per point of nvg__appendCommands() alone, on runs of 32 line segments, is given as well.
+//
+// Before that the transformed points are checked against the plain C formula for random
+// transforms and point counts, they have to match bit for bit. nanovg.c is included to
+// call nvg__appendCommands() directly. Built with -DNVG_NO_SIMD it measures the plain C
+// transform.
+//
+//   path_bench [-shapes n] [-frames n]
+
+#include <time.h>
+#include "../nanovg/nanovg.c"
+#include "null_backend.h"
+
+#define CHECK_ROUNDS 1000
+#define CHECK_POINTS 33
+
+unsigned int rnd(unsigned int *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+float rndf(unsigned int *seed, float lo, float hi)
+{
+    return lo + (rnd(seed) / 16777216.0f) * (hi - lo);
+}
+
+// Returns the number of points which differ from the plain C transform.
+int checkTransform(NVGcontext *ctx)
+{
+    unsigned char cmds[CHECK_POINTS];
+    float pts[CHECK_POINTS * 2];
+    unsigned int seed = 7;
+    int mismatches = 0;
+
+    for (int r = 0; r < CHECK_ROUNDS; ++r)
+    {
+        NVGstate *state = nvg__getState(ctx);
+        int npts = 1 + r % CHECK_POINTS;
+        for (int i = 0; i < 6; ++i)
+            state->xform[i] = rndf(&seed, -100.0, 100.0);
+        for (int i = 0; i < npts; ++i)
+        {
+            cmds[i] = i == 0 ? NVG_MOVETO : NVG_LINETO;
+            pts[i * 2] = rndf(&seed, -1000.0, 1000.0);
+            pts[i * 2 + 1] = rndf(&seed, -1000.0, 1000.0);
+        }
+
+        nvgBeginPath(ctx);
+        nvg__appendCommands(ctx, cmds, npts, pts, npts);
+        const float *t = state->xform;
+        for (int i = 0; i < npts; ++i)
+        {
+            float x = pts[i * 2] * t[0] + pts[i * 2 + 1] * t[2] + t[4];
+            float y = pts[i * 2] * t[1] + pts[i * 2 + 1] * t[3] + t[5];
+            if (memcmp(&x, &ctx->commandPoints[i * 2], sizeof(float)) != 0 ||
+                memcmp(&y, &ctx->commandPoints[i * 2 + 1], sizeof(float)) != 0)
+                mismatches++;
+        }
+    }
+    nvgResetTransform(ctx);
+    return mismatches;
+}
+
+void recordShapes(NVGcontext *vg, int shapes, float t)
+{
+    nvgBeginPath(vg);
+    for (int i = 0; i < shapes; ++i)
+    {
+        float x = (i % 50) * 20.0, y = (i / 50) * 20.0;
+        nvgSave(vg);
+        nvgTranslate(vg, x, y);
+        nvgRotate(vg, t + i * 0.1);
+        switch (i % 6)
+        {
+        case 0:
+            nvgMoveTo(vg, -8.0, -6.0);
+            for (int k = 1; k < 6; ++k)
+                nvgLineTo(vg, cosf(k * 1.047f) * 8.0, sinf(k * 1.047f) * 8.0);
+            nvgClosePath(vg);
+            break;
+        case 1:
+            nvgMoveTo(vg, -8.0, 0.0);
+            nvgBezierTo(vg, -4.0, -8.0, 4.0, 8.0, 8.0, 0.0);
+            nvgQuadTo(vg, 0.0, 8.0, -8.0, 0.0);
+            break;
+        case 2:
+            nvgRect(vg, -8.0, -5.0, 16.0, 10.0);
+            break;
+        case 3:
+            nvgRoundedRect(vg, -8.0, -5.0, 16.0, 10.0, 3.0);
+            break;
+        case 4:
+            nvgEllipse(vg, 0.0, 0.0, 8.0, 5.0);
+            break;
+        default:
+            nvgArc(vg, 0.0, 0.0, 7.0, 0.0, 4.0, NVG_CW);
+            break;
+        }
+        nvgRestore(vg);
+    }
+}
+
+// Returns the seconds taken to append rounds runs of 32 points to an empty path.
+double timeAppend(NVGcontext *ctx, int rounds)
+{
+    unsigned char cmds[32];
+    float pts[64];
+    for (int i = 0; i < 32; ++i)
+    {
+        cmds[i] = i == 0 ? NVG_MOVETO : NVG_LINETO;
+        pts[i * 2] = i * 3.0;
+        pts[i * 2 + 1] = i * 2.0;
+    }
+    nvgRotate(ctx, 0.5);
+    clock_t start = clock();
+    for (int r = 0; r < rounds; ++r)
+    {
+        ctx->ncommands = 0;
+        ctx->ncommandPoints = 0;
+        nvg__appendCommands(ctx, cmds, 32, pts, 32);
+    }
+    double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+    nvgResetTransform(ctx);
+    return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    int shapes = 3000;
+    int frames = 200;
+    NVGparams params;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-shapes") == 0 && i + 1 < argc)
+            shapes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else
+        {
+            printf("usage: %s [-shapes n] [-frames n]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    initNullParams(&params);
+    NVGcontext *vg = nvgCreateInternal(&params);
+    if (vg == NULL)
+    {
+        printf("Could not init nanovg.\n");
+        return 2;
+    }
+
+#ifdef NVG_SSE2
+    printf("transform: SSE2\n");
+#else
+    printf("transform: plain C\n");
+#endif
+    nvgBeginFrame(vg, 1000.0, 1000.0, 1.0);
+    int mismatches = checkTransform(vg);
+    if (mismatches != 0)
+        printf("%d transformed points differ from the plain C transform\n", mismatches);
+
+    // Warm up, so that the command buffers are grown before timing.
+    recordShapes(vg, shapes, 0.0);
+    clock_t start = clock();
+    for (int f = 0; f < frames; ++f)
+        recordShapes(vg, shapes, f * 0.016);
+    double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("%d shapes: %d commands, %d points per frame\n", shapes, vg->ncommands, vg->ncommandPoints);
+    if (frames > 0)
+        fprintf(stderr, "%.4f ms/frame, %.2f ns/point\n", elapsed * 1000.0 / frames,
+                elapsed * 1e9 / ((double)frames * vg->ncommandPoints));
+    double append = timeAppend(vg, frames * 10000);
+    if (frames > 0)
+        fprintf(stderr, "append: %.2f ns/point\n", append * 1e9 / ((double)frames * 10000 * 32));
+    nvgCancelFrame(vg);
+
+    nvgDeleteInternal(vg);
+    printf("%s\n", mismatches == 0 ? "OK" : "FAILED");
+    return mismatches == 0 ? 0 : 1;
+}
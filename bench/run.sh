@@ -0,0 +1,67 @@
+#!/bin/bash
+# Builds and runs the tests, then the benchmark against the recording GL stub,
+# which is compared with the baseline. Every scene has a baseline per configuration
+# of creation flags, see configs in bench.c.
+# The text and corpus scenes need a TrueType font, they are skipped when none is given.
+#
+#   bench/run.sh [font.ttf]         run the tests and check the scenes against baseline.json
+#   bench/run.sh -update [font.ttf] rewrite baseline.json
+set -e
+
+update=0
+if [ "$1" == "-update" ]; then
+    update=1
+    shift
+fi
+font=""
+if [ -n "$1" ]; then
+    font="$(cd "$(dirname "$1")" && pwd)/$(basename "$1")"
+fi
+
+cd "$(dirname "$0")"
+mkdir -p build
+cc -std=c99 -O2 -I../nanovg bench.c ../nanovg/nanovg.c -o build/bench -lm
+cc -std=c99 -O2 -I../nanovg frame_alloc_test.c ../nanovg/nanovg.c -o build/frame_alloc_test -lm
+cc -std=c99 -O2 -I../nanovg triangulate_test.c ../nanovg/nanovg.c -o build/triangulate_test -lm
+cc -std=c99 -O2 -I../nanovg atlas_test.c -o build/atlas_test -lm
+cc -std=c99 -O2 -I../nanovg subpixel_bench.c -o build/subpixel_bench -lm
+cc -std=c99 -O2 -I../nanovg layout_bench.c ../nanovg/nanovg.c -o build/layout_bench -lm
+# The bezier flattener, the transform of path points and the glyph blur are checked with and without SSE2.
+cc -std=c99 -O2 -I../nanovg bezier_bench.c -o build/bezier_bench -lm
+cc -std=c99 -O2 -DNVG_NO_SIMD -I../nanovg bezier_bench.c -o build/bezier_bench_scalar -lm
+cc -std=c99 -O2 -I../nanovg path_bench.c -o build/path_bench -lm
+cc -std=c99 -O2 -DNVG_NO_SIMD -I../nanovg path_bench.c -o build/path_bench_scalar -lm
+cc -std=c99 -O2 -I../nanovg blur_bench.c -o build/blur_bench -lm
+cc -std=c99 -O2 -DFONS_NO_SIMD -I../nanovg blur_bench.c -o build/blur_bench_scalar -lm
+# The shader variants are compiled by a real driver, through EGL, when there is one.
+variants=0
+if pkg-config --exists egl gl 2> /dev/null; then
+    variants=1
+    cc -std=c99 -O2 -I../nanovg variants_test.c ../nanovg/nanovg.c -o build/variants_test $(pkg-config --libs egl gl) -lm
+    cc -std=c99 -O2 -DVARIANTS_GL2 -I../nanovg variants_test.c ../nanovg/nanovg.c -o build/variants_test_gl2 \
+        $(pkg-config --libs egl gl) -lm
+fi
+
+if [ $update == 1 ]; then
+    ./build/bench ${font:+-font "$font"} -frames 0 > baseline.json
+else
+    ./build/frame_alloc_test ${font:+"$font"}
+    ./build/triangulate_test
+    ./build/atlas_test ${font:+"$font"}
+    ./build/subpixel_bench ${font:+"$font"} -frames 0
+    ./build/layout_bench ${font:+"$font"} -frames 0
+    ./build/bezier_bench -repeat 0
+    ./build/bezier_bench_scalar -repeat 0
+    ./build/path_bench -frames 0
+    ./build/path_bench_scalar -frames 0
+    ./build/blur_bench -repeat 0
+    ./build/blur_bench_scalar -repeat 0
+    if [ $variants == 1 ]; then
+        # 77 is a skip, there was no GL context.
+        ./build/variants_test || [ $? == 77 ]
+        ./build/variants_test_gl2 || [ $? == 77 ]
+    else
+        echo "variants: skipped, no EGL"
+    fi
+    ./build/bench ${font:+-font "$font"} -compare baseline.json
+fi
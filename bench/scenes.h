@@ -0,0 +1,336 @@
+#pragma once
+
+// Representative scenes of the demo, shared by the benchmark and the tests.
+// They mirror aBird() and worldEdges() from main.c, but place the flock with a
+// fixed seed so that every run draws exactly the same frames.
+
+#include <stdio.h>
+#include "../nanovg/nanovg.h"
+#include "../math_utils.h"
+#include "corpus.h"
+
+#define PI 3.14159265
+#define FLOCK_SIZE 200
+#define SHAPE_IMAGES 4
+#define SHAPE_IMAGE_SIZE 16
+
+typedef struct
+{
+    float heading;
+    vec2 position;
+} birdy;
+
+typedef struct
+{
+    vec2 size;
+    vec2 position;
+    vec2 viewport;
+    vec2 view;
+    birdy birds[FLOCK_SIZE];
+} scene;
+
+static unsigned int sceneSeed = 1;
+
+// rand() differs between C libraries, the baselines must not.
+float sceneRandf()
+{
+    sceneSeed = sceneSeed * 1664525u + 1013904223u;
+    return (float)(sceneSeed >> 8) / 16777216.0f;
+}
+
+void initScene(scene *s)
+{
+    sceneSeed = 1;
+    s->size = new_vec2(1024.0, 1024.0);
+    s->view = new_vec2(1000.0, 600.0);
+    for (int i = 0; i < FLOCK_SIZE; ++i)
+    {
+        s->birds[i].heading = sceneRandf() * (PI * 2.0);
+        s->birds[i].position = new_vec2(sceneRandf() * s->size.x, sceneRandf() * s->size.y);
+    }
+}
+
+// Moves the camera, zoom > 1 shows more of the world.
+void sceneCamera(scene *s, vec2 position, float zoom)
+{
+    s->position = position;
+    s->viewport = vec2_add(position, vec2_mul(s->view, zoom));
+}
+
+void benchTri(NVGcontext *ctx, float s)
+{
+    nvgBeginPath(ctx);
+    nvgMoveTo(ctx, -(s / 1.5), -s);
+    nvgLineTo(ctx, (s / 1.5), -s);
+    nvgLineTo(ctx, 0, -(s * 3.0));
+    nvgLineTo(ctx, -(s / 1.5), -s);
+    nvgClosePath(ctx);
+}
+
+void benchBird(NVGcontext *ctx, vec2 p, float heading, float skew, float bSize)
+{
+    nvgResetTransform(ctx);
+    nvgTranslate(ctx, p.x + skew, p.y - skew);
+    nvgRotate(ctx, PI / 2.0 + skew * 0.02 + heading);
+    benchTri(ctx, bSize);
+    nvgStrokeColor(ctx, nvgRGBA(255, 0, 0, 150));
+    nvgStrokeWidth(ctx, 2.0);
+    nvgStroke(ctx);
+
+    nvgResetTransform(ctx);
+    nvgTranslate(ctx, p.x - skew, p.y + skew);
+    nvgRotate(ctx, PI / 2.0 + skew * -0.02 + heading);
+    benchTri(ctx, bSize);
+    nvgStrokeColor(ctx, nvgRGBA(0, 255, 0, 150));
+    nvgStrokeWidth(ctx, 2.0);
+    nvgStroke(ctx);
+
+    nvgResetTransform(ctx);
+    nvgTranslate(ctx, p.x + skew, p.y + skew);
+    nvgRotate(ctx, PI / 2.0 + skew * 0.05 + heading);
+    benchTri(ctx, bSize);
+    nvgStrokeColor(ctx, nvgRGBA(0, 0, 255, 150));
+    nvgStrokeWidth(ctx, 2.0);
+    nvgStroke(ctx);
+
+    nvgResetTransform(ctx);
+    nvgTranslate(ctx, p.x, p.y);
+    nvgRotate(ctx, PI / 2.0 + heading);
+    benchTri(ctx, bSize);
+    nvgStrokeColor(ctx, nvgRGBA(255, 255, 255, 170));
+    nvgStrokeWidth(ctx, 1.0);
+    nvgStroke(ctx);
+}
+
+// The flock as the demo draws it, birds outside of the camera are skipped.
+void flockScene(NVGcontext *ctx, scene *s, float t)
+{
+    for (int i = 0; i < FLOCK_SIZE; ++i)
+    {
+        vec2 p = s->birds[i].position;
+        if (p.x < s->position.x || p.x >= s->viewport.x || p.y < s->position.y || p.y >= s->viewport.y)
+            continue;
+        p = new_vec2(map(p.x, s->position.x, s->viewport.x, 0.0, s->view.x),
+                     map(p.y, s->position.y, s->viewport.y, 0.0, s->view.y));
+        benchBird(ctx, p, s->birds[i].heading + t, 0.5, 15.0);
+    }
+    nvgResetTransform(ctx);
+}
+
+// The border of the world, the camera should see all four edges.
+void edgesScene(NVGcontext *ctx, scene *s)
+{
+    nvgResetTransform(ctx);
+    nvgStrokeColor(ctx, nvgRGBA(255, 255, 255, 255));
+    nvgStrokeWidth(ctx, 2.0);
+    // top
+    if (s->position.y <= 0)
+    {
+        nvgBeginPath(ctx);
+        nvgMoveTo(ctx, -s->position.x, -s->position.y);
+        nvgLineTo(ctx, s->size.x - s->position.x, -s->position.y);
+        nvgClosePath(ctx);
+        nvgStroke(ctx);
+    }
+    // left
+    if (s->position.x <= 0)
+    {
+        nvgBeginPath(ctx);
+        nvgMoveTo(ctx, -s->position.x, -s->position.y);
+        nvgLineTo(ctx, -s->position.x, s->size.y - s->position.y);
+        nvgClosePath(ctx);
+        nvgStroke(ctx);
+    }
+    // bottom
+    if (s->viewport.y >= s->size.y)
+    {
+        nvgBeginPath(ctx);
+        nvgMoveTo(ctx, -s->position.x, s->view.y - (s->viewport.y - s->size.y));
+        nvgLineTo(ctx, s->size.x - s->position.x, s->view.y - (s->viewport.y - s->size.y));
+        nvgClosePath(ctx);
+        nvgStroke(ctx);
+    }
+    // right
+    if (s->viewport.x >= s->size.x)
+    {
+        nvgBeginPath(ctx);
+        nvgMoveTo(ctx, s->view.x - (s->viewport.x - s->size.x), -s->position.y);
+        nvgLineTo(ctx, s->view.x - (s->viewport.x - s->size.x), s->size.y - s->position.y);
+        nvgClosePath(ctx);
+        nvgStroke(ctx);
+    }
+}
+
+// A label next to each visible bird and a title line, in the font "sans".
+void textScene(NVGcontext *ctx, scene *s)
+{
+    char label[32];
+    nvgResetTransform(ctx);
+    nvgFontFace(ctx, "sans");
+    nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+    nvgFontSize(ctx, 24.0);
+    nvgFillColor(ctx, nvgRGBA(255, 255, 255, 255));
+    nvgText(ctx, 10.0, 10.0, "Birds of a feather flock together", NULL);
+    nvgFontSize(ctx, 12.0);
+    nvgFillColor(ctx, nvgRGBA(255, 255, 0, 200));
+    for (int i = 0; i < FLOCK_SIZE; ++i)
+    {
+        vec2 p = s->birds[i].position;
+        if (p.x < s->position.x || p.x >= s->viewport.x || p.y < s->position.y || p.y >= s->viewport.y)
+            continue;
+        p = new_vec2(map(p.x, s->position.x, s->viewport.x, 0.0, s->view.x),
+                     map(p.y, s->position.y, s->viewport.y, 0.0, s->view.y));
+        snprintf(label, sizeof(label), "bird %d", i);
+        nvgText(ctx, p.x + 20.0, p.y, label, NULL);
+    }
+}
+
+// The corpus of the corpus scene, made on first use and kept until exit.
+static char *sceneCorpus = NULL;
+
+// Lays out a 100KB corpus, which is mostly kerning lookups: the corpus is broken into rows at one of
+// three sizes, the size changes every frame, and every row is measured. The rows which fit the view
+// are drawn.
+void corpusScene(NVGcontext *ctx, scene *s, int frame)
+{
+    static const float sizes[3] = {12.0, 16.0, 24.0};
+    NVGtextRow rows[64];
+    float bounds[4], lineh;
+    float y = 10.0;
+    int nrows;
+
+    if (sceneCorpus == NULL)
+        sceneCorpus = createCorpus(CORPUS_SIZE, 0);
+    if (sceneCorpus == NULL)
+        return;
+    nvgResetTransform(ctx);
+    nvgFontFace(ctx, "sans");
+    nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+    nvgFontSize(ctx, sizes[frame % 3]);
+    nvgFillColor(ctx, nvgRGBA(255, 255, 255, 255));
+    nvgTextMetrics(ctx, NULL, NULL, &lineh);
+
+    const char *text = sceneCorpus;
+    while ((nrows = nvgTextBreakLines(ctx, text, NULL, s->view.x - 20.0, rows, 64)) > 0)
+    {
+        for (int i = 0; i < nrows; ++i)
+        {
+            nvgTextBounds(ctx, 10.0, y, rows[i].start, rows[i].end, bounds);
+            if (y + lineh < s->view.y)
+                nvgText(ctx, 10.0, y, rows[i].start, rows[i].end);
+            y += lineh;
+        }
+        text = rows[nrows - 1].next;
+    }
+}
+
+// Small generated images for the shapes scene, the last one changes every frame.
+void createShapeImages(NVGcontext *ctx, int *images)
+{
+    unsigned char pixels[SHAPE_IMAGE_SIZE * SHAPE_IMAGE_SIZE * 4];
+    for (int i = 0; i < SHAPE_IMAGES; ++i)
+    {
+        for (int p = 0; p < SHAPE_IMAGE_SIZE * SHAPE_IMAGE_SIZE; ++p)
+        {
+            int checker = ((p % SHAPE_IMAGE_SIZE) / 4 + (p / SHAPE_IMAGE_SIZE) / 4) & 1;
+            pixels[p * 4 + 0] = checker ? 255 : 60 * i;
+            pixels[p * 4 + 1] = checker ? 200 : 40;
+            pixels[p * 4 + 2] = 255 - 60 * i;
+            pixels[p * 4 + 3] = 255;
+        }
+        images[i] = nvgCreateImageRGBA(ctx, SHAPE_IMAGE_SIZE, SHAPE_IMAGE_SIZE, 0, pixels);
+    }
+}
+
+void updateShapeImages(NVGcontext *ctx, int *images, int frame)
+{
+    unsigned char pixels[SHAPE_IMAGE_SIZE * SHAPE_IMAGE_SIZE * 4];
+    for (int p = 0; p < SHAPE_IMAGE_SIZE * SHAPE_IMAGE_SIZE; ++p)
+    {
+        pixels[p * 4 + 0] = (unsigned char)(frame * 8 + p);
+        pixels[p * 4 + 1] = (unsigned char)(p * 3);
+        pixels[p * 4 + 2] = 128;
+        pixels[p * 4 + 3] = 255;
+    }
+    nvgUpdateImage(ctx, images[SHAPE_IMAGES - 1], pixels);
+}
+
+void benchStar(NVGcontext *ctx, vec2 p, float r, float t)
+{
+    nvgBeginPath(ctx);
+    for (int i = 0; i < 10; ++i)
+    {
+        float a = i * PI / 5.0 + t;
+        float d = (i & 1) ? r * 0.4 : r;
+        if (i == 0)
+            nvgMoveTo(ctx, p.x + cosf(a) * d, p.y + sinf(a) * d);
+        else
+            nvgLineTo(ctx, p.x + cosf(a) * d, p.y + sinf(a) * d);
+    }
+    nvgClosePath(ctx);
+}
+
+// Filled shapes: convex boxes, round nests, concave stars and tiles of small images.
+void shapesScene(NVGcontext *ctx, scene *s, int *images, float t)
+{
+    nvgResetTransform(ctx);
+    sceneSeed = 7;
+    for (int i = 0; i < 40; ++i)
+    {
+        vec2 p = new_vec2(sceneRandf() * s->view.x, sceneRandf() * s->view.y);
+        nvgBeginPath(ctx);
+        nvgRect(ctx, p.x, p.y, 20.0 + 10.0 * (i % 3), 14.0);
+        nvgFillColor(ctx, nvgRGBA(80, 120, 200, 200));
+        nvgFill(ctx);
+    }
+    for (int i = 0; i < 20; ++i)
+    {
+        vec2 p = new_vec2(sceneRandf() * s->view.x, sceneRandf() * s->view.y);
+        nvgBeginPath(ctx);
+        nvgCircle(ctx, p.x, p.y, 6.0 + (i % 4));
+        nvgFillColor(ctx, nvgRGBA(200, 160, 60, 220));
+        nvgFill(ctx);
+    }
+    for (int i = 0; i < 40; ++i)
+    {
+        vec2 p = new_vec2(sceneRandf() * s->view.x, sceneRandf() * s->view.y);
+        benchStar(ctx, p, 12.0 + (i % 5) * 2.0, t + i);
+        nvgFillColor(ctx, nvgRGBA(255, 220, 0, 230));
+        nvgFill(ctx);
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        vec2 p = new_vec2(sceneRandf() * s->view.x, sceneRandf() * s->view.y);
+        int image = images[i % SHAPE_IMAGES];
+        nvgBeginPath(ctx);
+        nvgRect(ctx, p.x, p.y, 32.0, 32.0);
+        nvgFillPaint(ctx, nvgImagePattern(ctx, p.x, p.y, 32.0, 32.0, 0.0, image, 1.0));
+        nvgFill(ctx);
+    }
+}
+
+// The flock seen from close up and drawn without skipping anything, the birds out of
+// the camera have to be culled by nanovg. A grid of boxes spills over every side too.
+void offscreenScene(NVGcontext *ctx, scene *s, float t)
+{
+    vec2 position = new_vec2(300.0, 300.0);
+    vec2 viewport = vec2_add(position, vec2_mul(s->view, 0.5));
+    for (int i = 0; i < FLOCK_SIZE; ++i)
+    {
+        vec2 p = s->birds[i].position;
+        p = new_vec2(map(p.x, position.x, viewport.x, 0.0, s->view.x),
+                     map(p.y, position.y, viewport.y, 0.0, s->view.y));
+        benchBird(ctx, p, s->birds[i].heading + t, 0.5, 15.0);
+    }
+    nvgResetTransform(ctx);
+    nvgFillColor(ctx, nvgRGBA(80, 120, 200, 120));
+    for (int y = -2; y < 8; ++y)
+    {
+        for (int x = -2; x < 12; ++x)
+        {
+            nvgBeginPath(ctx);
+            nvgRect(ctx, x * 150.0, y * 150.0, 60.0, 60.0);
+            nvgFill(ctx);
+        }
+    }
+}
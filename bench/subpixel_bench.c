@@ -0,0 +1,211 @@
+// Compares the atlas footprint of subpixel positioning, nvgTextSubpixel(), with what it buys in
+// placement. Labels at UI sizes drifting by fractions of a pixel are drawn for a number of frames
+// with subpixel positioning off and on, and for each the glyphs in the atlas and their area are
+// printed, with the error between the bitmap origin and the exact pen position of a label moving
+// 1/20 pixel per frame, largest and rms, and the largest error of its step from frame to frame.
+// Built with -DFONS_SUBPIXEL_STEPS=n it measures n bitmaps per glyph instead of 4.
+//
+// Before that ASCII is prewarmed with nvgPrewarmGlyphs() and subpixel positioning on, then text
+// is drawn at fractional positions, no glyph may be rasterized while drawing. With subpixel
+// positioning on the placement error may not be more than half a step. nanovg.c is
+// included to look at the atlas of the context.
+//
+//   subpixel_bench [font.ttf] [-frames n]
+//
+// Time per frame goes to stderr, it depends on the machine.
+
+#include <time.h>
+#include "../nanovg/nanovg.c"
+#include "null_backend.h"
+
+#define LABELS 200
+#define STEP_FRAMES 200
+#define STEP 0.05f // Pixels the moving label is moved by each frame.
+
+typedef struct
+{
+    int glyphs;
+    long area;
+} footprint;
+
+footprint atlasFootprint(NVGcontext *vg)
+{
+    FONScontext *fs = vg->fs;
+    footprint f = {0, 0};
+    for (int i = 0; i < fs->nentries; ++i)
+    {
+        const FONSglyph *g = fs->entries[i].glyph;
+        if (g == NULL)
+            continue;
+        f.glyphs++;
+        f.area += (long)(g->x1 - g->x0) * (g->y1 - g->y0);
+    }
+    return f;
+}
+
+void drawLabels(NVGcontext *vg, int subpixel, int frame)
+{
+    char label[64];
+    nvgBeginFrame(vg, 1000.0, 1000.0, 1.0);
+    nvgTextSubpixel(vg, subpixel);
+    nvgFontFace(vg, "sans");
+    for (int i = 0; i < LABELS; ++i)
+    {
+        nvgFontSize(vg, 9.0 + (i % 8) * 1.5);
+        snprintf(label, sizeof(label), "bird #%d speed %d.%d", i % 50, i % 7, frame % 10);
+        nvgText(vg, i * 37.31f + frame * 0.13f * (1 + i % 5), 12.0 + (i % 40) * 12.0, label, NULL);
+    }
+    nvgEndFrame(vg);
+}
+
+// Placement of a label moved STEP pixels per frame, the bitmap origin of each glyph is compared
+// with the pen position without rounding.
+void placementError(NVGcontext *vg, int subpixel, double *worst, double *rms, double *step)
+{
+    FONScontext *fs = vg->fs;
+    FONSfont *font = fs->fonts[0];
+    FONStextIter iter;
+    FONSquad q;
+    double prev[64], sum = 0.0;
+    long n = 0;
+
+    *worst = *step = 0.0;
+    fonsClearState(fs);
+    fonsSetFont(fs, 0);
+    fonsSetSize(fs, 13.0);
+    fonsSetSubpixel(fs, subpixel);
+    float scale = fons__tt_getPixelHeightScale(&font->font, 13.0);
+    for (int f = 0; f < STEP_FRAMES; ++f)
+    {
+        float pen = 100.0f + f * STEP;
+        int k = 0, prevIndex = -1;
+        fonsTextIterInit(fs, &iter, pen, 50.0, "Slowly moving label", NULL, FONS_GLYPH_BITMAP_REQUIRED);
+        while (fonsTextIterNext(fs, &iter, &q) && k < 64)
+        {
+            const FONSglyph *g = fs->entries[iter.entry].glyph;
+            if (prevIndex != -1)
+                pen += fons__getKernAdvance(fs, font, prevIndex, g->index) * scale;
+            double origin = q.x0 - (g->xoff + 1) + (double)g->phase / FONS_SUBPIXEL_STEPS;
+            double e = origin - pen;
+            *worst = fmax(*worst, fabs(e));
+            sum += e * e;
+            n++;
+            if (f > 0)
+                *step = fmax(*step, fabs(origin - prev[k] - STEP));
+            prev[k++] = origin;
+            pen += g->xadv / 10.0f;
+            prevIndex = g->index;
+        }
+        fonsEndFrame(fs);
+    }
+    *rms = n > 0 ? sqrt(sum / n) : 0.0;
+}
+
+NVGcontext *createContext(const char *path)
+{
+    NVGparams params;
+    initNullParams(&params);
+    NVGcontext *vg = nvgCreateInternal(&params);
+    if (vg == NULL)
+        return NULL;
+    if (nvgCreateFont(vg, "sans", path) == -1)
+    {
+        nvgDeleteInternal(vg);
+        return NULL;
+    }
+    return vg;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    int frames = 120;
+    int failed = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else if (argv[i][0] != '-')
+            path = argv[i];
+        else
+        {
+            printf("usage: %s [font.ttf] [-frames n]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (path == NULL)
+    {
+        printf("subpixel: skipped, no font\n");
+        return 0;
+    }
+
+    // Prewarmed glyphs have to cover every position they are drawn at.
+    NVGcontext *vg = createContext(path);
+    if (vg == NULL)
+    {
+        printf("Could not load %s.\n", path);
+        return 2;
+    }
+    nvgTextSubpixel(vg, 1);
+    nvgFontFace(vg, "sans");
+    nvgFontSize(vg, 13.0);
+    if (!nvgPrewarmGlyphs(vg, 32, 126))
+    {
+        printf("prewarm: could not add ASCII\n");
+        failed = 1;
+    }
+    footprint prewarmed = atlasFootprint(vg);
+    unsigned int serial = vg->fs->serial;
+    for (int f = 0; f < STEP_FRAMES; ++f)
+    {
+        nvgBeginFrame(vg, 1000.0, 1000.0, 1.0);
+        nvgTextSubpixel(vg, 1);
+        nvgFontFace(vg, "sans");
+        nvgFontSize(vg, 13.0);
+        nvgText(vg, 100.0 + f * STEP, 50.0, "The quick brown fox jumps over the lazy dog 0123456789", NULL);
+        nvgEndFrame(vg);
+    }
+    printf("prewarm: %d glyphs, %ld px, %u rasterized while drawing\n", prewarmed.glyphs, prewarmed.area,
+           vg->fs->serial - serial);
+    if (vg->fs->serial != serial)
+        failed = 1;
+    nvgDeleteInternal(vg);
+
+    for (int subpixel = 0; subpixel < 2; ++subpixel)
+    {
+        double worst, rms, step;
+        vg = createContext(path);
+        if (vg == NULL)
+            return 2;
+        // The first pass rasterizes, the second draws from the atlas.
+        clock_t start = clock();
+        for (int f = 0; f < frames; ++f)
+            drawLabels(vg, subpixel, f);
+        double first = (double)(clock() - start) / CLOCKS_PER_SEC;
+        start = clock();
+        for (int f = 0; f < frames; ++f)
+            drawLabels(vg, subpixel, f);
+        double cached = (double)(clock() - start) / CLOCKS_PER_SEC;
+        footprint fp = atlasFootprint(vg);
+        placementError(vg, subpixel, &worst, &rms, &step);
+
+        printf("subpixel %s, %d steps: %d glyphs, %ld px; moving label error max %.3f rms %.3f px, step error %.3f px\n",
+               subpixel ? "on" : "off", subpixel ? FONS_SUBPIXEL_STEPS : 1, fp.glyphs, fp.area, worst, rms, step);
+        if (frames > 0)
+            fprintf(stderr, "subpixel %s: first pass %.3f ms/frame, cached %.3f ms/frame\n", subpixel ? "on" : "off",
+                    first * 1000.0 / frames, cached * 1000.0 / frames);
+        // Rounding to the nearest position is off by at most half a step. Without subpixel
+        // positioning the advances are rounded as well, the error grows along the label.
+        double allowed = 0.5 / FONS_SUBPIXEL_STEPS + 0.01;
+        if (subpixel && worst > allowed)
+        {
+            printf("subpixel on: placement error %.3f px, more than %.3f\n", worst, allowed);
+            failed = 1;
+        }
+        nvgDeleteInternal(vg);
+    }
+
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
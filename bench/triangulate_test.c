@@ -0,0 +1,216 @@
+// Checks the ear clipping of concave fills, NVG_TRIANGULATE_FILLS in the GL back-ends.
+// Polygons are filled through a back-end which keeps the fill of the last path. Without
+// anti-aliasing the triangles have to cover exactly the area of the polygon, all wound
+// the same way, using only its corners. Paths the triangulation can not draw like the
+// stencil fill, self intersecting, with holes, or with bevels in the fringe, must be left
+// to the stencil fill.
+//
+//   triangulate_test
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "null_backend.h"
+
+#define MAX_FILL 1024
+
+typedef struct
+{
+    const char *name;
+    int antialias;
+    int triangulated; // expected
+    int count;
+    float pts[64];
+} polygon;
+
+static int fillPaths = 0;
+static int fillTriangulated = 0;
+static int fillCount = 0;
+static NVGvertex fill[MAX_FILL];
+
+static void keepFill(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation, NVGscissor *scissor,
+                     float fringe, const float *bounds, const NVGpath *paths, int npaths)
+{
+    NVG_NOTUSED(uptr);
+    NVG_NOTUSED(paint);
+    NVG_NOTUSED(compositeOperation);
+    NVG_NOTUSED(scissor);
+    NVG_NOTUSED(fringe);
+    NVG_NOTUSED(bounds);
+    fillPaths = npaths;
+    fillTriangulated = paths[0].triangulated;
+    fillCount = paths[0].nfill < MAX_FILL ? paths[0].nfill : MAX_FILL;
+    memcpy(fill, paths[0].fill, sizeof(NVGvertex) * fillCount);
+}
+
+NVGcontext *createKeepFill(int antialias)
+{
+    NVGparams params;
+    initNullParams(&params);
+    params.renderFill = keepFill;
+    params.edgeAntiAlias = antialias;
+    params.triangulateFills = 1;
+    return nvgCreateInternal(&params);
+}
+
+// Twice the signed area, with the sign nanovg uses for counter clockwise.
+float area2(float ax, float ay, float bx, float by, float cx, float cy)
+{
+    return (cx - ax) * (by - ay) - (bx - ax) * (cy - ay);
+}
+
+float polygonArea2(const polygon *p)
+{
+    float area = 0.0;
+    for (int i = 2; i < p->count; ++i)
+        area += area2(p->pts[0], p->pts[1], p->pts[i * 2 - 2], p->pts[i * 2 - 1], p->pts[i * 2], p->pts[i * 2 + 1]);
+    return area;
+}
+
+int isCorner(const polygon *p, const NVGvertex *v)
+{
+    for (int i = 0; i < p->count; ++i)
+    {
+        if (p->pts[i * 2] == v->x && p->pts[i * 2 + 1] == v->y)
+            return 1;
+    }
+    return 0;
+}
+
+// Returns 1 if the triangles of the fill match the polygon.
+int checkTriangles(const polygon *p)
+{
+    float area = 0.0;
+    if (fillCount != (p->count - 2) * 3)
+    {
+        printf("%s: %d triangles, expected %d\n", p->name, fillCount / 3, p->count - 2);
+        return 0;
+    }
+    for (int i = 0; i < fillCount; i += 3)
+    {
+        const NVGvertex *a = &fill[i];
+        const NVGvertex *b = &fill[i + 1];
+        const NVGvertex *c = &fill[i + 2];
+        float t = area2(a->x, a->y, b->x, b->y, c->x, c->y);
+        if (t < 0.0)
+        {
+            printf("%s: triangle %d is wound the other way\n", p->name, i / 3);
+            return 0;
+        }
+        if (!isCorner(p, a) || !isCorner(p, b) || !isCorner(p, c))
+        {
+            printf("%s: triangle %d is not made of corners of the polygon\n", p->name, i / 3);
+            return 0;
+        }
+        area += t;
+    }
+    float expected = fabsf(polygonArea2(p));
+    if (fabsf(area - expected) > expected * 1e-5)
+    {
+        printf("%s: triangles cover %g, the polygon %g\n", p->name, area * 0.5, expected * 0.5);
+        return 0;
+    }
+    return 1;
+}
+
+// Fills the polygon, returns 1 if it was drawn as expected.
+int checkPolygon(NVGcontext *vg, const polygon *p)
+{
+    fillPaths = 0;
+    nvgBeginFrame(vg, 400.0, 400.0, 1.0);
+    nvgBeginPath(vg);
+    for (int i = 0; i < p->count; ++i)
+    {
+        if (i == 0)
+            nvgMoveTo(vg, p->pts[i * 2], p->pts[i * 2 + 1]);
+        else
+            nvgLineTo(vg, p->pts[i * 2], p->pts[i * 2 + 1]);
+    }
+    nvgClosePath(vg);
+    // The second contour of "hole" is given after the first count points.
+    if (strcmp(p->name, "hole") == 0)
+    {
+        nvgRect(vg, 40.0, 40.0, 20.0, 20.0);
+        nvgPathWinding(vg, NVG_HOLE);
+    }
+    nvgFillColor(vg, nvgRGBA(255, 255, 255, 255));
+    nvgFill(vg);
+    nvgEndFrame(vg);
+
+    if (fillPaths == 0)
+    {
+        printf("%s: not filled\n", p->name);
+        return 0;
+    }
+    if (fillTriangulated != p->triangulated)
+    {
+        printf("%s: %s, expected %s\n", p->name, fillTriangulated ? "triangulated" : "not triangulated",
+               p->triangulated ? "triangulated" : "the stencil fill");
+        return 0;
+    }
+    if (fillTriangulated && !p->antialias)
+        return checkTriangles(p);
+    return 1;
+}
+
+// Star with k points, the tips get beveled when they are sharper than the miter limit of fills.
+void star(polygon *p, const char *name, int antialias, int triangulated, int k, float inner)
+{
+    p->name = name;
+    p->antialias = antialias;
+    p->triangulated = triangulated;
+    p->count = k * 2;
+    for (int i = 0; i < k * 2; ++i)
+    {
+        float a = i * 3.14159265f / k;
+        float r = (i & 1) ? 80.0 * inner : 80.0;
+        p->pts[i * 2] = 200.0 + cosf(a) * r;
+        p->pts[i * 2 + 1] = 200.0 + sinf(a) * r;
+    }
+}
+
+int main()
+{
+    static polygon polygons[] = {
+        {"L", 0, 1, 6, {10, 10, 10, 110, 110, 110, 110, 70, 50, 70, 50, 10}},
+        {"L clockwise", 0, 1, 6, {10, 10, 50, 10, 50, 70, 110, 70, 110, 110, 10, 110}},
+        {"U", 0, 1, 8, {10, 10, 10, 110, 110, 110, 110, 10, 80, 10, 80, 80, 40, 80, 40, 10}},
+        {"comb", 0, 1, 12, {10, 10, 10, 100, 130, 100, 130, 10, 110, 10, 110, 60, 80, 60, 80, 10, 60, 10, 60, 60, 30, 60, 30, 10}},
+        {"arrow", 0, 1, 7, {10, 40, 10, 70, 60, 70, 60, 100, 110, 55, 60, 10, 60, 40}},
+        {"G", 0, 1, 12, {10, 10, 10, 150, 150, 150, 150, 70, 90, 70, 90, 90, 130, 90, 130, 130, 30, 130, 30, 30, 150, 30, 150, 10}},
+        {"collinear", 0, 1, 8, {10, 10, 10, 60, 10, 110, 110, 110, 110, 70, 50, 70, 50, 40, 50, 10}},
+        {"L antialiased", 1, 1, 6, {10, 10, 10, 110, 110, 110, 110, 70, 50, 70, 50, 10}},
+        {"bowtie", 0, 0, 4, {10, 10, 110, 110, 110, 10, 10, 110}},
+        {"hole", 0, 0, 4, {10, 10, 10, 110, 110, 110, 110, 10}},
+        {"convex", 0, 0, 5, {10, 10, 10, 110, 60, 130, 110, 110, 110, 10}},
+    };
+    int n = sizeof(polygons) / sizeof(polygons[0]);
+    int failed = 0;
+    polygon stars[3];
+
+    star(&stars[0], "star", 0, 1, 8, 0.3);
+    star(&stars[1], "sharp star antialiased", 1, 0, 8, 0.3);
+    star(&stars[2], "round star antialiased", 1, 1, 8, 0.8);
+
+    NVGcontext *plain = createKeepFill(0);
+    NVGcontext *antialiased = createKeepFill(1);
+    if (plain == NULL || antialiased == NULL)
+    {
+        printf("Could not init nanovg.\n");
+        return 2;
+    }
+
+    for (int i = 0; i < n + 3; ++i)
+    {
+        const polygon *p = i < n ? &polygons[i] : &stars[i - n];
+        if (!checkPolygon(p->antialias ? antialiased : plain, p))
+            failed = 1;
+    }
+
+    nvgDeleteInternal(plain);
+    nvgDeleteInternal(antialiased);
+
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
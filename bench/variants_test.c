@@ -0,0 +1,146 @@
+// Checks that every shader variant of NVG_SHADER_VARIANTS compiles and links on a real
+// GL driver. The recording stub of bench.c reports every shader as compiled, so the
+// variants are built here through EGL without a window, on whatever driver EGL gives,
+// llvmpipe on machines without a GPU. A context is created for every set of flags
+// which changes the shader source, nvgCreateGL3 fails on the first shader error and
+// the error is printed by the back-end.
+//
+// Built with -DVARIANTS_GL2 the GL2 back-end is checked instead, its shaders keep the
+// paints in a uniform array rather than a uniform block.
+//
+//   variants_test
+//
+// Exits with 77 when there is no EGL display or GL context, so that a machine without
+// GL can skip the test.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#define GL_GLEXT_PROTOTYPES
+#ifdef VARIANTS_GL2
+#include <GL/gl.h>
+#include <GL/glext.h>
+#else
+#include <GL/glcorearb.h>
+#endif
+#include "../nanovg/nanovg.h"
+#ifdef VARIANTS_GL2
+#define NANOVG_GL2_IMPLEMENTATION
+#define nvgCreateGL nvgCreateGL2
+#define nvgDeleteGL nvgDeleteGL2
+#else
+#define NANOVG_GL3_IMPLEMENTATION
+#define nvgCreateGL nvgCreateGL3
+#define nvgDeleteGL nvgDeleteGL3
+#endif
+#include "../nanovg/nanovg_gl.h"
+
+#define SKIPPED 77
+
+typedef struct
+{
+    const char *name;
+    int flags;
+} config;
+
+// NVG_ANTIALIAS is the only flag which changes the shader source, the others are there
+// to build the variants next to the rest of the optional paths.
+static const config configs[] = {
+    {"antialias", NVG_ANTIALIAS | NVG_SHADER_VARIANTS},
+    {"aliased", NVG_SHADER_VARIANTS},
+    {"all", NVG_ANTIALIAS | NVG_STENCIL_STROKES | NVG_SHADER_VARIANTS | NVG_RING_BUFFERS | NVG_TRIANGULATE_FILLS |
+                NVG_IMAGE_ATLAS | NVG_ASYNC_UPLOADS},
+};
+
+// Makes a GL context current without a surface, returns 0 if there is none.
+int initContext()
+{
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLint major, minor, n = 0;
+    EGLConfig c;
+    EGLint configAttribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+#ifdef VARIANTS_GL2
+    EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION, 2, EGL_CONTEXT_MINOR_VERSION, 0, EGL_NONE};
+#else
+    EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                               3,
+                               EGL_CONTEXT_MINOR_VERSION,
+                               3,
+                               EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                               EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                               EGL_NONE};
+#endif
+
+    if (getPlatformDisplay != NULL)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+        return 0;
+    eglChooseConfig(display, configAttribs, &c, 1, &n);
+    if (!eglBindAPI(EGL_OPENGL_API))
+        return 0;
+    EGLContext context = eglCreateContext(display, n > 0 ? c : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT)
+        return 0;
+    return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+// Returns the number of variants which are missing or did not link.
+int checkVariants(NVGcontext *vg, const char *name)
+{
+    GLNVGcontext *gl = (GLNVGcontext *)nvgInternalParams(vg)->userPtr;
+    int failed = 0;
+    for (int i = 0; i < GLNVG_VARIANT_COUNT; ++i)
+    {
+        GLint status = GL_FALSE;
+        // The stencil pass variant is only built without scissor.
+        if (i / 2 == GLNVG_VARIANT_SIMPLE && (i & 1))
+            continue;
+        if (gl->variants[i].prog == 0)
+        {
+            printf("%s: variant %d was not built\n", name, i);
+            failed++;
+            continue;
+        }
+        glGetProgramiv(gl->variants[i].prog, GL_LINK_STATUS, &status);
+        if (status != GL_TRUE)
+        {
+            printf("%s: variant %d did not link\n", name, i);
+            failed++;
+        }
+    }
+    return failed;
+}
+
+int main()
+{
+    int failed = 0;
+
+    if (!initContext())
+    {
+        printf("variants: skipped, no GL context\n");
+        return SKIPPED;
+    }
+    printf("variants: %s, %s\n", (const char *)glGetString(GL_RENDERER), (const char *)glGetString(GL_VERSION));
+
+    for (int i = 0; i < (int)(sizeof(configs) / sizeof(configs[0])); ++i)
+    {
+        NVGcontext *vg = nvgCreateGL(configs[i].flags);
+        if (vg == NULL)
+        {
+            printf("%s: could not init nanovg, a shader did not compile or link\n", configs[i].name);
+            failed = 1;
+            continue;
+        }
+        if (checkVariants(vg, configs[i].name) != 0)
+            failed = 1;
+        nvgDeleteGL(vg);
+    }
+
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
@@ -24,6 +24,9 @@
 enum FONSflags {
 	FONS_ZERO_TOPLEFT = 1,
 	FONS_ZERO_BOTTOMLEFT = 2,
+	// Glyphs missing from the atlas get their rect right away, but are rasterized later
+	// by fonsRasterizeGlyphs(), see fonsSetAsyncGlyphs().
+	FONS_ASYNC_GLYPHS = 4,
 };
 
 enum FONSalign {
@@ -73,6 +76,19 @@ struct FONSquad
 };
 typedef struct FONSquad FONSquad;
 
+struct FONSstate
+{
+	int font;
+	int align;
+	float size;
+	unsigned int color;
+	float blur;
+	float spacing;
+	int sdf;
+	int subpixel;
+};
+typedef struct FONSstate FONSstate;
+
 struct FONStextIter {
 	float x, y, nextx, nexty, scale, spacing;
 	unsigned int codepoint;
@@ -84,6 +100,11 @@ struct FONStextIter {
 	const char* end;
 	unsigned int utf8state;
 	int bitmapOption;
+	float sdfScale;	// Scale from distance field glyphs to the text size, 0 when glyphs are rasterized at the text size.
+	int subpixel;	// Glyphs are placed at subpixel positions.
+	int pending;	// The bitmap of the current glyph is not rasterized yet, its quad should not be drawn.
+	int entry;		// Atlas entry of the current glyph with FONS_GLYPH_BITMAP_REQUIRED, -1 otherwise, see fonsTouchGlyph().
+	unsigned int serial;
 };
 typedef struct FONStextIter FONStextIter;
 
@@ -100,6 +121,19 @@ void fonsGetAtlasSize(FONScontext* s, int* width, int* height);
 int fonsExpandAtlas(FONScontext* s, int width, int height);
 // Resets the whole stash.
 int fonsResetAtlas(FONScontext* stash, int width, int height);
+// Repacks the glyphs in the atlas into a width x height atlas. The most recently drawn ones filling
+// up to 3/4 of it are kept, the rest is evicted. The whole atlas is reported dirty, so the texture
+// is updated at once.
+int fonsCompactAtlas(FONScontext* stash, int width, int height);
+// Ends a frame of drawing. When the atlas is full, glyphs not drawn in the last FONS_EVICT_FRAMES
+// frames are evicted to make room, least recently drawn first, and their space is reused. Every few
+// frames the atlas is compacted if evictions have fragmented it, and memory of replaced glyphs is freed.
+// Without calls to it glyphs are never evicted and stay in the atlas until it is reset.
+void fonsEndFrame(FONScontext* stash);
+// Marks the glyph of a quad that was kept from an earlier frame, identified by the 'entry' and 'serial'
+// of the text iterator, as drawn in this frame. Returns 0 if the glyph has been evicted or moved since,
+// the quad must not be drawn then.
+int fonsTouchGlyph(FONScontext* stash, int entry, unsigned int serial);
 
 // Add fonts
 int fonsAddFont(FONScontext* s, const char* name, const char* path, int fontIndex);
@@ -118,6 +152,16 @@ void fonsSetSpacing(FONScontext* s, float spacing);
 void fonsSetBlur(FONScontext* s, float blur);
 void fonsSetAlign(FONScontext* s, int align);
 void fonsSetFont(FONScontext* s, int font);
+// Sets whether text is laid out with signed distance field glyphs, which are rasterized once at
+// FONS_SDF_SIZE and scaled to the text size. Blur does not apply to them. The atlas then holds
+// distances, 0.5 at the glyph edge, which the renderer has to threshold, so fonsDrawText() ignores it.
+// Only the stb_truetype back-end creates distance fields.
+void fonsSetSDF(FONScontext* s, int sdf);
+// Sets whether glyphs are placed at 1/FONS_SUBPIXEL_STEPS pixel horizontal positions instead of whole
+// pixels, so that slowly moving text does not jump from pixel to pixel. Each glyph then takes up to
+// FONS_SUBPIXEL_STEPS bitmaps in the atlas, one per offset it is drawn at. Blurred and distance field
+// glyphs are not affected. Only the stb_truetype back-end shifts glyphs.
+void fonsSetSubpixel(FONScontext* s, int subpixel);
 
 // Draw text
 float fonsDrawText(FONScontext* s, float x, float y, const char* string, const char* end);
@@ -131,6 +175,30 @@ void fonsVertMetrics(FONScontext* s, float* ascender, float* descender, float* l
 int fonsTextIterInit(FONScontext* stash, FONStextIter* iter, float x, float y, const char* str, const char* end, int bitmapOption);
 int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, struct FONSquad* quad);
 
+// Measuring with the specified state instead of the state stack. Cached glyphs are looked up without
+// locking and missing glyph metrics are added under a lock, so these and iterating with
+// FONS_GLYPH_BITMAP_OPTIONAL can be called from several threads at once, also while an other thread
+// draws. Fonts must not be added, fonsEndFrame() must not be called and the atlas or fallbacks must
+// not be reset or compacted meanwhile.
+// Only the stb_truetype back-end is thread safe, FreeType faces are not.
+float fonsTextBoundsState(FONScontext* s, const FONSstate* state, float x, float y, const char* string, const char* end, float* bounds);
+void fonsLineBoundsState(FONScontext* s, const FONSstate* state, float y, float* miny, float* maxy);
+void fonsVertMetricsState(FONScontext* s, const FONSstate* state, float* ascender, float* descender, float* lineh);
+int fonsTextIterInitState(FONScontext* stash, const FONSstate* state, FONStextIter* iter, float x, float y, const char* str, const char* end, int bitmapOption);
+
+// Asynchronous rasterization. When enabled, glyphs missing from the atlas are queued instead of
+// rasterized when drawn, and are left out (the text iterator sets 'pending') until their bitmap has
+// been rasterized by fonsRasterizeGlyphs() and copied to the atlas by fonsValidateTexture().
+// fonsRasterizeGlyphs() can be called from several worker threads at once, also while an other
+// thread draws, it processes up to maxGlyphs queued glyphs (all if maxGlyphs <= 0) and returns
+// how many it did. Only the stb_truetype back-end rasterizes asynchronously.
+void fonsSetAsyncGlyphs(FONScontext* s, int enabled);
+int fonsRasterizeGlyphs(FONScontext* s, int maxGlyphs);
+// Adds the glyphs of codepoints first..last in the current font, size and blur to the atlas ahead
+// of time, codepoints missing from the font and its fallbacks are skipped. With subpixel positioning
+// all FONS_SUBPIXEL_STEPS bitmaps of each glyph are added. Returns 0 if the atlas is full.
+int fonsPrewarmGlyphs(FONScontext* s, unsigned int first, unsigned int last);
+
 // Pull texture changes
 const unsigned char* fonsGetTextureData(FONScontext* stash, int* width, int* height);
 int fonsValidateTexture(FONScontext* s, int* dirty);
@@ -145,6 +213,15 @@ void fonsDrawDebug(FONScontext* s, float x, float y);
 
 #define FONS_NOTUSED(v)  (void)sizeof(v)
 
+// Memory used while rasterizing a glyph, the stash has one and each fonsRasterizeGlyphs() call its own.
+struct FONSscratch
+{
+	FONScontext* stash;
+	unsigned char* data;
+	int ndata;
+};
+typedef struct FONSscratch FONSscratch;
+
 #ifdef FONS_USE_FREETYPE
 
 #include <ft2build.h>
@@ -185,6 +262,28 @@ int fons__tt_loadFont(FONScontext *context, FONSttFontImpl *font, unsigned char
 	return ftError == 0;
 }
 
+void fons__tt_setScratch(FONSttFontImpl *font, FONSscratch *scratch)
+{
+	FONS_NOTUSED(font);
+	FONS_NOTUSED(scratch);
+}
+
+int fons__tt_renderGlyphSDF(FONSttFontImpl *font, unsigned char *output, int outWidth, int outHeight, int outStride,
+							float scale, int padding, int onedge, float distScale, int glyph)
+{
+	FONS_NOTUSED(font);
+	FONS_NOTUSED(output);
+	FONS_NOTUSED(outWidth);
+	FONS_NOTUSED(outHeight);
+	FONS_NOTUSED(outStride);
+	FONS_NOTUSED(scale);
+	FONS_NOTUSED(padding);
+	FONS_NOTUSED(onedge);
+	FONS_NOTUSED(distScale);
+	FONS_NOTUSED(glyph);
+	return 0;
+}
+
 void fons__tt_getFontVMetrics(FONSttFontImpl *font, int *ascent, int *descent, int *lineGap)
 {
 	*ascent = font->font->ascender;
@@ -202,13 +301,14 @@ int fons__tt_getGlyphIndex(FONSttFontImpl *font, int codepoint)
 	return FT_Get_Char_Index(font->font, codepoint);
 }
 
-int fons__tt_buildGlyphBitmap(FONSttFontImpl *font, int glyph, float size, float scale,
+int fons__tt_buildGlyphBitmap(FONSttFontImpl *font, int glyph, float size, float scale, float shiftX,
 							  int *advance, int *lsb, int *x0, int *y0, int *x1, int *y1)
 {
 	FT_Error ftError;
 	FT_GlyphSlot ftGlyph;
 	FT_Fixed advFixed;
 	FONS_NOTUSED(scale);
+	FONS_NOTUSED(shiftX);
 
 	ftError = FT_Set_Pixel_Sizes(font->font, 0, size);
 	if (ftError) return 0;
@@ -227,7 +327,7 @@ int fons__tt_buildGlyphBitmap(FONSttFontImpl *font, int glyph, float size, float
 }
 
 void fons__tt_renderGlyphBitmap(FONSttFontImpl *font, unsigned char *output, int outWidth, int outHeight, int outStride,
-								float scaleX, float scaleY, int glyph)
+								float scaleX, float scaleY, float shiftX, int glyph)
 {
 	FT_GlyphSlot ftGlyph = font->font->glyph;
 	int ftGlyphOffset = 0;
@@ -236,6 +336,7 @@ void fons__tt_renderGlyphBitmap(FONSttFontImpl *font, unsigned char *output, int
 	FONS_NOTUSED(outHeight);
 	FONS_NOTUSED(scaleX);
 	FONS_NOTUSED(scaleY);
+	FONS_NOTUSED(shiftX);
 	FONS_NOTUSED(glyph);	// glyph has already been loaded by fons__tt_buildGlyphBitmap
 
 	for ( y = 0; y < ftGlyph->bitmap.rows; y++ ) {
@@ -281,9 +382,9 @@ int fons__tt_done(FONScontext *context)
 int fons__tt_loadFont(FONScontext *context, FONSttFontImpl *font, unsigned char *data, int dataSize, int fontIndex)
 {
 	int offset, stbError;
+	FONS_NOTUSED(context);
 	FONS_NOTUSED(dataSize);
 
-	font->font.userdata = context;
 	offset = stbtt_GetFontOffsetForIndex(data, fontIndex);
 	if (offset == -1) {
 		stbError = 0;
@@ -293,6 +394,11 @@ int fons__tt_loadFont(FONScontext *context, FONSttFontImpl *font, unsigned char
 	return stbError;
 }
 
+void fons__tt_setScratch(FONSttFontImpl *font, FONSscratch *scratch)
+{
+	font->font.userdata = scratch;
+}
+
 void fons__tt_getFontVMetrics(FONSttFontImpl *font, int *ascent, int *descent, int *lineGap)
 {
 	stbtt_GetFontVMetrics(&font->font, ascent, descent, lineGap);
@@ -308,19 +414,34 @@ int fons__tt_getGlyphIndex(FONSttFontImpl *font, int codepoint)
 	return stbtt_FindGlyphIndex(&font->font, codepoint);
 }
 
-int fons__tt_buildGlyphBitmap(FONSttFontImpl *font, int glyph, float size, float scale,
+int fons__tt_buildGlyphBitmap(FONSttFontImpl *font, int glyph, float size, float scale, float shiftX,
 							  int *advance, int *lsb, int *x0, int *y0, int *x1, int *y1)
 {
 	FONS_NOTUSED(size);
 	stbtt_GetGlyphHMetrics(&font->font, glyph, advance, lsb);
-	stbtt_GetGlyphBitmapBox(&font->font, glyph, scale, scale, x0, y0, x1, y1);
+	stbtt_GetGlyphBitmapBoxSubpixel(&font->font, glyph, scale, scale, shiftX, 0.0f, x0, y0, x1, y1);
 	return 1;
 }
 
 void fons__tt_renderGlyphBitmap(FONSttFontImpl *font, unsigned char *output, int outWidth, int outHeight, int outStride,
-								float scaleX, float scaleY, int glyph)
+								float scaleX, float scaleY, float shiftX, int glyph)
+{
+	stbtt_MakeGlyphBitmapSubpixel(&font->font, output, outWidth, outHeight, outStride, scaleX, scaleY, shiftX, 0.0f, glyph);
+}
+
+int fons__tt_renderGlyphSDF(FONSttFontImpl *font, unsigned char *output, int outWidth, int outHeight, int outStride,
+							float scale, int padding, int onedge, float distScale, int glyph)
 {
-	stbtt_MakeGlyphBitmap(&font->font, output, outWidth, outHeight, outStride, scaleX, scaleY, glyph);
+	int x, y, w, h, xoff, yoff;
+	unsigned char* sdf = stbtt_GetGlyphSDF(&font->font, scale, glyph, padding, (unsigned char)onedge, distScale, &w, &h, &xoff, &yoff);
+	// Empty glyphs have no distance field.
+	if (sdf == NULL) return 0;
+	for (y = 0; y < h && y < outHeight; y++) {
+		for (x = 0; x < w && x < outWidth; x++)
+			output[x + y*outStride] = sdf[x + y*w];
+	}
+	stbtt_FreeSDF(sdf, font->font.userdata);
+	return 1;
 }
 
 int fons__tt_getGlyphKernAdvance(FONSttFontImpl *font, int glyph1, int glyph2)
@@ -333,18 +454,41 @@ int fons__tt_getGlyphKernAdvance(FONSttFontImpl *font, int glyph1, int glyph2)
 #ifndef FONS_SCRATCH_BUF_SIZE
 #	define FONS_SCRATCH_BUF_SIZE 96000
 #endif
+#ifndef FONS_SDF_SIZE
+#	define FONS_SDF_SIZE 48	// Pixel size distance field glyphs are rasterized at.
+#endif
+#ifndef FONS_SDF_PAD
+#	define FONS_SDF_PAD 6	// Distance in pixels at FONS_SDF_SIZE over which the field goes from the edge to 0.
+#endif
+#define FONS_SDF_EDGE 128	// Field value at the glyph edge.
+#define FONS_SDF_BLUR -1	// Blur of distance field glyphs in the glyph key.
+#ifndef FONS_SUBPIXEL_STEPS
+#	define FONS_SUBPIXEL_STEPS 4	// Horizontal glyph positions per pixel with subpixel positioning, and bitmaps per glyph, must be power of two.
+#endif
 #ifndef FONS_HASH_LUT_SIZE
-#	define FONS_HASH_LUT_SIZE 256
+#	define FONS_HASH_LUT_SIZE 256	// Initial glyph table size, must be power of two.
 #endif
 #ifndef FONS_INIT_FONTS
 #	define FONS_INIT_FONTS 4
 #endif
+#ifndef FONS_KERN_CACHE_SIZE
+#	define FONS_KERN_CACHE_SIZE 4096	// Kerning pairs cached per font, must be power of two.
+#endif
 #ifndef FONS_INIT_GLYPHS
-#	define FONS_INIT_GLYPHS 256
+#	define FONS_INIT_GLYPHS 256	// Glyphs per storage block.
 #endif
 #ifndef FONS_INIT_ATLAS_NODES
 #	define FONS_INIT_ATLAS_NODES 256
 #endif
+#ifndef FONS_COMPACT_FRAMES
+#	define FONS_COMPACT_FRAMES 60	// Minimum number of frames between compacting the atlas.
+#endif
+#ifndef FONS_EVICT_FRAMES
+#	define FONS_EVICT_FRAMES 60	// Glyphs drawn in this many last frames are not evicted, the atlas has to grow instead.
+#endif
+#ifndef FONS_EVICT_CANDIDATES
+#	define FONS_EVICT_CANDIDATES 8	// Number of least recently drawn glyphs tried as place for a new glyph.
+#endif
 #ifndef FONS_VERTEX_COUNT
 #	define FONS_VERTEX_COUNT 1024
 #endif
@@ -354,6 +498,9 @@ int fons__tt_getGlyphKernAdvance(FONSttFontImpl *font, int glyph1, int glyph2)
 #ifndef FONS_MAX_FALLBACKS
 #	define FONS_MAX_FALLBACKS 20
 #endif
+#ifndef FONS_LOCK_SPINS
+#	define FONS_LOCK_SPINS 64	// Spins on a taken lock before waiting threads start to yield their time slice.
+#endif
 
 static unsigned int fons__hashint(unsigned int a)
 {
@@ -366,6 +513,90 @@ static unsigned int fons__hashint(unsigned int a)
 	return a;
 }
 
+// Glyph tables are read without locking, glyphs are published with release stores and
+// writers are serialized with a spin lock. A waiting writer pauses between checks of the lock
+// and yields its time slice once it has spun FONS_LOCK_SPINS times.
+#if defined(_MSC_VER)
+#include <intrin.h>
+static void* fons__loadPtr(void* volatile* p) { return _InterlockedCompareExchangePointer(p, NULL, NULL); }
+static void fons__storePtr(void* volatile* p, void* v) { _InterlockedExchangePointer(p, v); }
+static unsigned long long fons__loadU64(volatile unsigned long long* p) { return (unsigned long long)_InterlockedCompareExchange64((volatile __int64*)p, 0, 0); }
+static void fons__storeU64(volatile unsigned long long* p, unsigned long long v) { _InterlockedExchange64((volatile __int64*)p, (__int64)v); }
+__declspec(dllimport) int __stdcall SwitchToThread(void);
+static void fons__pause(void)
+{
+#if defined(_M_IX86) || defined(_M_X64)
+	_mm_pause();
+#elif defined(_M_ARM) || defined(_M_ARM64)
+	__yield();
+#endif
+}
+static void fons__lock(volatile long* lock)
+{
+	int spins = 0;
+	while (_InterlockedExchange(lock, 1) != 0) {
+		while (*lock != 0) {
+			if (spins < FONS_LOCK_SPINS) {
+				fons__pause();
+				spins++;
+			} else {
+				SwitchToThread();
+			}
+		}
+	}
+}
+static void fons__unlock(volatile long* lock) { _InterlockedExchange(lock, 0); }
+#elif defined(__GNUC__)
+#ifdef _WIN32
+__declspec(dllimport) int __stdcall SwitchToThread(void);
+#else
+#include <sched.h>
+#endif
+static void* fons__loadPtr(void* volatile* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static void fons__storePtr(void* volatile* p, void* v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+static unsigned long long fons__loadU64(volatile unsigned long long* p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+static void fons__storeU64(volatile unsigned long long* p, unsigned long long v) { __atomic_store_n(p, v, __ATOMIC_RELAXED); }
+static void fons__pause(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+static void fons__yield(void)
+{
+#ifdef _WIN32
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+static void fons__lock(volatile long* lock)
+{
+	int spins = 0;
+	while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE) != 0) {
+		while (__atomic_load_n(lock, __ATOMIC_RELAXED) != 0) {
+			if (spins < FONS_LOCK_SPINS) {
+				fons__pause();
+				spins++;
+			} else {
+				fons__yield();
+			}
+		}
+	}
+}
+static void fons__unlock(volatile long* lock) { __atomic_store_n(lock, 0, __ATOMIC_RELEASE); }
+#else
+// No atomics, single threaded use only.
+static void* fons__loadPtr(void* volatile* p) { return *p; }
+static void fons__storePtr(void* volatile* p, void* v) { *p = v; }
+static unsigned long long fons__loadU64(volatile unsigned long long* p) { return *p; }
+static void fons__storeU64(volatile unsigned long long* p, unsigned long long v) { *p = v; }
+static void fons__lock(volatile long* lock) { *lock = 1; }
+static void fons__unlock(volatile long* lock) { *lock = 0; }
+#endif
+
 static int fons__mini(int a, int b)
 {
 	return a < b ? a : b;
@@ -380,13 +611,35 @@ struct FONSglyph
 {
 	unsigned int codepoint;
 	int index;
-	int next;
 	short size, blur;
+	short phase;	// Horizontal offset the bitmap is rasterized at, in 1/FONS_SUBPIXEL_STEPS pixels.
 	short x0,y0,x1,y1;
 	short xadv,xoff,yoff;
+	short pending;	// The atlas rect is reserved, but the bitmap is not rasterized yet.
+	int entry;		// Atlas entry of the bitmap, -1 if there is none.
 };
 typedef struct FONSglyph FONSglyph;
 
+// Glyphs are allocated in blocks and never move, readers may hold on to them until the glyphs are reset.
+struct FONSglyphBlock
+{
+	struct FONSglyphBlock* next;
+	int nglyphs;
+	FONSglyph glyphs[FONS_INIT_GLYPHS];
+};
+typedef struct FONSglyphBlock FONSglyphBlock;
+
+// Open addressing hash table of glyphs. When it fills up, it is replaced by a larger copy and
+// the old one is kept until the glyphs are reset, as readers may still be walking it.
+struct FONSglyphTable
+{
+	struct FONSglyphTable* retired;
+	int cslots;
+	int nglyphs;
+	FONSglyph** slots;
+};
+typedef struct FONSglyphTable FONSglyphTable;
+
 struct FONSfont
 {
 	FONSttFontImpl font;
@@ -397,40 +650,80 @@ struct FONSfont
 	float ascender;
 	float descender;
 	float lineh;
-	FONSglyph* glyphs;
-	int cglyphs;
-	int nglyphs;
-	int lut[FONS_HASH_LUT_SIZE];
+	FONSglyphTable* table;
+	FONSglyphBlock* blocks;
+	int nretired;	// Glyphs in the blocks that have been replaced in the table.
+	volatile unsigned long long* kern;	// Kerning pairs looked up so far, allocated on first use.
 	int fallbacks[FONS_MAX_FALLBACKS];
 	int nfallbacks;
 };
 typedef struct FONSfont FONSfont;
 
-struct FONSstate
+enum FONSjobState {
+	FONS_JOB_QUEUED,
+	FONS_JOB_RUNNING,
+	FONS_JOB_DONE,
+};
+
+// Glyph rasterized by a worker into its own bitmap, which the drawing thread copies to the atlas.
+// Once queued, only the state changes, and the glyph which is cleared when the glyphs are reset.
+struct FONSglyphJob
 {
-	int font;
-	int align;
-	float size;
-	unsigned int color;
-	float blur;
-	float spacing;
+	FONSglyph* glyph;
+	FONSfont* font;
+	FONSfont* renderFont;
+	int index;
+	float scale;
+	float shift;
+	int width, height;
+	int pad, blur;
+	int state;
+	unsigned char* bitmap;
 };
-typedef struct FONSstate FONSstate;
+typedef struct FONSglyphJob FONSglyphJob;
 
 struct FONSatlasNode {
     short x, y, width;
 };
 typedef struct FONSatlasNode FONSatlasNode;
 
+struct FONSatlasRect {
+	short x, y, width, height;
+};
+typedef struct FONSatlasRect FONSatlasRect;
+
 struct FONSatlas
 {
 	int width, height;
 	FONSatlasNode* nodes;
 	int nnodes;
 	int cnodes;
+	FONSatlasRect* rects;	// Free space under the skyline left by evicted glyphs.
+	int nrects;
+	int crects;
+	int freeArea;
 };
 typedef struct FONSatlas FONSatlas;
 
+// Glyph bitmap in the atlas. Only used by the drawing thread.
+struct FONSatlasEntry
+{
+	FONSfont* font;
+	FONSglyph* glyph;		// Current glyph of the bitmap, NULL if the entry is free.
+	short x, y;
+	int used;				// Frame the glyph was last drawn in.
+	unsigned int serial;	// Changes whenever the bitmap is placed.
+	int next;				// Next free entry.
+};
+typedef struct FONSatlasEntry FONSatlasEntry;
+
+struct FONSlruItem
+{
+	int key;
+	int entry;
+};
+typedef struct FONSlruItem FONSlruItem;
+
 struct FONScontext
 {
 	FONSparams params;
@@ -445,8 +738,23 @@ struct FONScontext
 	float tcoords[FONS_VERTEX_COUNT*2];
 	unsigned int colors[FONS_VERTEX_COUNT];
 	int nverts;
-	unsigned char* scratch;
-	int nscratch;
+	FONSscratch scratch;		// Used by rasterization on the drawing thread.
+	volatile long lock;			// Serializes adding glyphs and guards the job queue.
+	FONSglyphJob** jobs;		// Glyphs waiting for or in asynchronous rasterization.
+	int njobs;					// Only changed by the drawing thread.
+	int cjobs;
+	FONSatlasEntry* entries;
+	int nentries;
+	int centries;
+	int freeEntry;
+	unsigned int serial;
+	int frame;
+	int compactFrame;			// Frame the atlas was last compacted in.
+	FONSlruItem* lru;			// Eviction candidates of this frame, least recently used first.
+	int nlru;
+	int clru;
+	int lruPos;
+	int lruFrame;
 	FONSstate states[FONS_MAX_STATES];
 	int nstates;
 	void (*handleError)(void* uptr, int error, int val);
@@ -458,18 +766,19 @@ struct FONScontext
 static void* fons__tmpalloc(size_t size, void* up)
 {
 	unsigned char* ptr;
-	FONScontext* stash = (FONScontext*)up;
+	FONSscratch* scratch = (FONSscratch*)up;
+	FONScontext* stash = scratch->stash;
 
 	// 16-byte align the returned pointer
 	size = (size + 0xf) & ~0xf;
 
-	if (stash->nscratch+(int)size > FONS_SCRATCH_BUF_SIZE) {
+	if (scratch->ndata+(int)size > FONS_SCRATCH_BUF_SIZE) {
 		if (stash->handleError)
-			stash->handleError(stash->errorUptr, FONS_SCRATCH_FULL, stash->nscratch+(int)size);
+			stash->handleError(stash->errorUptr, FONS_SCRATCH_FULL, scratch->ndata+(int)size);
 		return NULL;
 	}
-	ptr = stash->scratch + stash->nscratch;
-	stash->nscratch += (int)size;
+	ptr = scratch->data + scratch->ndata;
+	scratch->ndata += (int)size;
 	return ptr;
 }
 
@@ -527,6 +836,7 @@ static void fons__deleteAtlas(FONSatlas* atlas)
 {
 	if (atlas == NULL) return;
 	if (atlas->nodes != NULL) free(atlas->nodes);
+	if (atlas->rects != NULL) free(atlas->rects);
 	free(atlas);
 }
 
@@ -562,15 +872,18 @@ error:
 	return NULL;
 }
 
+// The image atlas of nanovg_gl.h has a copy of the skyline code, fixes to it apply to both.
 static int fons__atlasInsertNode(FONSatlas* atlas, int idx, int x, int y, int w)
 {
 	int i;
 	// Insert node
 	if (atlas->nnodes+1 > atlas->cnodes) {
-		atlas->cnodes = atlas->cnodes == 0 ? 8 : atlas->cnodes * 2;
-		atlas->nodes = (FONSatlasNode*)realloc(atlas->nodes, sizeof(FONSatlasNode) * atlas->cnodes);
-		if (atlas->nodes == NULL)
+		int cnodes = atlas->cnodes == 0 ? 8 : atlas->cnodes * 2;
+		FONSatlasNode* nodes = (FONSatlasNode*)realloc(atlas->nodes, sizeof(FONSatlasNode) * cnodes);
+		if (nodes == NULL)
 			return 0;
+		atlas->nodes = nodes;
+		atlas->cnodes = cnodes;
 	}
 	for (i = atlas->nnodes; i > idx; i--)
 		atlas->nodes[i] = atlas->nodes[i-1];
@@ -605,6 +918,8 @@ static void fons__atlasReset(FONSatlas* atlas, int w, int h)
 	atlas->width = w;
 	atlas->height = h;
 	atlas->nnodes = 0;
+	atlas->nrects = 0;
+	atlas->freeArea = 0;
 
 	// Init root node.
 	atlas->nodes[0].x = 0;
@@ -671,11 +986,187 @@ static int fons__atlasRectFits(FONSatlas* atlas, int i, int w, int h)
 	return y;
 }
 
+static int fons__atlasPushRect(FONSatlas* atlas, int x, int y, int w, int h)
+{
+	// Slivers can not hold a glyph with its padding.
+	if (w < 4 || h < 4)
+		return 1;
+	if (atlas->nrects+1 > atlas->crects) {
+		int crects = atlas->crects == 0 ? 64 : atlas->crects * 2;
+		FONSatlasRect* rects = (FONSatlasRect*)realloc(atlas->rects, sizeof(FONSatlasRect) * crects);
+		if (rects == NULL)
+			return 0;
+		atlas->rects = rects;
+		atlas->crects = crects;
+	}
+	atlas->rects[atlas->nrects].x = (short)x;
+	atlas->rects[atlas->nrects].y = (short)y;
+	atlas->rects[atlas->nrects].width = (short)w;
+	atlas->rects[atlas->nrects].height = (short)h;
+	atlas->nrects++;
+	atlas->freeArea += w*h;
+	return 1;
+}
+
+// Places the rect in the smallest free rect it fits in, the rest is split in two along the longer side.
+static int fons__atlasAddFreeRect(FONSatlas* atlas, int rw, int rh, int* rx, int* ry)
+{
+	int i, besti = -1, besta = 0;
+	FONSatlasRect r;
+
+	for (i = 0; i < atlas->nrects; i++) {
+		int a = atlas->rects[i].width * atlas->rects[i].height;
+		if (atlas->rects[i].width >= rw && atlas->rects[i].height >= rh && (besti == -1 || a < besta)) {
+			besti = i;
+			besta = a;
+		}
+	}
+	if (besti == -1)
+		return 0;
+
+	r = atlas->rects[besti];
+	atlas->rects[besti] = atlas->rects[--atlas->nrects];
+	atlas->freeArea -= r.width * r.height;
+	if (r.width - rw > r.height - rh) {
+		fons__atlasPushRect(atlas, r.x+rw, r.y, r.width-rw, r.height);
+		fons__atlasPushRect(atlas, r.x, r.y+rh, rw, r.height-rh);
+	} else {
+		fons__atlasPushRect(atlas, r.x, r.y+rh, r.width, r.height-rh);
+		fons__atlasPushRect(atlas, r.x+rw, r.y, r.width-rw, rh);
+	}
+	*rx = r.x;
+	*ry = r.y;
+	return 1;
+}
+
+// Returns the rect to the atlas. If it is at the top of the skyline, the skyline is lowered below it,
+// otherwise it is kept as free rect.
+static int fons__atlasFreeRect(FONSatlas* atlas, int x, int y, int w, int h)
+{
+	int i, first = -1;
+
+	for (i = 0; i < atlas->nnodes; i++) {
+		FONSatlasNode* n = &atlas->nodes[i];
+		if (n->x + n->width <= x || n->x >= x + w)
+			continue;
+		if (n->y != y + h)
+			return fons__atlasPushRect(atlas, x, y, w, h);
+		if (first == -1)
+			first = i;
+	}
+	if (first == -1)
+		return fons__atlasPushRect(atlas, x, y, w, h);
+
+	// Split the nodes at the edges of the rect.
+	if (atlas->nodes[first].x < x) {
+		int dx = x - atlas->nodes[first].x;
+		if (fons__atlasInsertNode(atlas, first+1, x, y + h, atlas->nodes[first].width - dx) == 0)
+			return 0;
+		atlas->nodes[first].width = (short)dx;
+		first++;
+	}
+	for (i = first; i < atlas->nnodes && atlas->nodes[i].x < x + w; i++) {
+		FONSatlasNode* n = &atlas->nodes[i];
+		if (n->x + n->width > x + w) {
+			int dx = x + w - n->x;
+			if (fons__atlasInsertNode(atlas, i+1, x + w, y + h, n->width - dx) == 0)
+				return 0;
+			atlas->nodes[i].width = (short)dx;
+		}
+		atlas->nodes[i].y = (short)y;
+	}
+
+	// Merge same height skyline segments that are next to each other.
+	for (i = 0; i < atlas->nnodes-1; i++) {
+		if (atlas->nodes[i].y == atlas->nodes[i+1].y) {
+			atlas->nodes[i].width += atlas->nodes[i+1].width;
+			fons__atlasRemoveNode(atlas, i+1);
+			i--;
+		}
+	}
+	return 1;
+}
+
+// Returns the parts of the rect outside the region to the atlas.
+static int fons__atlasFreeOutside(FONSatlas* atlas, int x, int y, int w, int h, const FONSatlasRect* r)
+{
+	int x0, y0, x1, y1, ok = 1;
+	if (r == NULL)
+		return fons__atlasFreeRect(atlas, x, y, w, h);
+	x0 = fons__maxi(x, r->x);
+	y0 = fons__maxi(y, r->y);
+	x1 = fons__mini(x + w, r->x + r->width);
+	y1 = fons__mini(y + h, r->y + r->height);
+	if (x0 >= x1 || y0 >= y1)
+		return fons__atlasFreeRect(atlas, x, y, w, h);
+	if (x0 > x)
+		ok &= fons__atlasFreeRect(atlas, x, y, x0 - x, h);
+	if (x1 < x + w)
+		ok &= fons__atlasFreeRect(atlas, x1, y, x + w - x1, h);
+	if (y0 > y)
+		ok &= fons__atlasFreeRect(atlas, x0, y, x1 - x0, y0 - y);
+	if (y1 < y + h)
+		ok &= fons__atlasFreeRect(atlas, x0, y1, x1 - x0, y + h - y1);
+	return ok;
+}
+
+// Takes a region holding no glyphs. The free rects overlapping it are cut, and where it reaches
+// above the skyline, the skyline is raised, keeping the space below the region as free rect.
+static int fons__atlasTakeRegion(FONSatlas* atlas, const FONSatlasRect* r)
+{
+	int i, ok = 1, x1 = r->x + r->width, y1 = r->y + r->height;
+	for (i = 0; i < atlas->nnodes && atlas->nodes[i].x < x1; i++) {
+		FONSatlasNode* n = &atlas->nodes[i];
+		if (n->x + n->width <= r->x || n->y >= y1)
+			continue;
+		// Split the nodes at the edges of the region.
+		if (n->x < r->x) {
+			if (fons__atlasInsertNode(atlas, i+1, r->x, n->y, n->x + n->width - r->x) == 0)
+				return 0;
+			atlas->nodes[i].width = (short)(r->x - atlas->nodes[i].x);
+			continue;
+		}
+		if (n->x + n->width > x1) {
+			if (fons__atlasInsertNode(atlas, i+1, x1, n->y, n->x + n->width - x1) == 0)
+				return 0;
+			n = &atlas->nodes[i];
+			n->width = (short)(x1 - n->x);
+		}
+		if (n->y < r->y)
+			ok &= fons__atlasPushRect(atlas, n->x, n->y, n->width, r->y - n->y);
+		n->y = (short)y1;
+	}
+	// Merge same height skyline segments that are next to each other.
+	for (i = 0; i < atlas->nnodes-1; i++) {
+		if (atlas->nodes[i].y == atlas->nodes[i+1].y) {
+			atlas->nodes[i].width += atlas->nodes[i+1].width;
+			fons__atlasRemoveNode(atlas, i+1);
+			i--;
+		}
+	}
+
+	i = 0;
+	while (i < atlas->nrects) {
+		FONSatlasRect f = atlas->rects[i];
+		if (f.x >= r->x + r->width || f.x + f.width <= r->x || f.y >= r->y + r->height || f.y + f.height <= r->y) {
+			i++;
+			continue;
+		}
+		atlas->rects[i] = atlas->rects[--atlas->nrects];
+		atlas->freeArea -= f.width * f.height;
+		ok &= fons__atlasFreeOutside(atlas, f.x, f.y, f.width, f.height, r);
+	}
+	return ok;
+}
+
 static int fons__atlasAddRect(FONSatlas* atlas, int rw, int rh, int* rx, int* ry)
 {
 	int besth = atlas->height, bestw = atlas->width, besti = -1;
 	int bestx = -1, besty = -1, i;
 
+	if (fons__atlasAddFreeRect(atlas, rw, rh, rx, ry))
+		return 1;
+
 	// Bottom left fit heuristic.
 	for (i = 0; i < atlas->nnodes; i++) {
 		int y = fons__atlasRectFits(atlas, i, rw, rh);
@@ -734,10 +1225,13 @@ FONScontext* fonsCreateInternal(FONSparams* params)
 	memset(stash, 0, sizeof(FONScontext));
 
 	stash->params = *params;
+	stash->freeEntry = -1;
+	stash->lruFrame = -1;
 
 	// Allocate scratch buffer.
-	stash->scratch = (unsigned char*)malloc(FONS_SCRATCH_BUF_SIZE);
-	if (stash->scratch == NULL) goto error;
+	stash->scratch.stash = stash;
+	stash->scratch.data = (unsigned char*)malloc(FONS_SCRATCH_BUF_SIZE);
+	if (stash->scratch.data == NULL) goto error;
 
 	// Initialize implementation library
 	if (!fons__tt_init(stash)) goto error;
@@ -787,6 +1281,119 @@ static FONSstate* fons__getState(FONScontext* stash)
 	return &stash->states[stash->nstates-1];
 }
 
+static void fons__freeGlyphTables(FONSglyphTable* table)
+{
+	while (table != NULL) {
+		FONSglyphTable* retired = table->retired;
+		free(table);
+		table = retired;
+	}
+}
+
+static FONSglyphTable* fons__allocGlyphTable(int cslots)
+{
+	FONSglyphTable* table = (FONSglyphTable*)malloc(sizeof(FONSglyphTable) + sizeof(FONSglyph*) * cslots);
+	if (table == NULL) return NULL;
+	table->retired = NULL;
+	table->cslots = cslots;
+	table->nglyphs = 0;
+	table->slots = (FONSglyph**)(table + 1);
+	memset(table->slots, 0, sizeof(FONSglyph*) * cslots);
+	return table;
+}
+
+// Drops all glyphs of the font, must not run while other threads look up glyphs.
+static void fons__resetGlyphs(FONSfont* font)
+{
+	while (font->blocks != NULL) {
+		FONSglyphBlock* next = font->blocks->next;
+		free(font->blocks);
+		font->blocks = next;
+	}
+	fons__freeGlyphTables(font->table->retired);
+	font->table->retired = NULL;
+	font->table->nglyphs = 0;
+	font->nretired = 0;
+	memset(font->table->slots, 0, sizeof(FONSglyph*) * font->table->cslots);
+}
+
+// Drops the queued jobs of the font (all fonts if NULL), whose glyphs are about to be reset.
+// Jobs a worker is running are kept without a glyph and freed once done.
+static void fons__cancelGlyphJobs(FONScontext* stash, FONSfont* font)
+{
+	int i, n = 0;
+
+	if (stash->njobs == 0) return;
+
+	fons__lock(&stash->lock);
+	for (i = 0; i < stash->njobs; i++) {
+		FONSglyphJob* job = stash->jobs[i];
+		if (font != NULL && job->font != font) {
+			stash->jobs[n++] = job;
+		} else if (job->state == FONS_JOB_RUNNING) {
+			job->glyph = NULL;
+			stash->jobs[n++] = job;
+		} else {
+			free(job);
+		}
+	}
+	stash->njobs = n;
+	fons__unlock(&stash->lock);
+}
+
+static int fons__allocEntry(FONScontext* stash)
+{
+	int i = stash->freeEntry;
+	if (i != -1) {
+		stash->freeEntry = stash->entries[i].next;
+		return i;
+	}
+	if (stash->nentries+1 > stash->centries) {
+		int centries = stash->centries == 0 ? 256 : stash->centries * 2;
+		FONSatlasEntry* entries = (FONSatlasEntry*)realloc(stash->entries, sizeof(FONSatlasEntry) * centries);
+		if (entries == NULL)
+			return -1;
+		stash->entries = entries;
+		stash->centries = centries;
+	}
+	return stash->nentries++;
+}
+
+static void fons__freeEntry(FONScontext* stash, int i)
+{
+	stash->entries[i].glyph = NULL;
+	stash->entries[i].next = stash->freeEntry;
+	stash->freeEntry = i;
+}
+
+// Clears the bitmap of the entry and releases it. The parts of its rect outside 'region', if given,
+// are returned to the atlas.
+static void fons__releaseEntry(FONScontext* stash, int i, const FONSatlasRect* region)
+{
+	FONSatlasEntry* e = &stash->entries[i];
+	int y, w = e->glyph->x1 - e->glyph->x0, h = e->glyph->y1 - e->glyph->y0;
+	for (y = 0; y < h; y++)
+		memset(&stash->texData[e->x + (e->y + y) * stash->params.width], 0, w);
+	fons__atlasFreeOutside(stash->atlas, e->x, e->y, w, h, region);
+	fons__freeEntry(stash, i);
+}
+
+// Releases the entries of the font (all fonts if NULL), whose glyphs are about to be reset.
+static void fons__dropEntries(FONScontext* stash, FONSfont* font)
+{
+	int i;
+	if (font == NULL) {
+		stash->nentries = 0;
+		stash->freeEntry = -1;
+	} else {
+		for (i = 0; i < stash->nentries; i++) {
+			if (stash->entries[i].glyph != NULL && stash->entries[i].font == font)
+				fons__releaseEntry(stash, i, NULL);
+		}
+	}
+	stash->lruFrame = -1;
+}
+
 int fonsAddFallbackFont(FONScontext* stash, int base, int fallback)
 {
 	FONSfont* baseFont = stash->fonts[base];
@@ -799,13 +1406,11 @@ int fonsAddFallbackFont(FONScontext* stash, int base, int fallback)
 
 void fonsResetFallbackFont(FONScontext* stash, int base)
 {
-	int i;
-
 	FONSfont* baseFont = stash->fonts[base];
 	baseFont->nfallbacks = 0;
-	baseFont->nglyphs = 0;
-	for (i = 0; i < FONS_HASH_LUT_SIZE; i++)
-		baseFont->lut[i] = -1;
+	fons__cancelGlyphJobs(stash, baseFont);
+	fons__dropEntries(stash, baseFont);
+	fons__resetGlyphs(baseFont);
 }
 
 void fonsSetSize(FONScontext* stash, float size)
@@ -838,6 +1443,16 @@ void fonsSetFont(FONScontext* stash, int font)
 	fons__getState(stash)->font = font;
 }
 
+void fonsSetSDF(FONScontext* stash, int sdf)
+{
+	fons__getState(stash)->sdf = sdf;
+}
+
+void fonsSetSubpixel(FONScontext* stash, int subpixel)
+{
+	fons__getState(stash)->subpixel = subpixel;
+}
+
 void fonsPushState(FONScontext* stash)
 {
 	if (stash->nstates >= FONS_MAX_STATES) {
@@ -868,13 +1483,21 @@ void fonsClearState(FONScontext* stash)
 	state->font = 0;
 	state->blur = 0;
 	state->spacing = 0;
+	state->sdf = 0;
+	state->subpixel = 0;
 	state->align = FONS_ALIGN_LEFT | FONS_ALIGN_BASELINE;
 }
 
 static void fons__freeFont(FONSfont* font)
 {
 	if (font == NULL) return;
-	if (font->glyphs) free(font->glyphs);
+	while (font->blocks != NULL) {
+		FONSglyphBlock* next = font->blocks->next;
+		free(font->blocks);
+		font->blocks = next;
+	}
+	fons__freeGlyphTables(font->table);
+	free((void*)font->kern);
 	if (font->freeData && font->data) free(font->data);
 	free(font);
 }
@@ -892,10 +1515,8 @@ static int fons__allocFont(FONScontext* stash)
 	if (font == NULL) goto error;
 	memset(font, 0, sizeof(FONSfont));
 
-	font->glyphs = (FONSglyph*)malloc(sizeof(FONSglyph) * FONS_INIT_GLYPHS);
-	if (font->glyphs == NULL) goto error;
-	font->cglyphs = FONS_INIT_GLYPHS;
-	font->nglyphs = 0;
+	font->table = fons__allocGlyphTable(FONS_HASH_LUT_SIZE);
+	if (font->table == NULL) goto error;
 
 	stash->fonts[stash->nfonts++] = font;
 	return stash->nfonts-1;
@@ -936,7 +1557,7 @@ error:
 
 int fonsAddFontMem(FONScontext* stash, const char* name, unsigned char* data, int dataSize, int freeData, int fontIndex)
 {
-	int i, ascent, descent, fh, lineGap;
+	int ascent, descent, fh, lineGap;
 	FONSfont* font;
 
 	int idx = fons__allocFont(stash);
@@ -948,17 +1569,14 @@ int fonsAddFontMem(FONScontext* stash, const char* name, unsigned char* data, in
 	strncpy(font->name, name, sizeof(font->name));
 	font->name[sizeof(font->name)-1] = '\0';
 
-	// Init hash lookup.
-	for (i = 0; i < FONS_HASH_LUT_SIZE; ++i)
-		font->lut[i] = -1;
-
 	// Read in the font data.
 	font->dataSize = dataSize;
 	font->data = data;
 	font->freeData = (unsigned char)freeData;
 
 	// Init font
-	stash->nscratch = 0;
+	stash->scratch.ndata = 0;
+	fons__tt_setScratch(&font->font, &stash->scratch);
 	if (!fons__tt_loadFont(stash, &font->font, data, dataSize, fontIndex)) goto error;
 
 	// Store normalized line height. The real line height is got
@@ -991,63 +1609,463 @@ int fonsGetFontByName(FONScontext* s, const char* name)
 
 static FONSglyph* fons__allocGlyph(FONSfont* font)
 {
-	if (font->nglyphs+1 > font->cglyphs) {
-		font->cglyphs = font->cglyphs == 0 ? 8 : font->cglyphs * 2;
-		font->glyphs = (FONSglyph*)realloc(font->glyphs, sizeof(FONSglyph) * font->cglyphs);
-		if (font->glyphs == NULL) return NULL;
+	if (font->blocks == NULL || font->blocks->nglyphs >= FONS_INIT_GLYPHS) {
+		FONSglyphBlock* block = (FONSglyphBlock*)malloc(sizeof(FONSglyphBlock));
+		if (block == NULL) return NULL;
+		block->next = font->blocks;
+		block->nglyphs = 0;
+		font->blocks = block;
 	}
-	font->nglyphs++;
-	return &font->glyphs[font->nglyphs-1];
+	return &font->blocks->glyphs[font->blocks->nglyphs++];
 }
 
+static unsigned int fons__glyphHash(unsigned int codepoint, short isize, short iblur, short phase)
+{
+	return fons__hashint(codepoint ^ ((unsigned int)isize << 11) ^ ((unsigned int)iblur << 26) ^ ((unsigned int)phase << 24));
+}
 
-// Based on Exponential blur, Jani Huhtanen, 2006
-
-#define APREC 16
-#define ZPREC 7
-
-static void fons__blurCols(unsigned char* dst, int w, int h, int dstStride, int alpha)
+// Lock free lookup, the glyph is fully written before its pointer is published.
+static FONSglyph* fons__findGlyph(FONSfont* font, unsigned int codepoint, short isize, short iblur, short phase)
 {
-	int x, y;
-	for (y = 0; y < h; y++) {
-		int z = 0; // force zero border
-		for (x = 1; x < w; x++) {
-			z += (alpha * (((int)(dst[x]) << ZPREC) - z)) >> APREC;
-			dst[x] = (unsigned char)(z >> ZPREC);
-		}
-		dst[w-1] = 0; // force zero border
-		z = 0;
-		for (x = w-2; x >= 0; x--) {
-			z += (alpha * (((int)(dst[x]) << ZPREC) - z)) >> APREC;
-			dst[x] = (unsigned char)(z >> ZPREC);
-		}
-		dst[0] = 0; // force zero border
-		dst += dstStride;
+	FONSglyphTable* table = (FONSglyphTable*)fons__loadPtr((void* volatile*)&font->table);
+	unsigned int mask = (unsigned int)table->cslots-1;
+	unsigned int i = fons__glyphHash(codepoint, isize, iblur, phase) & mask;
+	for (;;) {
+		FONSglyph* glyph = (FONSglyph*)fons__loadPtr((void* volatile*)&table->slots[i]);
+		if (glyph == NULL)
+			return NULL;
+		if (glyph->codepoint == codepoint && glyph->size == isize && glyph->blur == iblur && glyph->phase == phase)
+			return glyph;
+		i = (i+1) & mask;
 	}
 }
 
-static void fons__blurRows(unsigned char* dst, int w, int h, int dstStride, int alpha)
-{
-	int x, y;
-	for (x = 0; x < w; x++) {
-		int z = 0; // force zero border
-		for (y = dstStride; y < h*dstStride; y += dstStride) {
-			z += (alpha * (((int)(dst[y]) << ZPREC) - z)) >> APREC;
-			dst[y] = (unsigned char)(z >> ZPREC);
+// Publishes the glyph, replacing an existing one with the same key. Called with the stash locked.
+static int fons__insertGlyph(FONSfont* font, FONSglyph* glyph)
+{
+	FONSglyphTable* table = font->table;
+	unsigned int mask, i;
+
+	if ((table->nglyphs+1) * 2 > table->cslots) {
+		// Grow, readers still walking the old table find the same glyphs there.
+		FONSglyphTable* bigger = fons__allocGlyphTable(table->cslots * 2);
+		if (bigger == NULL) return 0;
+		mask = (unsigned int)bigger->cslots-1;
+		for (i = 0; i < (unsigned int)table->cslots; i++) {
+			FONSglyph* g = table->slots[i];
+			unsigned int j;
+			if (g == NULL) continue;
+			j = fons__glyphHash(g->codepoint, g->size, g->blur, g->phase) & mask;
+			while (bigger->slots[j] != NULL)
+				j = (j+1) & mask;
+			bigger->slots[j] = g;
 		}
-		dst[(h-1)*dstStride] = 0; // force zero border
-		z = 0;
-		for (y = (h-2)*dstStride; y >= 0; y -= dstStride) {
-			z += (alpha * (((int)(dst[y]) << ZPREC) - z)) >> APREC;
-			dst[y] = (unsigned char)(z >> ZPREC);
+		bigger->nglyphs = table->nglyphs;
+		bigger->retired = table;
+		fons__storePtr((void* volatile*)&font->table, bigger);
+		table = bigger;
+	}
+
+	mask = (unsigned int)table->cslots-1;
+	i = fons__glyphHash(glyph->codepoint, glyph->size, glyph->blur, glyph->phase) & mask;
+	for (;;) {
+		FONSglyph* g = table->slots[i];
+		if (g == NULL) {
+			table->nglyphs++;
+			break;
 		}
-		dst[0] = 0; // force zero border
-		dst++;
+		if (g->codepoint == glyph->codepoint && g->size == glyph->size && g->blur == glyph->blur && g->phase == glyph->phase) {
+			font->nretired++;
+			break;
+		}
+		i = (i+1) & mask;
 	}
+	fons__storePtr((void* volatile*)&table->slots[i], glyph);
+	return 1;
 }
 
+// Copies the glyphs in the table of the font to new blocks and frees the replaced ones. Glyphs with
+// a bitmap are moved to where their entry is. Glyphs without bitmap, or whose entry is no longer
+// theirs, are dropped, they are created again when needed. Must not run while other threads look up glyphs.
+static int fons__collectGlyphs(FONScontext* stash, FONSfont* font)
+{
+	FONSglyphTable* old = font->table;
+	FONSglyphTable* table = NULL;
+	FONSglyphBlock* blocks = NULL;
+	FONSglyphBlock* block;
+	unsigned int mask;
+	int i, nblocks;
+
+	// Allocate everything first, the glyphs stay as they are if that fails.
+	table = fons__allocGlyphTable(old->cslots);
+	if (table == NULL) goto error;
+	nblocks = (old->nglyphs + FONS_INIT_GLYPHS-1) / FONS_INIT_GLYPHS;
+	for (i = 0; i < nblocks; i++) {
+		block = (FONSglyphBlock*)malloc(sizeof(FONSglyphBlock));
+		if (block == NULL) goto error;
+		block->next = blocks;
+		block->nglyphs = 0;
+		blocks = block;
+	}
 
-static void fons__blur(FONScontext* stash, unsigned char* dst, int w, int h, int dstStride, int blur)
+	block = blocks;
+	mask = (unsigned int)table->cslots-1;
+	for (i = 0; i < old->cslots; i++) {
+		FONSglyph* g = old->slots[i];
+		FONSglyph* copy;
+		unsigned int j;
+		if (g == NULL || g->entry == -1 || stash->entries[g->entry].glyph != g) continue;
+		if (block->nglyphs >= FONS_INIT_GLYPHS)
+			block = block->next;
+		copy = &block->glyphs[block->nglyphs++];
+		*copy = *g;
+		copy->x0 = stash->entries[g->entry].x;
+		copy->y0 = stash->entries[g->entry].y;
+		copy->x1 = (short)(copy->x0 + g->x1 - g->x0);
+		copy->y1 = (short)(copy->y0 + g->y1 - g->y0);
+		stash->entries[g->entry].glyph = copy;
+		j = fons__glyphHash(copy->codepoint, copy->size, copy->blur, copy->phase) & mask;
+		while (table->slots[j] != NULL)
+			j = (j+1) & mask;
+		table->slots[j] = copy;
+		table->nglyphs++;
+	}
+	// Drop the blocks left empty.
+	while (block != NULL && block->next != NULL) {
+		FONSglyphBlock* next = block->next->next;
+		free(block->next);
+		block->next = next;
+	}
+
+	// Queued glyphs follow their copy, or are dropped with their bitmap.
+	fons__lock(&stash->lock);
+	for (i = 0; i < stash->njobs; i++) {
+		FONSglyphJob* job = stash->jobs[i];
+		if (job->font == font && job->glyph != NULL)
+			job->glyph = stash->entries[job->glyph->entry].glyph;
+	}
+	fons__unlock(&stash->lock);
+
+	while (font->blocks != NULL) {
+		block = font->blocks->next;
+		free(font->blocks);
+		font->blocks = block;
+	}
+	fons__freeGlyphTables(old);
+	font->blocks = blocks;
+	font->table = table;
+	font->nretired = 0;
+	return 1;
+
+error:
+	while (blocks != NULL) {
+		block = blocks->next;
+		free(blocks);
+		blocks = block;
+	}
+	if (table != NULL) free(table);
+	return 0;
+}
+
+static int fons__cmpLruItem(const void* a, const void* b)
+{
+	return ((const FONSlruItem*)a)->key - ((const FONSlruItem*)b)->key;
+}
+
+// Publishes the glyph of the entry without bitmap and releases the entry.
+static int fons__evictEntry(FONScontext* stash, int i, const FONSatlasRect* region)
+{
+	FONSatlasEntry* e = &stash->entries[i];
+	FONSglyph* evicted;
+
+	fons__lock(&stash->lock);
+	evicted = fons__allocGlyph(e->font);
+	if (evicted != NULL) {
+		*evicted = *e->glyph;
+		evicted->x0 = -1;
+		evicted->y0 = -1;
+		evicted->x1 = (short)(evicted->x0 + e->glyph->x1 - e->glyph->x0);
+		evicted->y1 = (short)(evicted->y0 + e->glyph->y1 - e->glyph->y0);
+		evicted->entry = -1;
+		if (!fons__insertGlyph(e->font, evicted))
+			evicted = NULL;
+	}
+	fons__unlock(&stash->lock);
+	if (evicted == NULL) return 0;
+
+	fons__releaseEntry(stash, i, region);
+	return 1;
+}
+
+static int fons__evictable(FONScontext* stash, int i)
+{
+	FONSatlasEntry* e = &stash->entries[i];
+	return e->glyph != NULL && !e->glyph->pending && e->used + FONS_EVICT_FRAMES <= stash->frame;
+}
+
+static int fons__entryOverlaps(FONSatlasEntry* e, const FONSatlasRect* r)
+{
+	return e->glyph != NULL && e->x < r->x + r->width && e->x + e->glyph->x1 - e->glyph->x0 > r->x
+		&& e->y < r->y + r->height && e->y + e->glyph->y1 - e->glyph->y0 > r->y;
+}
+
+// Takes the region for a new glyph if all glyphs in it can be evicted.
+static int fons__reclaimRegion(FONScontext* stash, const FONSatlasRect* r)
+{
+	int i;
+	// The white rect is in the corner.
+	if (r->x < 2 && r->y < 2)
+		return 0;
+	for (i = 0; i < stash->nentries; i++) {
+		if (fons__entryOverlaps(&stash->entries[i], r) && !fons__evictable(stash, i))
+			return 0;
+	}
+	for (i = 0; i < stash->nentries; i++) {
+		if (fons__entryOverlaps(&stash->entries[i], r) && !fons__evictEntry(stash, i, r))
+			return 0;
+	}
+	return fons__atlasTakeRegion(stash->atlas, r);
+}
+
+// Evicts glyphs not drawn in the last FONS_EVICT_FRAMES frames, least recently drawn first, until a rw x rh rect fits.
+static int fons__evictGlyphs(FONScontext* stash, int rw, int rh, int* rx, int* ry)
+{
+	int i, n, area = 0;
+
+	if (stash->lruFrame != stash->frame) {
+		// The candidates are sorted once per frame, entries drawn since are skipped.
+		stash->nlru = 0;
+		stash->lruPos = 0;
+		stash->lruFrame = stash->frame;
+		if (stash->nentries > stash->clru) {
+			FONSlruItem* lru = (FONSlruItem*)realloc(stash->lru, sizeof(FONSlruItem) * stash->nentries);
+			if (lru == NULL) return 0;
+			stash->lru = lru;
+			stash->clru = stash->nentries;
+		}
+		for (i = 0; i < stash->nentries; i++) {
+			if (fons__evictable(stash, i)) {
+				stash->lru[stash->nlru].key = stash->entries[i].used;
+				stash->lru[stash->nlru].entry = i;
+				stash->nlru++;
+			}
+		}
+		qsort(stash->lru, stash->nlru, sizeof(FONSlruItem), fons__cmpLruItem);
+	}
+	while (stash->lruPos < stash->nlru && !fons__evictable(stash, stash->lru[stash->lruPos].entry))
+		stash->lruPos++;
+
+	// Place the rect at one of the oldest glyphs, evicting the glyphs under it.
+	for (i = stash->lruPos, n = 0; i < stash->nlru && n < FONS_EVICT_CANDIDATES; i++) {
+		FONSatlasEntry* e = &stash->entries[stash->lru[i].entry];
+		FONSatlasRect r;
+		if (!fons__evictable(stash, stash->lru[i].entry)) continue;
+		n++;
+		r.x = (short)fons__mini(e->x, stash->atlas->width - rw);
+		r.y = (short)fons__mini(e->y, stash->atlas->height - rh);
+		r.width = (short)rw;
+		r.height = (short)rh;
+		if (r.x < 0 || r.y < 0)
+			return 0;
+		if (fons__reclaimRegion(stash, &r)) {
+			*rx = r.x;
+			*ry = r.y;
+			return 1;
+		}
+	}
+
+	// Evicting a glyph at least as large as the rect makes room for it.
+	for (i = stash->lruPos; i < stash->nlru; i++) {
+		int e = stash->lru[i].entry;
+		FONSglyph* glyph;
+		if (!fons__evictable(stash, e)) continue;
+		glyph = stash->entries[e].glyph;
+		if (glyph->x1 - glyph->x0 >= rw && glyph->y1 - glyph->y0 >= rh) {
+			if (fons__evictEntry(stash, e, NULL))
+				return fons__atlasAddRect(stash->atlas, rw, rh, rx, ry);
+			break;
+		}
+	}
+
+	// Otherwise free the oldest until it fits, giving up when much more than the rect has been freed.
+	while (stash->lruPos < stash->nlru && area < rw*rh*4) {
+		int e = stash->lru[stash->lruPos++].entry;
+		FONSglyph* glyph;
+		if (!fons__evictable(stash, e)) continue;
+		glyph = stash->entries[e].glyph;
+		area += (glyph->x1 - glyph->x0) * (glyph->y1 - glyph->y0);
+		if (!fons__evictEntry(stash, e, NULL))
+			return 0;
+		if (fons__atlasAddRect(stash->atlas, rw, rh, rx, ry))
+			return 1;
+	}
+	return 0;
+}
+
+// Based on Exponential blur, Jani Huhtanen, 2006
+
+#define APREC 16
+#define ZPREC 7
+
+static void fons__blurCols(unsigned char* dst, int w, int h, int dstStride, int alpha)
+{
+	int x, y;
+	for (y = 0; y < h; y++) {
+		int z = 0; // force zero border
+		for (x = 1; x < w; x++) {
+			z += (alpha * (((int)(dst[x]) << ZPREC) - z)) >> APREC;
+			dst[x] = (unsigned char)(z >> ZPREC);
+		}
+		dst[w-1] = 0; // force zero border
+		z = 0;
+		for (x = w-2; x >= 0; x--) {
+			z += (alpha * (((int)(dst[x]) << ZPREC) - z)) >> APREC;
+			dst[x] = (unsigned char)(z >> ZPREC);
+		}
+		dst[0] = 0; // force zero border
+		dst += dstStride;
+	}
+}
+
+static void fons__blurRows(unsigned char* dst, int w, int h, int dstStride, int alpha)
+{
+	int x, y;
+	for (x = 0; x < w; x++) {
+		int z = 0; // force zero border
+		for (y = dstStride; y < h*dstStride; y += dstStride) {
+			z += (alpha * (((int)(dst[y]) << ZPREC) - z)) >> APREC;
+			dst[y] = (unsigned char)(z >> ZPREC);
+		}
+		dst[(h-1)*dstStride] = 0; // force zero border
+		z = 0;
+		for (y = (h-2)*dstStride; y >= 0; y -= dstStride) {
+			z += (alpha * (((int)(dst[y]) << ZPREC) - z)) >> APREC;
+			dst[y] = (unsigned char)(z >> ZPREC);
+		}
+		dst[0] = 0; // force zero border
+		dst++;
+	}
+}
+
+
+#if !defined(FONS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define FONS_SSE2 1
+#include <emmintrin.h>
+
+// The SSE2 passes run the same filter on 8 lines at once in 16 bit lanes. z stays within
+// 0..255<<ZPREC and the product alpha*(v-z) fits in 32 bits, so the arithmetic shift by
+// APREC is the high half of the product and results match the scalar passes exactly.
+static __m128i fons__blurStep(__m128i z, __m128i v, __m128i alpha, int alphaHigh)
+{
+	__m128i d = _mm_sub_epi16(_mm_slli_epi16(v, ZPREC), z);
+	__m128i dz = _mm_mulhi_epi16(d, alpha);
+	if (alphaHigh) dz = _mm_add_epi16(dz, d); // alpha is stored as alpha-65536
+	return _mm_add_epi16(z, dz);
+}
+
+// Transposes 8x8 bytes held in the low halves of r.
+static void fons__transpose8(__m128i* r)
+{
+	__m128i t0 = _mm_unpacklo_epi8(r[0], r[1]);
+	__m128i t1 = _mm_unpacklo_epi8(r[2], r[3]);
+	__m128i t2 = _mm_unpacklo_epi8(r[4], r[5]);
+	__m128i t3 = _mm_unpacklo_epi8(r[6], r[7]);
+	__m128i u0 = _mm_unpacklo_epi16(t0, t1);
+	__m128i u1 = _mm_unpackhi_epi16(t0, t1);
+	__m128i u2 = _mm_unpacklo_epi16(t2, t3);
+	__m128i u3 = _mm_unpackhi_epi16(t2, t3);
+	r[0] = _mm_unpacklo_epi32(u0, u2);
+	r[2] = _mm_unpackhi_epi32(u0, u2);
+	r[4] = _mm_unpacklo_epi32(u1, u3);
+	r[6] = _mm_unpackhi_epi32(u1, u3);
+	r[1] = _mm_srli_si128(r[0], 8);
+	r[3] = _mm_srli_si128(r[2], 8);
+	r[5] = _mm_srli_si128(r[4], 8);
+	r[7] = _mm_srli_si128(r[6], 8);
+}
+
+// Filters columns x0..x0+7 of an 8 row strip from first to last (step 1) or last to first (step -1).
+static __m128i fons__blurColsBlock(unsigned char* dst, int dstStride, int x0, int first, int last, int step, __m128i z, __m128i alpha, int alphaHigh)
+{
+	__m128i r[8], zero = _mm_setzero_si128();
+	int i;
+	for (i = 0; i < 8; i++)
+		r[i] = _mm_loadl_epi64((const __m128i*)&dst[i*dstStride + x0]);
+	fons__transpose8(r);
+	for (i = first; i != last+step; i += step) {
+		z = fons__blurStep(z, _mm_unpacklo_epi8(r[i], zero), alpha, alphaHigh);
+		r[i] = _mm_packus_epi16(_mm_srai_epi16(z, ZPREC), zero);
+	}
+	fons__transpose8(r);
+	for (i = 0; i < 8; i++)
+		_mm_storel_epi64((__m128i*)&dst[i*dstStride + x0], r[i]);
+	return z;
+}
+
+static void fons__blurColsSSE2(unsigned char* dst, int w, int h, int dstStride, int alpha)
+{
+	__m128i valpha = _mm_set1_epi16((short)alpha);
+	int alphaHigh = alpha >= 0x8000;
+	int x, y, i, xv = w & ~7;
+	short zs[8];
+	for (y = 0; y+8 <= h; y += 8) {
+		unsigned char* row = &dst[y*dstStride];
+		__m128i z = _mm_setzero_si128(); // force zero border
+		for (x = 0; x < xv; x += 8)
+			z = fons__blurColsBlock(row, dstStride, x, x == 0 ? 1 : 0, 7, 1, z, valpha, alphaHigh);
+		_mm_storeu_si128((__m128i*)zs, z);
+		for (i = 0; i < 8; i++) {
+			unsigned char* p = &row[i*dstStride];
+			int zi = zs[i];
+			for (x = xv > 0 ? xv : 1; x < w; x++) {
+				zi += (alpha * (((int)(p[x]) << ZPREC) - zi)) >> APREC;
+				p[x] = (unsigned char)(zi >> ZPREC);
+			}
+			p[w-1] = 0; // force zero border
+			zi = 0;
+			for (x = w-2; x >= xv; x--) {
+				zi += (alpha * (((int)(p[x]) << ZPREC) - zi)) >> APREC;
+				p[x] = (unsigned char)(zi >> ZPREC);
+			}
+			zs[i] = (short)zi;
+		}
+		z = _mm_loadu_si128((const __m128i*)zs);
+		for (x = xv-8; x >= 0; x -= 8)
+			z = fons__blurColsBlock(row, dstStride, x, x+7 > w-2 ? w-2-x : 7, 0, -1, z, valpha, alphaHigh);
+		for (i = 0; i < 8; i++)
+			row[i*dstStride] = 0; // force zero border
+	}
+	if (y < h)
+		fons__blurCols(&dst[y*dstStride], w, h-y, dstStride, alpha);
+}
+
+static void fons__blurRowsSSE2(unsigned char* dst, int w, int h, int dstStride, int alpha)
+{
+	__m128i valpha = _mm_set1_epi16((short)alpha), zero = _mm_setzero_si128();
+	int alphaHigh = alpha >= 0x8000;
+	int x, y;
+	for (x = 0; x+8 <= w; x += 8) {
+		__m128i z = zero; // force zero border
+		for (y = 1; y < h; y++) {
+			__m128i* p = (__m128i*)&dst[y*dstStride + x];
+			z = fons__blurStep(z, _mm_unpacklo_epi8(_mm_loadl_epi64(p), zero), valpha, alphaHigh);
+			_mm_storel_epi64(p, _mm_packus_epi16(_mm_srai_epi16(z, ZPREC), zero));
+		}
+		_mm_storel_epi64((__m128i*)&dst[(h-1)*dstStride + x], zero); // force zero border
+		z = zero;
+		for (y = h-2; y >= 0; y--) {
+			__m128i* p = (__m128i*)&dst[y*dstStride + x];
+			z = fons__blurStep(z, _mm_unpacklo_epi8(_mm_loadl_epi64(p), zero), valpha, alphaHigh);
+			_mm_storel_epi64(p, _mm_packus_epi16(_mm_srai_epi16(z, ZPREC), zero));
+		}
+		_mm_storel_epi64((__m128i*)&dst[x], zero); // force zero border
+	}
+	if (x < w)
+		fons__blurRows(&dst[x], w-x, h, dstStride, alpha);
+}
+#endif
+
+static void fons__blur(FONScontext* stash, unsigned char* dst, int w, int h, int dstStride, int blur)
 {
 	int alpha;
 	float sigma;
@@ -1058,67 +2076,136 @@ static void fons__blur(FONScontext* stash, unsigned char* dst, int w, int h, int
 	// Calculate the alpha such that 90% of the kernel is within the radius. (Kernel extends to infinity)
 	sigma = (float)blur * 0.57735f; // 1 / sqrt(3)
 	alpha = (int)((1<<APREC) * (1.0f - expf(-2.3f / (sigma+1.0f))));
+#ifdef FONS_SSE2
+	fons__blurRowsSSE2(dst, w, h, dstStride, alpha);
+	fons__blurColsSSE2(dst, w, h, dstStride, alpha);
+	fons__blurRowsSSE2(dst, w, h, dstStride, alpha);
+	fons__blurColsSSE2(dst, w, h, dstStride, alpha);
+#else
 	fons__blurRows(dst, w, h, dstStride, alpha);
 	fons__blurCols(dst, w, h, dstStride, alpha);
 	fons__blurRows(dst, w, h, dstStride, alpha);
 	fons__blurCols(dst, w, h, dstStride, alpha);
+#endif
 //	fons__blurrows(dst, w, h, dstStride, alpha);
 //	fons__blurcols(dst, w, h, dstStride, alpha);
 }
 
+// Returns the glyph index of the codepoint in the font or the first fallback font having it, 0 if none has.
+static int fons__glyphIndex(FONScontext* stash, FONSfont* font, unsigned int codepoint, FONSfont** renderFont)
+{
+	int i, g = fons__tt_getGlyphIndex(&font->font, codepoint);
+	*renderFont = font;
+	if (g != 0) return g;
+	for (i = 0; i < font->nfallbacks; ++i) {
+		FONSfont* fallbackFont = stash->fonts[font->fallbacks[i]];
+		int fallbackIndex = fons__tt_getGlyphIndex(&fallbackFont->font, codepoint);
+		if (fallbackIndex != 0) {
+			*renderFont = fallbackFont;
+			return fallbackIndex;
+		}
+	}
+	return 0;
+}
+
+// Rasterizes the glyph with padding and blur into the gw x gh rect at dst, which must be cleared.
+// A blur of FONS_SDF_BLUR creates a distance field instead.
+static void fons__rasterizeGlyph(FONSttFontImpl* font, FONSscratch* scratch, unsigned char* dst, int stride,
+								 int g, float scale, float shift, int gw, int gh, int pad, int iblur)
+{
+	int x, y;
+
+	scratch->ndata = 0;
+	if (iblur == FONS_SDF_BLUR) {
+		fons__tt_renderGlyphSDF(font, dst, gw, gh, stride, scale, pad, FONS_SDF_EDGE, (float)FONS_SDF_EDGE / pad, g);
+		return;
+	}
+	fons__tt_renderGlyphBitmap(font, &dst[pad + pad * stride], gw-pad*2,gh-pad*2, stride, scale, scale, shift, g);
+
+	// Make sure there is one pixel empty border.
+	for (y = 0; y < gh; y++) {
+		dst[y*stride] = 0;
+		dst[gw-1 + y*stride] = 0;
+	}
+	for (x = 0; x < gw; x++) {
+		dst[x] = 0;
+		dst[x + (gh-1)*stride] = 0;
+	}
+
+	// Debug code to color the glyph background
+/*	for (y = 0; y < gh; y++) {
+		for (x = 0; x < gw; x++) {
+			int a = (int)dst[x+y*stride] + 20;
+			if (a > 255) a = 255;
+			dst[x+y*stride] = a;
+		}
+	}*/
+
+	// Blur
+	if (iblur > 0) {
+		scratch->ndata = 0;
+		fons__blur(scratch->stash, dst, gw, gh, stride, iblur);
+	}
+}
+
+static void fons__addDirtyRect(FONScontext* stash, FONSglyph* glyph)
+{
+	stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], glyph->x0);
+	stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], glyph->y0);
+	stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], glyph->x1);
+	stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], glyph->y1);
+}
+
+static FONSglyphJob* fons__allocGlyphJob(int gw, int gh)
+{
+	FONSglyphJob* job = (FONSglyphJob*)malloc(sizeof(FONSglyphJob) + gw*gh);
+	if (job == NULL) return NULL;
+	memset(job, 0, sizeof(FONSglyphJob));
+	job->bitmap = (unsigned char*)(job + 1);
+	memset(job->bitmap, 0, gw*gh);
+	job->width = gw;
+	job->height = gh;
+	return job;
+}
+
 static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint,
-								 short isize, short iblur, int bitmapOption)
+								 short isize, short iblur, short phase, int bitmapOption)
 {
-	int i, g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy, x, y;
-	float scale;
+	int g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy;
+	float scale, shift = (float)phase / FONS_SUBPIXEL_STEPS;
 	FONSglyph* glyph = NULL;
-	unsigned int h;
+	FONSglyph* cached;
+	FONSglyphJob* job = NULL;
 	float size = isize/10.0f;
-	int pad, added;
-	unsigned char* bdst;
-	unsigned char* dst;
-	FONSfont* renderFont = font;
+	int pad, added, entry = -1;
+	FONSfont* renderFont;
 
 	if (isize < 2) return NULL;
-	if (iblur > 20) iblur = 20;
-	pad = iblur+2;
-
-	// Reset allocator.
-	stash->nscratch = 0;
+	if (iblur == FONS_SDF_BLUR) {
+		// The field fades out over the padding.
+		pad = FONS_SDF_PAD;
+	} else {
+		if (iblur < 0) iblur = 0;
+		if (iblur > 20) iblur = 20;
+		pad = iblur+2;
+	}
 
 	// Find code point and size.
-	h = fons__hashint(codepoint) & (FONS_HASH_LUT_SIZE-1);
-	i = font->lut[h];
-	while (i != -1) {
-		if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur) {
-			glyph = &font->glyphs[i];
-			if (bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL || (glyph->x0 >= 0 && glyph->y0 >= 0)) {
-			  return glyph;
-			}
-			// At this point, glyph exists but the bitmap data is not yet created.
-			break;
-		}
-		i = font->glyphs[i].next;
+	cached = fons__findGlyph(font, codepoint, isize, iblur, phase);
+	if (cached != NULL && bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL)
+		return cached;
+	if (cached != NULL && cached->entry != -1) {
+		stash->entries[cached->entry].used = stash->frame;
+		return cached;
 	}
+	// At this point, glyph does not exist or the bitmap data is not yet created.
 
 	// Create a new glyph or rasterize bitmap data for a cached glyph.
-	g = fons__tt_getGlyphIndex(&font->font, codepoint);
-	// Try to find the glyph in fallback fonts.
-	if (g == 0) {
-		for (i = 0; i < font->nfallbacks; ++i) {
-			FONSfont* fallbackFont = stash->fonts[font->fallbacks[i]];
-			int fallbackIndex = fons__tt_getGlyphIndex(&fallbackFont->font, codepoint);
-			if (fallbackIndex != 0) {
-				g = fallbackIndex;
-				renderFont = fallbackFont;
-				break;
-			}
-		}
-		// It is possible that we did not find a fallback glyph.
-		// In that case the glyph index 'g' is 0, and we'll proceed below and cache empty glyph.
-	}
+	// It is possible that we did not find a fallback glyph.
+	// In that case the glyph index 'g' is 0, and we'll proceed below and cache empty glyph.
+	g = fons__glyphIndex(stash, font, codepoint, &renderFont);
 	scale = fons__tt_getPixelHeightScale(&renderFont->font, size);
-	fons__tt_buildGlyphBitmap(&renderFont->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1);
+	fons__tt_buildGlyphBitmap(&renderFont->font, g, size, scale, shift, &advance, &lsb, &x0, &y0, &x1, &y1);
 	gw = x1-x0 + pad*2;
 	gh = y1-y0 + pad*2;
 
@@ -1126,92 +2213,342 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	if (bitmapOption == FONS_GLYPH_BITMAP_REQUIRED) {
 		// Find free spot for the rect in the atlas
 		added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
+		if (added == 0)
+			added = fons__evictGlyphs(stash, gw, gh, &gx, &gy);
 		if (added == 0 && stash->handleError != NULL) {
 			// Atlas is full, let the user to resize the atlas (or not), and try again.
 			stash->handleError(stash->errorUptr, FONS_ATLAS_FULL, 0);
 			added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
 		}
 		if (added == 0) return NULL;
+		entry = fons__allocEntry(stash);
+		if (entry == -1) {
+			fons__atlasFreeRect(stash->atlas, gx, gy, gw, gh);
+			return NULL;
+		}
+#ifndef FONS_USE_FREETYPE
+		// FreeType faces can not be shared between threads, rasterize right away.
+		if (stash->params.flags & FONS_ASYNC_GLYPHS)
+			job = fons__allocGlyphJob(gw, gh);
+#endif
 	} else {
 		// Negative coordinate indicates there is no bitmap data created.
 		gx = -1;
 		gy = -1;
 	}
 
-	// Init glyph.
-	if (glyph == NULL) {
-		glyph = fons__allocGlyph(font);
+	fons__lock(&stash->lock);
+	if (bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL) {
+		// An other thread may have added the glyph meanwhile.
+		cached = fons__findGlyph(font, codepoint, isize, iblur, phase);
+		if (cached != NULL) {
+			fons__unlock(&stash->lock);
+			return cached;
+		}
+	}
+	if (job != NULL && stash->njobs+1 > stash->cjobs) {
+		int cjobs = stash->cjobs == 0 ? 64 : stash->cjobs * 2;
+		FONSglyphJob** jobs = (FONSglyphJob**)realloc(stash->jobs, sizeof(FONSglyphJob*) * cjobs);
+		if (jobs != NULL) {
+			stash->jobs = jobs;
+			stash->cjobs = cjobs;
+		} else {
+			free(job);
+			job = NULL;
+		}
+	}
+
+	// Init glyph. Published glyphs are not modified, adding the bitmap replaces the glyph.
+	glyph = fons__allocGlyph(font);
+	if (glyph != NULL) {
 		glyph->codepoint = codepoint;
 		glyph->size = isize;
 		glyph->blur = iblur;
-		glyph->next = 0;
-
-		// Insert char to hash lookup.
-		glyph->next = font->lut[h];
-		font->lut[h] = font->nglyphs-1;
+		glyph->phase = phase;
+		glyph->index = g;
+		glyph->x0 = (short)gx;
+		glyph->y0 = (short)gy;
+		glyph->x1 = (short)(glyph->x0+gw);
+		glyph->y1 = (short)(glyph->y0+gh);
+		glyph->xadv = (short)(scale * advance * 10.0f);
+		glyph->xoff = (short)(x0 - pad);
+		glyph->yoff = (short)(y0 - pad);
+		glyph->pending = job != NULL;
+		glyph->entry = entry;
+		if (!fons__insertGlyph(font, glyph))
+			glyph = NULL;
+	}
+	if (glyph != NULL && job != NULL) {
+		job->glyph = glyph;
+		job->font = font;
+		job->renderFont = renderFont;
+		job->index = g;
+		job->scale = scale;
+		job->shift = shift;
+		job->pad = pad;
+		job->blur = iblur;
+		job->state = FONS_JOB_QUEUED;
+		stash->jobs[stash->njobs++] = job;
+		job = NULL;
+	}
+	fons__unlock(&stash->lock);
+	if (job != NULL) free(job);
+	if (glyph == NULL) {
+		if (entry != -1) {
+			fons__freeEntry(stash, entry);
+			fons__atlasFreeRect(stash->atlas, gx, gy, gw, gh);
+		}
+		return NULL;
+	}
+	if (entry != -1) {
+		FONSatlasEntry* e = &stash->entries[entry];
+		e->font = font;
+		e->glyph = glyph;
+		e->x = (short)gx;
+		e->y = (short)gy;
+		e->used = stash->frame;
+		e->serial = ++stash->serial;
 	}
-	glyph->index = g;
-	glyph->x0 = (short)gx;
-	glyph->y0 = (short)gy;
-	glyph->x1 = (short)(glyph->x0+gw);
-	glyph->y1 = (short)(glyph->y0+gh);
-	glyph->xadv = (short)(scale * advance * 10.0f);
-	glyph->xoff = (short)(x0 - pad);
-	glyph->yoff = (short)(y0 - pad);
 
-	if (bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL) {
+	if (bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL || glyph->pending) {
 		return glyph;
 	}
 
 	// Rasterize
-	dst = &stash->texData[(glyph->x0+pad) + (glyph->y0+pad) * stash->params.width];
-	fons__tt_renderGlyphBitmap(&renderFont->font, dst, gw-pad*2,gh-pad*2, stash->params.width, scale, scale, g);
+	fons__rasterizeGlyph(&renderFont->font, &stash->scratch, &stash->texData[glyph->x0 + glyph->y0 * stash->params.width],
+						 stash->params.width, g, scale, shift, gw, gh, pad, iblur);
+	fons__addDirtyRect(stash, glyph);
 
-	// Make sure there is one pixel empty border.
-	dst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
-	for (y = 0; y < gh; y++) {
-		dst[y*stash->params.width] = 0;
-		dst[gw-1 + y*stash->params.width] = 0;
+	return glyph;
+}
+
+// Copies the bitmaps rasterized by workers to the atlas and publishes their glyphs without the pending flag.
+static void fons__landGlyphs(FONScontext* stash)
+{
+	int i, y, n = 0;
+
+	if (stash->njobs == 0) return;
+
+	fons__lock(&stash->lock);
+	for (i = 0; i < stash->njobs; i++) {
+		FONSglyphJob* job = stash->jobs[i];
+		FONSglyph* glyph = job->glyph;
+		if (job->state != FONS_JOB_DONE) {
+			stash->jobs[n++] = job;
+			continue;
+		}
+		if (glyph != NULL) {
+			FONSglyph* landed = fons__allocGlyph(job->font);
+			for (y = 0; y < job->height; y++)
+				memcpy(&stash->texData[glyph->x0 + (glyph->y0 + y) * stash->params.width], &job->bitmap[y * job->width], job->width);
+			fons__addDirtyRect(stash, glyph);
+			if (landed != NULL) {
+				*landed = *glyph;
+				landed->pending = 0;
+				if (fons__insertGlyph(job->font, landed))
+					stash->entries[glyph->entry].glyph = landed;
+			}
+		}
+		free(job);
 	}
-	for (x = 0; x < gw; x++) {
-		dst[x] = 0;
-		dst[x + (gh-1)*stash->params.width] = 0;
+	stash->njobs = n;
+	fons__unlock(&stash->lock);
+}
+
+void fonsSetAsyncGlyphs(FONScontext* stash, int enabled)
+{
+	if (stash == NULL) return;
+	if (enabled)
+		stash->params.flags |= FONS_ASYNC_GLYPHS;
+	else
+		stash->params.flags &= ~FONS_ASYNC_GLYPHS;
+}
+
+int fonsRasterizeGlyphs(FONScontext* stash, int maxGlyphs)
+{
+	FONSscratch scratch;
+	int i, n = 0;
+
+	if (stash == NULL) return 0;
+
+	scratch.stash = stash;
+	scratch.data = NULL;
+	scratch.ndata = 0;
+	while (maxGlyphs <= 0 || n < maxGlyphs) {
+		FONSglyphJob* job = NULL;
+		FONSttFontImpl font;
+
+		fons__lock(&stash->lock);
+		for (i = 0; i < stash->njobs; i++) {
+			if (stash->jobs[i]->state == FONS_JOB_QUEUED) {
+				job = stash->jobs[i];
+				job->state = FONS_JOB_RUNNING;
+				break;
+			}
+		}
+		fons__unlock(&stash->lock);
+		if (job == NULL) break;
+
+		if (scratch.data == NULL)
+			scratch.data = (unsigned char*)malloc(FONS_SCRATCH_BUF_SIZE);
+		if (scratch.data == NULL) {
+			fons__lock(&stash->lock);
+			job->state = FONS_JOB_QUEUED;
+			fons__unlock(&stash->lock);
+			break;
+		}
+
+		// The font is only read, rasterize with a copy which allocates from this call's scratch.
+		font = job->renderFont->font;
+		fons__tt_setScratch(&font, &scratch);
+		fons__rasterizeGlyph(&font, &scratch, job->bitmap, job->width, job->index, job->scale, job->shift,
+							 job->width, job->height, job->pad, job->blur);
+
+		fons__lock(&stash->lock);
+		job->state = FONS_JOB_DONE;
+		fons__unlock(&stash->lock);
+		n++;
 	}
+	if (scratch.data != NULL) free(scratch.data);
 
-	// Debug code to color the glyph background
-/*	unsigned char* fdst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
-	for (y = 0; y < gh; y++) {
-		for (x = 0; x < gw; x++) {
-			int a = (int)fdst[x+y*stash->params.width] + 20;
-			if (a > 255) a = 255;
-			fdst[x+y*stash->params.width] = a;
+	return n;
+}
+
+// Kerning advance of a glyph pair in font units. Each pair is cached in one slot of a direct mapped
+// table, packed with its advance into a single word so that lookups need no locking.
+static int fons__getKernAdvance(FONScontext* stash, FONSfont* font, int glyph1, int glyph2)
+{
+#ifdef FONS_USE_FREETYPE
+	// FreeType kerning depends on the size last set on the face.
+	FONS_NOTUSED(stash);
+	return fons__tt_getGlyphKernAdvance(&font->font, glyph1, glyph2);
+#else
+	volatile unsigned long long* kern = (volatile unsigned long long*)fons__loadPtr((void* volatile*)&font->kern);
+	unsigned int key = ((unsigned int)glyph1 << 16) | (unsigned int)glyph2;
+	unsigned long long e;
+	int adv;
+
+	if (glyph1 > 0xffff || glyph2 > 0xffff)
+		return fons__tt_getGlyphKernAdvance(&font->font, glyph1, glyph2);
+
+	if (kern == NULL) {
+		fons__lock(&stash->lock);
+		kern = font->kern;
+		if (kern == NULL) {
+			kern = (volatile unsigned long long*)calloc(FONS_KERN_CACHE_SIZE, sizeof(unsigned long long));
+			if (kern != NULL)
+				fons__storePtr((void* volatile*)&font->kern, (void*)kern);
 		}
-	}*/
+		fons__unlock(&stash->lock);
+		if (kern == NULL)
+			return fons__tt_getGlyphKernAdvance(&font->font, glyph1, glyph2);
+	}
 
-	// Blur
-	if (iblur > 0) {
-		stash->nscratch = 0;
-		bdst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
-		fons__blur(stash, bdst, gw, gh, stash->params.width, iblur);
+	kern += fons__hashint(key) & (FONS_KERN_CACHE_SIZE-1);
+	e = fons__loadU64(kern);
+	if ((e >> 48) != 0 && (unsigned int)e == key)
+		return (short)(unsigned short)(e >> 32);
+
+	adv = fons__tt_getGlyphKernAdvance(&font->font, glyph1, glyph2);
+	fons__storeU64(kern, key | ((unsigned long long)(unsigned short)adv << 32) | (1ull << 48));
+	return adv;
+#endif
+}
+
+// Pen position in 1/FONS_SUBPIXEL_STEPS pixels a glyph at x is drawn at with subpixel positioning.
+static float fons__subpixelPos(float x)
+{
+	return floorf(x * FONS_SUBPIXEL_STEPS + 0.5f);
+}
+
+// Whether the glyphs of the state are placed at subpixel positions. Blurred glyphs would not show
+// it, and distance field glyphs are not snapped to pixels anyway.
+static int fons__subpixel(const FONSstate* state, short gblur)
+{
+#ifdef FONS_USE_FREETYPE
+	FONS_NOTUSED(state);
+	FONS_NOTUSED(gblur);
+	return 0;
+#else
+	return state->subpixel && gblur == 0;
+#endif
+}
+
+// Returns the variant of the glyph drawn at pen position x with subpixel positioning, rasterized at
+// the nearest of the FONS_SUBPIXEL_STEPS offsets. The glyph passed in is any variant, for its metrics.
+static FONSglyph* fons__getSubpixelGlyph(FONScontext* stash, FONSfont* font, FONSglyph* glyph, int prevGlyphIndex,
+										 float scale, float spacing, float x, int bitmapOption)
+{
+	int phase;
+
+	if (prevGlyphIndex != -1)
+		x += fons__getKernAdvance(stash, font, prevGlyphIndex, glyph->index) * scale + spacing;
+	phase = (int)fons__subpixelPos(x) & (FONS_SUBPIXEL_STEPS-1);
+	if (glyph->phase == phase && bitmapOption == FONS_GLYPH_BITMAP_OPTIONAL)
+		return glyph;
+
+	return fons__getGlyph(stash, font, glyph->codepoint, glyph->size, glyph->blur, (short)phase, bitmapOption);
+}
+
+static void fons__getQuadSDF(FONScontext* stash, FONSfont* font,
+							 int prevGlyphIndex, FONSglyph* glyph,
+							 float scale, float spacing, float sdfScale, float* x, float* y, FONSquad* q)
+{
+	float rx,ry,xoff,yoff,x0,y0,x1,y1;
+
+	if (prevGlyphIndex != -1) {
+		float adv = fons__getKernAdvance(stash, font, prevGlyphIndex, glyph->index) * scale;
+		*x += adv + spacing;
 	}
 
-	stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], glyph->x0);
-	stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], glyph->y0);
-	stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], glyph->x1);
-	stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], glyph->y1);
+	// Inset by one texel like bitmap glyphs, the field is far from the edge there.
+	xoff = (float)(glyph->xoff+1) * sdfScale;
+	yoff = (float)(glyph->yoff+1) * sdfScale;
+	x0 = (float)(glyph->x0+1);
+	y0 = (float)(glyph->y0+1);
+	x1 = (float)(glyph->x1-1);
+	y1 = (float)(glyph->y1-1);
 
-	return glyph;
+	rx = *x + xoff;
+	q->x0 = rx;
+	q->x1 = rx + (x1 - x0) * sdfScale;
+	if (stash->params.flags & FONS_ZERO_TOPLEFT) {
+		ry = *y + yoff;
+		q->y0 = ry;
+		q->y1 = ry + (y1 - y0) * sdfScale;
+	} else {
+		ry = *y - yoff;
+		q->y0 = ry;
+		q->y1 = ry - (y1 - y0) * sdfScale;
+	}
+	q->s0 = x0 * stash->itw;
+	q->t0 = y0 * stash->ith;
+	q->s1 = x1 * stash->itw;
+	q->t1 = y1 * stash->ith;
+
+	*x += glyph->xadv / 10.0f * sdfScale;
 }
 
+// Distance field glyphs (sdfScale > 0) are scaled to the text size and not snapped to pixels.
+// With subpixel positioning the pen is not snapped either, the bitmap is placed at the pixel
+// which puts its offset nearest to the pen.
 static void fons__getQuad(FONScontext* stash, FONSfont* font,
 						   int prevGlyphIndex, FONSglyph* glyph,
-						   float scale, float spacing, float* x, float* y, FONSquad* q)
+						   float scale, float spacing, float sdfScale, int subpixel, float* x, float* y, FONSquad* q)
 {
 	float rx,ry,xoff,yoff,x0,y0,x1,y1;
 
+	if (sdfScale > 0.0f) {
+		fons__getQuadSDF(stash, font, prevGlyphIndex, glyph, scale, spacing, sdfScale, x, y, q);
+		return;
+	}
+
 	if (prevGlyphIndex != -1) {
-		float adv = fons__tt_getGlyphKernAdvance(&font->font, prevGlyphIndex, glyph->index) * scale;
-		*x += (int)(adv + spacing + 0.5f);
+		float adv = fons__getKernAdvance(stash, font, prevGlyphIndex, glyph->index) * scale;
+		if (subpixel)
+			*x += adv + spacing;
+		else
+			*x += (int)(adv + spacing + 0.5f);
 	}
 
 	// Each glyph has 2px border to allow good interpolation,
@@ -1225,7 +2562,7 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 	y1 = (float)(glyph->y1-1);
 
 	if (stash->params.flags & FONS_ZERO_TOPLEFT) {
-		rx = floorf(*x + xoff);
+		rx = subpixel ? floorf((fons__subpixelPos(*x) - glyph->phase) / FONS_SUBPIXEL_STEPS + 0.5f) + xoff : floorf(*x + xoff);
 		ry = floorf(*y + yoff);
 
 		q->x0 = rx;
@@ -1238,7 +2575,7 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 		q->s1 = x1 * stash->itw;
 		q->t1 = y1 * stash->ith;
 	} else {
-		rx = floorf(*x + xoff);
+		rx = subpixel ? floorf((fons__subpixelPos(*x) - glyph->phase) / FONS_SUBPIXEL_STEPS + 0.5f) + xoff : floorf(*x + xoff);
 		ry = floorf(*y - yoff);
 
 		q->x0 = rx;
@@ -1252,11 +2589,16 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 		q->t1 = y1 * stash->ith;
 	}
 
-	*x += (int)(glyph->xadv / 10.0f + 0.5f);
+	if (subpixel)
+		*x += glyph->xadv / 10.0f;
+	else
+		*x += (int)(glyph->xadv / 10.0f + 0.5f);
 }
 
 static void fons__flush(FONScontext* stash)
 {
+	fons__landGlyphs(stash);
+
 	// Flush texture
 	if (stash->dirtyRect[0] < stash->dirtyRect[2] && stash->dirtyRect[1] < stash->dirtyRect[3]) {
 		if (stash->params.renderUpdate != NULL)
@@ -1286,6 +2628,22 @@ static __inline void fons__vertex(FONScontext* stash, float x, float y, float s,
 	stash->nverts++;
 }
 
+// Returns the size and blur the glyphs of the state are cached with. Distance field glyphs are
+// cached at one size, the returned factor scales them to the text size, 0 for other glyphs.
+static float fons__glyphKey(const FONSstate* state, short isize, short* gsize, short* gblur)
+{
+	*gsize = isize;
+	*gblur = (short)state->blur;
+#ifndef FONS_USE_FREETYPE
+	if (state->sdf && isize >= 2) {
+		*gsize = FONS_SDF_SIZE*10;
+		*gblur = FONS_SDF_BLUR;
+		return (float)isize/10.0f / FONS_SDF_SIZE;
+	}
+#endif
+	return 0.0f;
+}
+
 static float fons__getVertAlign(FONScontext* stash, FONSfont* font, int align, short isize)
 {
 	if (stash->params.flags & FONS_ZERO_TOPLEFT) {
@@ -1317,6 +2675,7 @@ float fonsDrawText(FONScontext* stash,
 				   const char* str, const char* end)
 {
 	FONSstate* state = fons__getState(stash);
+	FONSstate bitmapState;
 	unsigned int codepoint;
 	unsigned int utf8state = 0;
 	FONSglyph* glyph = NULL;
@@ -1324,6 +2683,7 @@ float fonsDrawText(FONScontext* stash,
 	int prevGlyphIndex = -1;
 	short isize = (short)(state->size*10.0f);
 	short iblur = (short)state->blur;
+	int subpixel = fons__subpixel(state, iblur);
 	float scale;
 	FONSfont* font;
 	float width;
@@ -1338,14 +2698,16 @@ float fonsDrawText(FONScontext* stash,
 	if (end == NULL)
 		end = str + strlen(str);
 
-	// Align horizontally
+	// Align horizontally, this draws bitmap glyphs also in distance field mode.
+	bitmapState = *state;
+	bitmapState.sdf = 0;
 	if (state->align & FONS_ALIGN_LEFT) {
 		// empty
 	} else if (state->align & FONS_ALIGN_RIGHT) {
-		width = fonsTextBounds(stash, x,y, str, end, NULL);
+		width = fonsTextBoundsState(stash, &bitmapState, x,y, str, end, NULL);
 		x -= width;
 	} else if (state->align & FONS_ALIGN_CENTER) {
-		width = fonsTextBounds(stash, x,y, str, end, NULL);
+		width = fonsTextBoundsState(stash, &bitmapState, x,y, str, end, NULL);
 		x -= width * 0.5f;
 	}
 	// Align vertically.
@@ -1354,9 +2716,20 @@ float fonsDrawText(FONScontext* stash,
 	for (; str != end; ++str) {
 		if (fons__decutf8(&utf8state, &codepoint, *(const unsigned char*)str))
 			continue;
-		glyph = fons__getGlyph(stash, font, codepoint, isize, iblur, FONS_GLYPH_BITMAP_REQUIRED);
+		if (subpixel) {
+			glyph = fons__getGlyph(stash, font, codepoint, isize, iblur, 0, FONS_GLYPH_BITMAP_OPTIONAL);
+			if (glyph != NULL)
+				glyph = fons__getSubpixelGlyph(stash, font, glyph, prevGlyphIndex, scale, state->spacing, x, FONS_GLYPH_BITMAP_REQUIRED);
+		} else {
+			glyph = fons__getGlyph(stash, font, codepoint, isize, iblur, 0, FONS_GLYPH_BITMAP_REQUIRED);
+		}
 		if (glyph != NULL) {
-			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
+			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, 0.0f, subpixel, &x, &y, &q);
+			if (glyph->pending) {
+				// Not rasterized yet, leave it out.
+				prevGlyphIndex = glyph->index;
+				continue;
+			}
 
 			if (stash->nverts+6 > FONS_VERTEX_COUNT)
 				fons__flush(stash);
@@ -1376,10 +2749,47 @@ float fonsDrawText(FONScontext* stash,
 	return x;
 }
 
+int fonsPrewarmGlyphs(FONScontext* stash, unsigned int first, unsigned int last)
+{
+	FONSstate* state;
+	FONSfont* font;
+	FONSfont* renderFont;
+	unsigned int codepoint;
+	short isize, iblur;
+	int phase, nphases;
+
+	if (stash == NULL) return 0;
+	state = fons__getState(stash);
+	if (state->font < 0 || state->font >= stash->nfonts) return 0;
+	font = stash->fonts[state->font];
+	if (font->data == NULL) return 0;
+	fons__glyphKey(state, (short)(state->size*10.0f), &isize, &iblur);
+	if (isize < 2) return 1;
+
+	// With subpixel positioning a glyph can be drawn at any of the phases.
+	nphases = fons__subpixel(state, iblur) ? FONS_SUBPIXEL_STEPS : 1;
+
+	for (codepoint = first; codepoint <= last; codepoint++) {
+		if (fons__glyphIndex(stash, font, codepoint, &renderFont) != 0) {
+			for (phase = 0; phase < nphases; phase++) {
+				if (fons__getGlyph(stash, font, codepoint, isize, iblur, (short)phase, FONS_GLYPH_BITMAP_REQUIRED) == NULL)
+					return 0;
+			}
+		}
+		if (codepoint == last) break;
+	}
+	return 1;
+}
+
 int fonsTextIterInit(FONScontext* stash, FONStextIter* iter,
 					 float x, float y, const char* str, const char* end, int bitmapOption)
 {
-	FONSstate* state = fons__getState(stash);
+	return fonsTextIterInitState(stash, fons__getState(stash), iter, x, y, str, end, bitmapOption);
+}
+
+int fonsTextIterInitState(FONScontext* stash, const FONSstate* state, FONStextIter* iter,
+						  float x, float y, const char* str, const char* end, int bitmapOption)
+{
 	float width;
 
 	memset(iter, 0, sizeof(*iter));
@@ -1397,10 +2807,10 @@ int fonsTextIterInit(FONScontext* stash, FONStextIter* iter,
 	if (state->align & FONS_ALIGN_LEFT) {
 		// empty
 	} else if (state->align & FONS_ALIGN_RIGHT) {
-		width = fonsTextBounds(stash, x,y, str, end, NULL);
+		width = fonsTextBoundsState(stash, state, x,y, str, end, NULL);
 		x -= width;
 	} else if (state->align & FONS_ALIGN_CENTER) {
-		width = fonsTextBounds(stash, x,y, str, end, NULL);
+		width = fonsTextBoundsState(stash, state, x,y, str, end, NULL);
 		x -= width * 0.5f;
 	}
 	// Align vertically.
@@ -1418,6 +2828,8 @@ int fonsTextIterInit(FONScontext* stash, FONStextIter* iter,
 	iter->codepoint = 0;
 	iter->prevGlyphIndex = -1;
 	iter->bitmapOption = bitmapOption;
+	iter->sdfScale = fons__glyphKey(state, iter->isize, &iter->isize, &iter->iblur);
+	iter->subpixel = fons__subpixel(state, iter->iblur);
 
 	return 1;
 }
@@ -1438,11 +2850,24 @@ int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, FONSquad* quad)
 		// Get glyph and quad
 		iter->x = iter->nextx;
 		iter->y = iter->nexty;
-		glyph = fons__getGlyph(stash, iter->font, iter->codepoint, iter->isize, iter->iblur, iter->bitmapOption);
+		if (iter->subpixel) {
+			glyph = fons__getGlyph(stash, iter->font, iter->codepoint, iter->isize, iter->iblur, 0, FONS_GLYPH_BITMAP_OPTIONAL);
+			if (glyph != NULL)
+				glyph = fons__getSubpixelGlyph(stash, iter->font, glyph, iter->prevGlyphIndex, iter->scale, iter->spacing, iter->x, iter->bitmapOption);
+		} else {
+			glyph = fons__getGlyph(stash, iter->font, iter->codepoint, iter->isize, iter->iblur, 0, iter->bitmapOption);
+		}
 		// If the iterator was initialized with FONS_GLYPH_BITMAP_OPTIONAL, then the UV coordinates of the quad will be invalid.
 		if (glyph != NULL)
-			fons__getQuad(stash, iter->font, iter->prevGlyphIndex, glyph, iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
+			fons__getQuad(stash, iter->font, iter->prevGlyphIndex, glyph, iter->scale, iter->spacing, iter->sdfScale, iter->subpixel, &iter->nextx, &iter->nexty, quad);
+		iter->pending = glyph != NULL && glyph->pending;
 		iter->prevGlyphIndex = glyph != NULL ? glyph->index : -1;
+		iter->entry = -1;
+		iter->serial = 0;
+		if (glyph != NULL && glyph->entry != -1 && iter->bitmapOption == FONS_GLYPH_BITMAP_REQUIRED) {
+			iter->entry = glyph->entry;
+			iter->serial = stash->entries[glyph->entry].serial;
+		}
 		break;
 	}
 	iter->next = str;
@@ -1503,15 +2928,23 @@ float fonsTextBounds(FONScontext* stash,
 					 const char* str, const char* end,
 					 float* bounds)
 {
-	FONSstate* state = fons__getState(stash);
+	return fonsTextBoundsState(stash, fons__getState(stash), x, y, str, end, bounds);
+}
+
+float fonsTextBoundsState(FONScontext* stash, const FONSstate* state,
+						  float x, float y,
+						  const char* str, const char* end,
+						  float* bounds)
+{
 	unsigned int codepoint;
 	unsigned int utf8state = 0;
 	FONSquad q;
 	FONSglyph* glyph = NULL;
 	int prevGlyphIndex = -1;
 	short isize = (short)(state->size*10.0f);
-	short iblur = (short)state->blur;
-	float scale;
+	short gsize, gblur;
+	float scale, sdfScale;
+	int subpixel;
 	FONSfont* font;
 	float startx, advance;
 	float minx, miny, maxx, maxy;
@@ -1522,6 +2955,8 @@ float fonsTextBounds(FONScontext* stash,
 	if (font->data == NULL) return 0;
 
 	scale = fons__tt_getPixelHeightScale(&font->font, (float)isize/10.0f);
+	sdfScale = fons__glyphKey(state, isize, &gsize, &gblur);
+	subpixel = fons__subpixel(state, gblur);
 
 	// Align vertically.
 	y += fons__getVertAlign(stash, font, state->align, isize);
@@ -1536,9 +2971,11 @@ float fonsTextBounds(FONScontext* stash,
 	for (; str != end; ++str) {
 		if (fons__decutf8(&utf8state, &codepoint, *(const unsigned char*)str))
 			continue;
-		glyph = fons__getGlyph(stash, font, codepoint, isize, iblur, FONS_GLYPH_BITMAP_OPTIONAL);
+		glyph = fons__getGlyph(stash, font, codepoint, gsize, gblur, 0, FONS_GLYPH_BITMAP_OPTIONAL);
+		if (glyph != NULL && subpixel)
+			glyph = fons__getSubpixelGlyph(stash, font, glyph, prevGlyphIndex, scale, state->spacing, x, FONS_GLYPH_BITMAP_OPTIONAL);
 		if (glyph != NULL) {
-			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
+			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, sdfScale, subpixel, &x, &y, &q);
 			if (q.x0 < minx) minx = q.x0;
 			if (q.x1 > maxx) maxx = q.x1;
 			if (stash->params.flags & FONS_ZERO_TOPLEFT) {
@@ -1577,9 +3014,14 @@ float fonsTextBounds(FONScontext* stash,
 
 void fonsVertMetrics(FONScontext* stash,
 					 float* ascender, float* descender, float* lineh)
+{
+	fonsVertMetricsState(stash, fons__getState(stash), ascender, descender, lineh);
+}
+
+void fonsVertMetricsState(FONScontext* stash, const FONSstate* state,
+						  float* ascender, float* descender, float* lineh)
 {
 	FONSfont* font;
-	FONSstate* state = fons__getState(stash);
 	short isize;
 
 	if (stash == NULL) return;
@@ -1597,9 +3039,13 @@ void fonsVertMetrics(FONScontext* stash,
 }
 
 void fonsLineBounds(FONScontext* stash, float y, float* miny, float* maxy)
+{
+	fonsLineBoundsState(stash, fons__getState(stash), y, miny, maxy);
+}
+
+void fonsLineBoundsState(FONScontext* stash, const FONSstate* state, float y, float* miny, float* maxy)
 {
 	FONSfont* font;
-	FONSstate* state = fons__getState(stash);
 	short isize;
 
 	if (stash == NULL) return;
@@ -1630,6 +3076,7 @@ const unsigned char* fonsGetTextureData(FONScontext* stash, int* width, int* hei
 
 int fonsValidateTexture(FONScontext* stash, int* dirty)
 {
+	fons__landGlyphs(stash);
 	if (stash->dirtyRect[0] < stash->dirtyRect[2] && stash->dirtyRect[1] < stash->dirtyRect[3]) {
 		dirty[0] = stash->dirtyRect[0];
 		dirty[1] = stash->dirtyRect[1];
@@ -1659,7 +3106,12 @@ void fonsDeleteInternal(FONScontext* stash)
 	if (stash->atlas) fons__deleteAtlas(stash->atlas);
 	if (stash->fonts) free(stash->fonts);
 	if (stash->texData) free(stash->texData);
-	if (stash->scratch) free(stash->scratch);
+	if (stash->scratch.data) free(stash->scratch.data);
+	for (i = 0; i < stash->njobs; i++)
+		free(stash->jobs[i]);
+	if (stash->jobs) free(stash->jobs);
+	if (stash->entries) free(stash->entries);
+	if (stash->lru) free(stash->lru);
 	free(stash);
 	fons__tt_done(stash);
 }
@@ -1736,7 +3188,7 @@ int fonsExpandAtlas(FONScontext* stash, int width, int height)
 
 int fonsResetAtlas(FONScontext* stash, int width, int height)
 {
-	int i, j;
+	int i;
 	if (stash == NULL) return 0;
 
 	// Flush pending glyphs.
@@ -1763,23 +3215,168 @@ int fonsResetAtlas(FONScontext* stash, int width, int height)
 	stash->dirtyRect[3] = 0;
 
 	// Reset cached glyphs
-	for (i = 0; i < stash->nfonts; i++) {
-		FONSfont* font = stash->fonts[i];
-		font->nglyphs = 0;
-		for (j = 0; j < FONS_HASH_LUT_SIZE; j++)
-			font->lut[j] = -1;
+	fons__cancelGlyphJobs(stash, NULL);
+	fons__dropEntries(stash, NULL);
+	for (i = 0; i < stash->nfonts; i++)
+		fons__resetGlyphs(stash->fonts[i]);
+
+	stash->params.width = width;
+	stash->params.height = height;
+	stash->itw = 1.0f/stash->params.width;
+	stash->ith = 1.0f/stash->params.height;
+
+	// Add white rect at 0,0 for debug drawing.
+	fons__addWhiteRect(stash, 2,2);
+
+	return 1;
+}
+
+int fonsCompactAtlas(FONScontext* stash, int width, int height)
+{
+	FONSlruItem* items = NULL;
+	unsigned char* data = NULL;
+	unsigned char* old;
+	int i, j, n = 0, area = 0, oldWidth, maxy = 0;
+
+	if (stash == NULL) return 0;
+
+	// Flush pending glyphs.
+	fons__flush(stash);
+
+	data = (unsigned char*)malloc(width * height);
+	if (data == NULL) goto error;
+	memset(data, 0, width * height);
+	if (stash->nentries > 0) {
+		items = (FONSlruItem*)malloc(sizeof(FONSlruItem) * stash->nentries);
+		if (items == NULL) goto error;
 	}
 
+	// Create new texture
+	if ((width != stash->params.width || height != stash->params.height) && stash->params.renderResize != NULL) {
+		if (stash->params.renderResize(stash->params.userPtr, width, height) == 0)
+			goto error;
+	}
+
+	// Most recently drawn first.
+	for (i = 0; i < stash->nentries; i++) {
+		if (stash->entries[i].glyph != NULL) {
+			items[n].key = -stash->entries[i].used;
+			items[n].entry = i;
+			n++;
+		}
+	}
+	if (n > 0)
+		qsort(items, n, sizeof(FONSlruItem), fons__cmpLruItem);
+
+	// Keep the ones filling up to 3/4 of the atlas, so that there is room for new glyphs,
+	// packed tallest first, which packs tighter. The rest is evicted.
+	for (j = 0; j < n; j++) {
+		FONSglyph* g = stash->entries[items[j].entry].glyph;
+		area += (g->x1 - g->x0) * (g->y1 - g->y0);
+		if (area > width * height / 4 * 3) break;
+	}
+	for (i = j; i < n; i++)
+		fons__freeEntry(stash, items[i].entry);
+	n = j;
+	for (i = 0; i < n; i++) {
+		FONSglyph* g = stash->entries[items[i].entry].glyph;
+		items[i].key = -(g->y1 - g->y0);
+	}
+	if (n > 0)
+		qsort(items, n, sizeof(FONSlruItem), fons__cmpLruItem);
+
+	old = stash->texData;
+	oldWidth = stash->params.width;
+	stash->texData = data;
 	stash->params.width = width;
 	stash->params.height = height;
 	stash->itw = 1.0f/stash->params.width;
 	stash->ith = 1.0f/stash->params.height;
+	fons__atlasReset(stash->atlas, width, height);
 
 	// Add white rect at 0,0 for debug drawing.
 	fons__addWhiteRect(stash, 2,2);
 
+	for (i = 0; i < n; i++) {
+		FONSatlasEntry* e = &stash->entries[items[i].entry];
+		int w = e->glyph->x1 - e->glyph->x0, h = e->glyph->y1 - e->glyph->y0, x, y;
+		if (fons__atlasAddRect(stash->atlas, w, h, &x, &y)) {
+			for (j = 0; j < h; j++)
+				memcpy(&data[x + (y + j) * width], &old[e->x + (e->y + j) * oldWidth], w);
+			e->x = (short)x;
+			e->y = (short)y;
+			e->serial = ++stash->serial;
+		} else {
+			fons__freeEntry(stash, items[i].entry);
+		}
+	}
+	free(old);
+	if (items != NULL) free(items);
+
+	// Move the glyphs to their new place.
+	for (i = 0; i < stash->nfonts; i++) {
+		if (!fons__collectGlyphs(stash, stash->fonts[i])) {
+			// Out of memory, start over with the glyphs of the font.
+			fons__cancelGlyphJobs(stash, stash->fonts[i]);
+			fons__dropEntries(stash, stash->fonts[i]);
+			fons__resetGlyphs(stash->fonts[i]);
+		}
+	}
+
+	// Add the whole atlas as dirty.
+	for (i = 0; i < stash->atlas->nnodes; i++)
+		maxy = fons__maxi(maxy, stash->atlas->nodes[i].y);
+	stash->dirtyRect[0] = 0;
+	stash->dirtyRect[1] = 0;
+	stash->dirtyRect[2] = width;
+	stash->dirtyRect[3] = maxy;
+
+	stash->lruFrame = -1;
+	stash->compactFrame = stash->frame;
+
 	return 1;
+
+error:
+	if (data != NULL) free(data);
+	if (items != NULL) free(items);
+	return 0;
 }
 
+void fonsEndFrame(FONScontext* stash)
+{
+	FONSatlas* atlas;
+	int i, used = 0;
+
+	if (stash == NULL) return;
+	atlas = stash->atlas;
+	stash->frame++;
+
+	// Compact when the holes left by evicted glyphs make up a quarter of the part of the atlas in use.
+	if (stash->frame - stash->compactFrame >= FONS_COMPACT_FRAMES && atlas->freeArea > 0) {
+		for (i = 0; i < atlas->nnodes; i++)
+			used += atlas->nodes[i].width * atlas->nodes[i].y;
+		if (atlas->freeArea * 4 > used && used * 2 > atlas->width * atlas->height) {
+			fonsCompactAtlas(stash, atlas->width, atlas->height);
+			return;
+		}
+	}
+
+	// Free the glyphs replaced by evicting or adding bitmaps.
+	for (i = 0; i < stash->nfonts; i++) {
+		FONSfont* font = stash->fonts[i];
+		if (font->nretired > font->table->nglyphs + FONS_INIT_GLYPHS)
+			fons__collectGlyphs(stash, font);
+	}
+}
+
+int fonsTouchGlyph(FONScontext* stash, int entry, unsigned int serial)
+{
+	FONSatlasEntry* e;
+	if (stash == NULL || entry < 0 || entry >= stash->nentries) return 0;
+	e = &stash->entries[entry];
+	if (e->glyph == NULL || e->serial != serial) return 0;
+	e->used = stash->frame;
+	return 1;
+}
 
 #endif
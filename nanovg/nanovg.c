@@ -27,6 +27,12 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+// Define NVG_NO_SIMD to use the plain C point transform and bezier flattener on SSE2 targets too.
+#if !defined(NVG_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define NVG_SSE2 1
+#include <emmintrin.h>
+#endif
+
 #ifdef _MSC_VER
 #pragma warning(disable: 4100)  // unreferenced formal parameter
 #pragma warning(disable: 4127)  // conditional expression is constant
@@ -39,10 +45,21 @@
 #define NVG_MAX_FONTIMAGES       4
 
 #define NVG_INIT_COMMANDS_SIZE 256
+#define NVG_INIT_COMMAND_POINTS_SIZE 256
 #define NVG_INIT_POINTS_SIZE 128
 #define NVG_INIT_PATHS_SIZE 16
 #define NVG_INIT_VERTS_SIZE 256
 #define NVG_MAX_STATES 32
+#define NVG_MAX_BEZIER_SEGMENTS 1024
+#define NVG_BEZIER_BATCH 32			// Points of a bezier evaluated before they are added, must be even.
+#define NVG_MAX_FAST_FILL_POINTS 16
+#define NVG_MAX_TRIANGULATE_VERTS 256
+#define NVG_TEXT_CACHE_RUNS 256
+#define NVG_TEXT_CACHE_LUT 512		// Must be power of two.
+#define NVG_TEXT_CACHE_MAX_CHARS 256	// Longer strings are shaped on every call.
+
+#define NVG_ARENA_ALIGN 16
+#define NVG_ARENA_GRANULARITY 4096
 
 #define NVG_KAPPA90 0.5522847493f	// Length proportional to radius of a cubic bezier handle for 90deg arcs.
 
@@ -57,6 +74,13 @@ enum NVGcommands {
 	NVG_WINDING = 4,
 };
 
+// Geometry class of the current path, tracked while recording, see nvgFill().
+enum NVGpathClass {
+	NVG_CLASS_POLYGON,	// Single sub-path of straight lines.
+	NVG_CLASS_CONVEX,	// Single convex shape with curves, rounded rect or ellipse.
+	NVG_CLASS_COMPLEX,
+};
+
 enum NVGpointFlags
 {
 	NVG_PT_CORNER = 0x01,
@@ -82,6 +106,8 @@ struct NVGstate {
 	float lineHeight;
 	float fontBlur;
 	int textAlign;
+	int textSDF;
+	int textSubpixel;
 	int fontId;
 };
 typedef struct NVGstate NVGstate;
@@ -109,19 +135,123 @@ struct NVGpathCache {
 };
 typedef struct NVGpathCache NVGpathCache;
 
+// Glyph quad of a shaped text run, in font pixels relative to the pixel the run origin falls in,
+// or to the origin itself for distance field glyphs, which are not snapped to pixels.
+struct NVGtextQuad {
+	float x0,y0,s0,t0;
+	float x1,y1,s1,t1;
+	int entry;				// Atlas entry of the glyph, the quad is stale once the glyph is evicted or moved.
+	unsigned int serial;
+};
+typedef struct NVGtextQuad NVGtextQuad;
+
+struct NVGtextRun {
+	unsigned int hash;
+	int font;
+	int align;
+	float size;
+	float spacing;
+	float blur;
+	int sdf;
+	int subpixel;	// 1 + subpixel phase of the origin, 0 if glyphs are not placed at subpixel positions.
+	char* text;
+	int ntext;
+	int ctext;
+	NVGtextQuad* quads;
+	int nquads;
+	int cquads;
+	float width;	// Advance of the run, used for horizontal alignment.
+	float valign;	// Offset of the baseline from the origin.
+	int next;		// Next run in the hash chain.
+	int prev, succ;	// Neighbours in the LRU list.
+};
+typedef struct NVGtextRun NVGtextRun;
+
+// LRU cache of shaped nvgText() runs, so that repeated strings skip decoding, glyph lookup and kerning.
+struct NVGtextCache {
+	NVGtextRun runs[NVG_TEXT_CACHE_RUNS];
+	int nruns;
+	int lut[NVG_TEXT_CACHE_LUT];
+	int head, tail;	// Most and least recently used run.
+	NVGtextQuad* quads;	// Quads of the run being shaped.
+	int cquads;
+	int hits;
+	int misses;
+};
+typedef struct NVGtextCache NVGtextCache;
+
+// Row of a text layout, with offsets into the layout text so that appending can move it.
+struct NVGtextLayoutRow {
+	int start, end, next;
+	float width;
+	float minx, maxx;
+};
+typedef struct NVGtextLayoutRow NVGtextLayoutRow;
+
+struct NVGtextLayout {
+	char* text;
+	int ntext;
+	int ctext;
+	NVGtextLayoutRow* rows;
+	int nrows;
+	int crows;
+	int nfinal;			// Rows ended by a new line, these are kept when text is appended.
+	int dirty;			// The rows after nfinal need to be broken again.
+	float breakRowWidth;
+	FONSstate fstate;	// Text style the rows were broken with.
+	float scale;
+};
+
+// Text quads sharing atlas, paint, scissor and composite operation, handed to the back-end as one
+// triangles call when something else is drawn or the frame ends.
+struct NVGtextBatch {
+	NVGpaint paint;
+	NVGcompositeOperationState compositeOperation;
+	NVGscissor scissor;
+	int sdf;
+	float sdfScale;
+	NVGvertex* verts;
+	int nverts;
+	int cverts;
+	NVGvertex* reserved;	// The batch in the back-end's vertex storage, NULL when it is in verts.
+};
+typedef struct NVGtextBatch NVGtextBatch;
+
+// Linear allocator for the per-frame buffers. Allocations are bumped from a single block,
+// and requests that do not fit are served from the heap until the next reset, where the
+// block is grown to the high-water mark of the frame.
+struct NVGarena {
+	unsigned char* mem;
+	int size;
+	int used;
+	int requested;
+	int external;
+	unsigned char* overflow;
+	int nallocs;
+};
+typedef struct NVGarena NVGarena;
+
 struct NVGcontext {
 	NVGparams params;
-	float* commands;
+	NVGarena arena;
+	unsigned char* commands;
 	int ccommands;
 	int ncommands;
+	float* commandPoints;
+	int ccommandPoints;
+	int ncommandPoints;
+	int pathClass;
 	float commandx, commandy;
 	NVGstate states[NVG_MAX_STATES];
 	int nstates;
 	NVGpathCache* cache;
+	NVGtextCache* textCache;
+	NVGtextBatch textBatch;
 	float tessTol;
 	float distTol;
 	float fringeWidth;
 	float devicePxRatio;
+	float viewWidth, viewHeight;
 	struct FONScontext* fs;
 	int fontImages[NVG_MAX_FONTIMAGES];
 	int fontImageIdx;
@@ -129,6 +259,8 @@ struct NVGcontext {
 	int fillTriCount;
 	int strokeTriCount;
 	int textTriCount;
+	int culledFillCount;
+	int culledStrokeCount;
 };
 
 static float nvg__sqrtf(float a) { return sqrtf(a); }
@@ -161,40 +293,175 @@ static float nvg__normalize(float *x, float* y)
 }
 
 
+static int nvg__arenaRound(int size)
+{
+	return (size + NVG_ARENA_ALIGN-1) & ~(NVG_ARENA_ALIGN-1);
+}
+
+static void nvg__arenaFreeOverflow(NVGarena* arena)
+{
+	while (arena->overflow != NULL) {
+		unsigned char* block = arena->overflow;
+		arena->overflow = *(unsigned char**)block;
+		free(block);
+	}
+}
+
+static void nvg__deleteArena(NVGarena* arena)
+{
+	nvg__arenaFreeOverflow(arena);
+	if (arena->mem != NULL && !arena->external) free(arena->mem);
+	memset(arena, 0, sizeof(*arena));
+}
+
+// Starts a new frame, all previous allocations become invalid.
+// The block is grown to fit the high-water mark of the previous frame or minSize, whichever is larger.
+static void nvg__arenaReset(NVGarena* arena, int minSize)
+{
+	int size = arena->requested > minSize ? arena->requested : minSize;
+
+	nvg__arenaFreeOverflow(arena);
+	arena->nallocs = 0;
+
+	if (size > arena->size) {
+		unsigned char* mem;
+		size = (size + NVG_ARENA_GRANULARITY-1) & ~(NVG_ARENA_GRANULARITY-1);
+		mem = (unsigned char*)malloc(size);
+		if (mem != NULL) {
+			if (arena->mem != NULL && !arena->external) free(arena->mem);
+			arena->mem = mem;
+			arena->size = size;
+			arena->external = 0;
+			arena->nallocs++;
+		}
+	}
+
+	arena->used = 0;
+	arena->requested = 0;
+}
+
+static void* nvg__arenaAlloc(NVGarena* arena, int size)
+{
+	unsigned char* block;
+
+	size = nvg__arenaRound(size);
+	arena->requested += size;
+
+	if (arena->used + size <= arena->size) {
+		block = arena->mem + arena->used;
+		arena->used += size;
+		return block;
+	}
+
+	// Out of reserved memory, use heap until the arena is grown on next reset.
+	block = (unsigned char*)malloc(NVG_ARENA_ALIGN + size);
+	if (block == NULL) return NULL;
+	*(unsigned char**)block = arena->overflow;
+	arena->overflow = block;
+	arena->nallocs++;
+	return block + NVG_ARENA_ALIGN;
+}
+
+static void* nvg__arenaRealloc(NVGarena* arena, void* ptr, int oldSize, int newSize)
+{
+	unsigned char* block = (unsigned char*)ptr;
+
+	oldSize = nvg__arenaRound(oldSize);
+	newSize = nvg__arenaRound(newSize);
+
+	// Grow in place if this is the most recent allocation.
+	if (block != NULL && block >= arena->mem && block + oldSize == arena->mem + arena->used &&
+		arena->used - oldSize + newSize <= arena->size) {
+		arena->used += newSize - oldSize;
+		arena->requested += newSize - oldSize;
+		return block;
+	}
+
+	block = (unsigned char*)nvg__arenaAlloc(arena, newSize);
+	if (block != NULL && ptr != NULL)
+		memcpy(block, ptr, oldSize < newSize ? oldSize : newSize);
+	return block;
+}
+
 static void nvg__deletePathCache(NVGpathCache* c)
 {
 	if (c == NULL) return;
-	if (c->points != NULL) free(c->points);
-	if (c->paths != NULL) free(c->paths);
-	if (c->verts != NULL) free(c->verts);
 	free(c);
 }
 
 static NVGpathCache* nvg__allocPathCache(void)
 {
 	NVGpathCache* c = (NVGpathCache*)malloc(sizeof(NVGpathCache));
-	if (c == NULL) goto error;
+	if (c == NULL) return NULL;
 	memset(c, 0, sizeof(NVGpathCache));
 
-	c->points = (NVGpoint*)malloc(sizeof(NVGpoint)*NVG_INIT_POINTS_SIZE);
-	if (!c->points) goto error;
-	c->npoints = 0;
+	// The buffers are carved out of the frame arena in nvg__resetFrameMemory().
 	c->cpoints = NVG_INIT_POINTS_SIZE;
-
-	c->paths = (NVGpath*)malloc(sizeof(NVGpath)*NVG_INIT_PATHS_SIZE);
-	if (!c->paths) goto error;
-	c->npaths = 0;
 	c->cpaths = NVG_INIT_PATHS_SIZE;
-
-	c->verts = (NVGvertex*)malloc(sizeof(NVGvertex)*NVG_INIT_VERTS_SIZE);
-	if (!c->verts) goto error;
-	c->nverts = 0;
 	c->cverts = NVG_INIT_VERTS_SIZE;
 
 	return c;
-error:
-	nvg__deletePathCache(c);
-	return NULL;
+}
+
+static void nvg__clearTextCache(NVGtextCache* c)
+{
+	int i;
+	for (i = 0; i < NVG_TEXT_CACHE_LUT; i++)
+		c->lut[i] = -1;
+	c->nruns = 0;
+	c->head = c->tail = -1;
+}
+
+static void nvg__deleteTextCache(NVGtextCache* c)
+{
+	int i;
+	if (c == NULL) return;
+	for (i = 0; i < NVG_TEXT_CACHE_RUNS; i++) {
+		free(c->runs[i].text);
+		free(c->runs[i].quads);
+	}
+	free(c->quads);
+	free(c);
+}
+
+static NVGtextCache* nvg__allocTextCache(void)
+{
+	NVGtextCache* c = (NVGtextCache*)malloc(sizeof(NVGtextCache));
+	if (c == NULL) return NULL;
+	memset(c, 0, sizeof(NVGtextCache));
+	nvg__clearTextCache(c);
+	return c;
+}
+
+// Resets the frame arena and re-reserves the command and path cache buffers at their current capacity.
+static int nvg__resetFrameMemory(NVGcontext* ctx)
+{
+	NVGpathCache* cache = ctx->cache;
+	int size = nvg__arenaRound(ctx->ccommands) +
+			   nvg__arenaRound(sizeof(float)*2*ctx->ccommandPoints) +
+			   nvg__arenaRound(sizeof(NVGpoint)*cache->cpoints) +
+			   nvg__arenaRound(sizeof(NVGpath)*cache->cpaths) +
+			   nvg__arenaRound(sizeof(NVGvertex)*cache->cverts) +
+			   nvg__arenaRound(sizeof(NVGvertex)*ctx->textBatch.cverts);
+
+	nvg__arenaReset(&ctx->arena, size);
+
+	ctx->commands = (unsigned char*)nvg__arenaAlloc(&ctx->arena, ctx->ccommands);
+	ctx->ncommands = 0;
+	ctx->commandPoints = (float*)nvg__arenaAlloc(&ctx->arena, sizeof(float)*2*ctx->ccommandPoints);
+	ctx->ncommandPoints = 0;
+	cache->points = (NVGpoint*)nvg__arenaAlloc(&ctx->arena, sizeof(NVGpoint)*cache->cpoints);
+	cache->npoints = 0;
+	cache->paths = (NVGpath*)nvg__arenaAlloc(&ctx->arena, sizeof(NVGpath)*cache->cpaths);
+	cache->npaths = 0;
+	cache->verts = (NVGvertex*)nvg__arenaAlloc(&ctx->arena, sizeof(NVGvertex)*cache->cverts);
+	cache->nverts = 0;
+	ctx->textBatch.verts = (NVGvertex*)nvg__arenaAlloc(&ctx->arena, sizeof(NVGvertex)*ctx->textBatch.cverts);
+	ctx->textBatch.nverts = 0;
+	ctx->textBatch.reserved = NULL;
+
+	return ctx->commands != NULL && ctx->commandPoints != NULL && cache->points != NULL && cache->paths != NULL && cache->verts != NULL &&
+		   ctx->textBatch.verts != NULL;
 }
 
 static void nvg__setDevicePixelRatio(NVGcontext* ctx, float ratio)
@@ -295,14 +562,20 @@ NVGcontext* nvgCreateInternal(NVGparams* params)
 	for (i = 0; i < NVG_MAX_FONTIMAGES; i++)
 		ctx->fontImages[i] = 0;
 
-	ctx->commands = (float*)malloc(sizeof(float)*NVG_INIT_COMMANDS_SIZE);
-	if (!ctx->commands) goto error;
 	ctx->ncommands = 0;
 	ctx->ccommands = NVG_INIT_COMMANDS_SIZE;
+	ctx->ncommandPoints = 0;
+	ctx->ccommandPoints = NVG_INIT_COMMAND_POINTS_SIZE;
 
 	ctx->cache = nvg__allocPathCache();
 	if (ctx->cache == NULL) goto error;
 
+	ctx->textCache = nvg__allocTextCache();
+	if (ctx->textCache == NULL) goto error;
+	ctx->textBatch.cverts = NVG_INIT_VERTS_SIZE;
+
+	if (!nvg__resetFrameMemory(ctx)) goto error;
+
 	nvgSave(ctx);
 	nvgReset(ctx);
 
@@ -344,8 +617,9 @@ void nvgDeleteInternal(NVGcontext* ctx)
 {
 	int i;
 	if (ctx == NULL) return;
-	if (ctx->commands != NULL) free(ctx->commands);
 	if (ctx->cache != NULL) nvg__deletePathCache(ctx->cache);
+	if (ctx->textCache != NULL) nvg__deleteTextCache(ctx->textCache);
+	nvg__deleteArena(&ctx->arena);
 
 	if (ctx->fs)
 		fonsDeleteInternal(ctx->fs);
@@ -365,32 +639,104 @@ void nvgDeleteInternal(NVGcontext* ctx)
 
 void nvgBeginFrame(NVGcontext* ctx, float windowWidth, float windowHeight, float devicePixelRatio)
 {
-/*	printf("Tris: draws:%d  fill:%d  stroke:%d  text:%d  TOT:%d\n",
+/*	printf("Tris: draws:%d  fill:%d  stroke:%d  text:%d  TOT:%d  culled fills:%d strokes:%d\n",
 		ctx->drawCallCount, ctx->fillTriCount, ctx->strokeTriCount, ctx->textTriCount,
-		ctx->fillTriCount+ctx->strokeTriCount+ctx->textTriCount);*/
+		ctx->fillTriCount+ctx->strokeTriCount+ctx->textTriCount,
+		ctx->culledFillCount, ctx->culledStrokeCount);*/
 
 	ctx->nstates = 0;
 	nvgSave(ctx);
 	nvgReset(ctx);
 
+	nvg__resetFrameMemory(ctx);
+
 	nvg__setDevicePixelRatio(ctx, devicePixelRatio);
 
 	ctx->params.renderViewport(ctx->params.userPtr, windowWidth, windowHeight, devicePixelRatio);
+	ctx->viewWidth = windowWidth;
+	ctx->viewHeight = windowHeight;
 
 	ctx->drawCallCount = 0;
 	ctx->fillTriCount = 0;
 	ctx->strokeTriCount = 0;
 	ctx->textTriCount = 0;
+	ctx->culledFillCount = 0;
+	ctx->culledStrokeCount = 0;
+}
+
+void nvgFrameArena(NVGcontext* ctx, void* mem, int size)
+{
+	NVGarena* arena = &ctx->arena;
+	nvg__arenaFreeOverflow(arena);
+	if (arena->mem != NULL && !arena->external) free(arena->mem);
+	arena->mem = (unsigned char*)mem;
+	arena->size = mem != NULL ? size : 0;
+	arena->external = mem != NULL ? 1 : 0;
+	arena->requested = 0;
+	nvg__resetFrameMemory(ctx);
+}
+
+int nvgFrameAllocCount(NVGcontext* ctx)
+{
+	return ctx->arena.nallocs;
+}
+
+void nvgCulledCount(NVGcontext* ctx, int* fills, int* strokes)
+{
+	if (fills != NULL) *fills = ctx->culledFillCount;
+	if (strokes != NULL) *strokes = ctx->culledStrokeCount;
+}
+
+static void nvg__flushTextTexture(NVGcontext* ctx)
+{
+	int dirty[4];
+
+	if (fonsValidateTexture(ctx->fs, dirty)) {
+		int fontImage = ctx->fontImages[ctx->fontImageIdx];
+		// Update texture
+		if (fontImage != 0) {
+			int iw, ih;
+			const unsigned char* data = fonsGetTextureData(ctx->fs, &iw, &ih);
+			int x = dirty[0];
+			int y = dirty[1];
+			int w = dirty[2] - dirty[0];
+			int h = dirty[3] - dirty[1];
+			ctx->params.renderUpdateTexture(ctx->params.userPtr, fontImage, x,y, w,h, data);
+		}
+	}
+}
+
+// Hands the batched text to the back-end, before anything else is drawn over it.
+static void nvg__flushTextBatch(NVGcontext* ctx)
+{
+	NVGtextBatch* b = &ctx->textBatch;
+	NVGvertex* verts = b->reserved != NULL ? b->reserved : b->verts;
+	if (b->nverts == 0) return;
+	if (b->sdf)
+		ctx->params.renderTrianglesSDF(ctx->params.userPtr, &b->paint, b->compositeOperation, &b->scissor, verts, b->nverts,
+									   ctx->fringeWidth, FONS_SDF_EDGE / 255.0f, b->sdfScale);
+	else
+		ctx->params.renderTriangles(ctx->params.userPtr, &b->paint, b->compositeOperation, &b->scissor, verts, b->nverts, ctx->fringeWidth);
+	b->nverts = 0;
+	b->reserved = NULL;
+	ctx->drawCallCount++;
 }
 
 void nvgCancelFrame(NVGcontext* ctx)
 {
+	ctx->textBatch.nverts = 0;
+	ctx->textBatch.reserved = NULL;
 	ctx->params.renderCancel(ctx->params.userPtr);
 }
 
 void nvgEndFrame(NVGcontext* ctx)
 {
+	// The glyphs of the whole frame are uploaded at once.
+	nvg__flushTextTexture(ctx);
+	nvg__flushTextBatch(ctx);
 	ctx->params.renderFlush(ctx->params.userPtr);
+	// Glyphs drawn in this frame can be evicted from now on.
+	fonsEndFrame(ctx->fs);
 	if (ctx->fontImageIdx != 0) {
 		int fontImage = ctx->fontImages[ctx->fontImageIdx];
 		int i, j, iw, ih;
@@ -662,6 +1008,8 @@ void nvgReset(NVGcontext* ctx)
 	state->lineHeight = 1.0f;
 	state->fontBlur = 0.0f;
 	state->textAlign = NVG_ALIGN_LEFT | NVG_ALIGN_BASELINE;
+	state->textSDF = 0;
+	state->textSubpixel = 0;
 	state->fontId = 0;
 }
 
@@ -1069,58 +1417,77 @@ static float nvg__distPtSeg(float x, float y, float px, float py, float qx, floa
 	return dx*dx + dy*dy;
 }
 
-static void nvg__appendCommands(NVGcontext* ctx, float* vals, int nvals)
+// Appends opcodes and their points to the path. The opcodes are stored as bytes, NVG_WINDING is
+// followed by the winding direction. The points are stored as x,y pairs in a separate array
+// and transformed by the current transform in one pass.
+static void nvg__appendCommands(NVGcontext* ctx, const unsigned char* cmds, int ncmds, const float* pts, int npts)
 {
 	NVGstate* state = nvg__getState(ctx);
+	const float* t = state->xform;
+	float* dst;
 	int i;
 
-	if (ctx->ncommands+nvals > ctx->ccommands) {
-		float* commands;
-		int ccommands = ctx->ncommands+nvals + ctx->ccommands/2;
-		commands = (float*)realloc(ctx->commands, sizeof(float)*ccommands);
+	if (ctx->ncommands+ncmds > ctx->ccommands) {
+		unsigned char* commands;
+		int ccommands = ctx->ncommands+ncmds + ctx->ccommands/2;
+		commands = (unsigned char*)nvg__arenaRealloc(&ctx->arena, ctx->commands, ctx->ccommands, ccommands);
 		if (commands == NULL) return;
 		ctx->commands = commands;
 		ctx->ccommands = ccommands;
 	}
 
-	if ((int)vals[0] != NVG_CLOSE && (int)vals[0] != NVG_WINDING) {
-		ctx->commandx = vals[nvals-2];
-		ctx->commandy = vals[nvals-1];
+	if (ctx->ncommandPoints+npts > ctx->ccommandPoints) {
+		float* commandPoints;
+		int ccommandPoints = ctx->ncommandPoints+npts + ctx->ccommandPoints/2;
+		commandPoints = (float*)nvg__arenaRealloc(&ctx->arena, ctx->commandPoints, sizeof(float)*2*ctx->ccommandPoints, sizeof(float)*2*ccommandPoints);
+		if (commandPoints == NULL) return;
+		ctx->commandPoints = commandPoints;
+		ctx->ccommandPoints = ccommandPoints;
 	}
 
-	// transform commands
-	i = 0;
-	while (i < nvals) {
-		int cmd = (int)vals[i];
-		switch (cmd) {
-		case NVG_MOVETO:
-			nvgTransformPoint(&vals[i+1],&vals[i+2], state->xform, vals[i+1],vals[i+2]);
-			i += 3;
-			break;
-		case NVG_LINETO:
-			nvgTransformPoint(&vals[i+1],&vals[i+2], state->xform, vals[i+1],vals[i+2]);
-			i += 3;
-			break;
-		case NVG_BEZIERTO:
-			nvgTransformPoint(&vals[i+1],&vals[i+2], state->xform, vals[i+1],vals[i+2]);
-			nvgTransformPoint(&vals[i+3],&vals[i+4], state->xform, vals[i+3],vals[i+4]);
-			nvgTransformPoint(&vals[i+5],&vals[i+6], state->xform, vals[i+5],vals[i+6]);
-			i += 7;
-			break;
-		case NVG_CLOSE:
-			i++;
-			break;
-		case NVG_WINDING:
-			i += 2;
-			break;
-		default:
+	if (npts > 0) {
+		ctx->commandx = pts[npts*2-2];
+		ctx->commandy = pts[npts*2-1];
+	}
+
+	if (ctx->ncommands == 0)
+		ctx->pathClass = cmds[0] == NVG_MOVETO ? NVG_CLASS_POLYGON : NVG_CLASS_COMPLEX;
+	else if (ctx->pathClass != NVG_CLASS_POLYGON && cmds[0] != NVG_WINDING)
+		ctx->pathClass = NVG_CLASS_COMPLEX;
+	for (i = 0; i < ncmds && ctx->pathClass == NVG_CLASS_POLYGON; i++) {
+		if (cmds[i] == NVG_BEZIERTO || (cmds[i] == NVG_MOVETO && ctx->ncommands+i > 0))
+			ctx->pathClass = NVG_CLASS_COMPLEX;
+		else if (cmds[i] == NVG_WINDING)
 			i++;
-		}
 	}
 
-	memcpy(&ctx->commands[ctx->ncommands], vals, nvals*sizeof(float));
+	memcpy(&ctx->commands[ctx->ncommands], cmds, ncmds);
+	ctx->ncommands += ncmds;
 
-	ctx->ncommands += nvals;
+	// transform points
+	dst = &ctx->commandPoints[ctx->ncommandPoints*2];
+	i = 0;
+#ifdef NVG_SSE2
+	{
+		// Two points per register, the products are summed in the same order as below,
+		// so the results are the same.
+		__m128 a = _mm_set_ps(t[1], t[0], t[1], t[0]);
+		__m128 b = _mm_set_ps(t[3], t[2], t[3], t[2]);
+		__m128 c = _mm_set_ps(t[5], t[4], t[5], t[4]);
+		for (; i+1 < npts; i += 2) {
+			__m128 p = _mm_loadu_ps(&pts[i*2]);
+			__m128 xx = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2,2,0,0));
+			__m128 yy = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3,3,1,1));
+			_mm_storeu_ps(&dst[i*2], _mm_add_ps(_mm_add_ps(_mm_mul_ps(xx, a), _mm_mul_ps(yy, b)), c));
+		}
+	}
+#endif
+	for (; i < npts; i++) {
+		float sx = pts[i*2+0], sy = pts[i*2+1];
+		dst[i*2+0] = sx*t[0] + sy*t[2] + t[4];
+		dst[i*2+1] = sx*t[1] + sy*t[3] + t[5];
+	}
+	ctx->ncommandPoints += npts;
 }
 
 
@@ -1143,7 +1510,7 @@ static void nvg__addPath(NVGcontext* ctx)
 	if (ctx->cache->npaths+1 > ctx->cache->cpaths) {
 		NVGpath* paths;
 		int cpaths = ctx->cache->npaths+1 + ctx->cache->cpaths/2;
-		paths = (NVGpath*)realloc(ctx->cache->paths, sizeof(NVGpath)*cpaths);
+		paths = (NVGpath*)nvg__arenaRealloc(&ctx->arena, ctx->cache->paths, sizeof(NVGpath)*ctx->cache->cpaths, sizeof(NVGpath)*cpaths);
 		if (paths == NULL) return;
 		ctx->cache->paths = paths;
 		ctx->cache->cpaths = cpaths;
@@ -1180,7 +1547,7 @@ static void nvg__addPoint(NVGcontext* ctx, float x, float y, int flags)
 	if (ctx->cache->npoints+1 > ctx->cache->cpoints) {
 		NVGpoint* points;
 		int cpoints = ctx->cache->npoints+1 + ctx->cache->cpoints/2;
-		points = (NVGpoint*)realloc(ctx->cache->points, sizeof(NVGpoint)*cpoints);
+		points = (NVGpoint*)nvg__arenaRealloc(&ctx->arena, ctx->cache->points, sizeof(NVGpoint)*ctx->cache->cpoints, sizeof(NVGpoint)*cpoints);
 		if (points == NULL) return;
 		ctx->cache->points = points;
 		ctx->cache->cpoints = cpoints;
@@ -1196,6 +1563,42 @@ static void nvg__addPoint(NVGcontext* ctx, float x, float y, int flags)
 	path->count++;
 }
 
+#ifndef NVG_RECURSIVE_BEZIER
+// Adds count points without flags from x,y pairs, same as calling nvg__addPoint() for each,
+// but the space is reserved once.
+static void nvg__addPoints(NVGcontext* ctx, const float* xy, int count)
+{
+	NVGpathCache* cache = ctx->cache;
+	NVGpath* path = nvg__lastPath(ctx);
+	NVGpoint* pt = NULL;
+	int i;
+	if (path == NULL) return;
+
+	if (cache->npoints+count > cache->cpoints) {
+		NVGpoint* points;
+		int cpoints = cache->npoints+count + cache->cpoints/2;
+		points = (NVGpoint*)nvg__arenaRealloc(&ctx->arena, cache->points, sizeof(NVGpoint)*cache->cpoints, sizeof(NVGpoint)*cpoints);
+		if (points == NULL) return;
+		cache->points = points;
+		cache->cpoints = cpoints;
+	}
+
+	if (path->count > 0 && cache->npoints > 0)
+		pt = &cache->points[cache->npoints-1];
+	for (i = 0; i < count; i++) {
+		float x = xy[i*2], y = xy[i*2+1];
+		if (pt != NULL && nvg__ptEquals(pt->x,pt->y, x,y, ctx->distTol))
+			continue;
+		pt = &cache->points[cache->npoints];
+		memset(pt, 0, sizeof(*pt));
+		pt->x = x;
+		pt->y = y;
+		cache->npoints++;
+		path->count++;
+	}
+}
+#endif
+
 static void nvg__closePath(NVGcontext* ctx)
 {
 	NVGpath* path = nvg__lastPath(ctx);
@@ -1219,10 +1622,15 @@ static float nvg__getAverageScale(float *t)
 
 static NVGvertex* nvg__allocTempVerts(NVGcontext* ctx, int nverts)
 {
+	if (ctx->params.renderReserveVerts != NULL) {
+		NVGvertex* verts = ctx->params.renderReserveVerts(ctx->params.userPtr, nverts);
+		if (verts != NULL) return verts;
+	}
+
 	if (nverts > ctx->cache->cverts) {
 		NVGvertex* verts;
 		int cverts = (nverts + 0xff) & ~0xff; // Round up to prevent allocations when things change just slightly.
-		verts = (NVGvertex*)realloc(ctx->cache->verts, sizeof(NVGvertex)*cverts);
+		verts = (NVGvertex*)nvg__arenaRealloc(&ctx->arena, ctx->cache->verts, sizeof(NVGvertex)*ctx->cache->cverts, sizeof(NVGvertex)*cverts);
 		if (verts == NULL) return NULL;
 		ctx->cache->verts = verts;
 		ctx->cache->cverts = cverts;
@@ -1275,6 +1683,7 @@ static void nvg__vset(NVGvertex* vtx, float x, float y, float u, float v)
 	vtx->v = v;
 }
 
+#ifdef NVG_RECURSIVE_BEZIER
 static void nvg__tesselateBezier(NVGcontext* ctx,
 								 float x1, float y1, float x2, float y2,
 								 float x3, float y3, float x4, float y4,
@@ -1317,6 +1726,94 @@ static void nvg__tesselateBezier(NVGcontext* ctx,
 	nvg__tesselateBezier(ctx, x1,y1, x12,y12, x123,y123, x1234,y1234, level+1, 0);
 	nvg__tesselateBezier(ctx, x1234,y1234, x234,y234, x34,y34, x4,y4, level+1, type);
 }
+#else
+
+// Flattens a cubic bezier into uniform segments. The segment count is derived from the
+// second differences of the control points (Wang's formula), which bounds the distance between
+// the curve and the segments to tessTol, and the points are evaluated using forward differencing,
+// NVG_BEZIER_BATCH points at a time.
+static void nvg__flattenBezier(NVGcontext* ctx,
+							   float x1, float y1, float x2, float y2,
+							   float x3, float y3, float x4, float y4,
+							   int type)
+{
+	float ddx0 = x1 - 2*x2 + x3, ddy0 = y1 - 2*y2 + y3;
+	float ddx1 = x2 - 2*x3 + x4, ddy1 = y2 - 2*y3 + y4;
+	float dd = nvg__maxf(ddx0*ddx0 + ddy0*ddy0, ddx1*ddx1 + ddy1*ddy1);
+	float pts[NVG_BEZIER_BATCH*2];
+	float ax, ay, bx, by, cx, cy, h, fn;
+	int i, j, n;
+
+	// Clamp before converting, huge, infinite or NaN coordinates do not fit in an int.
+	fn = ceilf(sqrtf(0.75f * sqrtf(dd) / ctx->tessTol));
+	n = fn >= 1.0f ? (fn < NVG_MAX_BEZIER_SEGMENTS ? (int)fn : NVG_MAX_BEZIER_SEGMENTS) : 1;
+
+	// Power basis: B(t) = a*t^3 + b*t^2 + c*t + p1
+	cx = 3*(x2 - x1);
+	cy = 3*(y2 - y1);
+	bx = 3*(x3 - 2*x2 + x1);
+	by = 3*(y3 - 2*y2 + y1);
+	ax = x4 - x1 - cx - bx;
+	ay = y4 - y1 - cy - by;
+
+	h = 1.0f / n;
+
+#ifdef NVG_SSE2
+	{
+		// Two points per register, x,y of points i and i+1, stepped by 2h. The lanes of the
+		// second point start from the differences at t=h.
+		float H = 2*h, H2 = H*H, H3 = H2*H;
+		float fx1 = ((ax*h + bx)*h + cx)*h + x1, fy1 = ((ay*h + by)*h + cy)*h + y1;
+		float dx1 = ax*(3*h*h*H + 3*h*H2 + H3) + bx*(2*h*H + H2) + cx*H;
+		float dy1 = ay*(3*h*h*H + 3*h*H2 + H3) + by*(2*h*H + H2) + cy*H;
+		__m128 f = _mm_set_ps(fy1, fx1, y1, x1);
+		__m128 df = _mm_set_ps(dy1, dx1, ay*H3 + by*H2 + cy*H, ax*H3 + bx*H2 + cx*H);
+		__m128 ddf = _mm_set_ps(ay*(6*h*H2 + 6*H3) + 2*by*H2, ax*(6*h*H2 + 6*H3) + 2*bx*H2,
+								6*ay*H3 + 2*by*H2, 6*ax*H3 + 2*bx*H2);
+		__m128 dddf = _mm_set_ps(6*ay*H3, 6*ax*H3, 6*ay*H3, 6*ax*H3);
+
+		// Points 1..n-1, the first pair holds the start point and point 1.
+		for (i = 0; i < n; i += NVG_BEZIER_BATCH) {
+			int count = nvg__mini(n - i, NVG_BEZIER_BATCH);
+			for (j = 0; j < count; j += 2) {
+				_mm_storeu_ps(&pts[j*2], f);
+				f = _mm_add_ps(f, df);
+				df = _mm_add_ps(df, ddf);
+				ddf = _mm_add_ps(ddf, dddf);
+			}
+			if (i == 0)
+				nvg__addPoints(ctx, &pts[2], count-1);
+			else
+				nvg__addPoints(ctx, pts, count);
+		}
+	}
+#else
+	{
+		float h2 = h*h, h3 = h2*h;
+		float fx = x1, fy = y1;
+		float dfx = ax*h3 + bx*h2 + cx*h, dfy = ay*h3 + by*h2 + cy*h;
+		float ddfx = 6*ax*h3 + 2*bx*h2, ddfy = 6*ay*h3 + 2*by*h2;
+		float dddfx = 6*ax*h3, dddfy = 6*ay*h3;
+
+		for (i = 1; i < n; i += NVG_BEZIER_BATCH) {
+			int count = nvg__mini(n - i, NVG_BEZIER_BATCH);
+			for (j = 0; j < count; j++) {
+				fx += dfx;
+				fy += dfy;
+				dfx += ddfx;
+				dfy += ddfy;
+				ddfx += dddfx;
+				ddfy += dddfy;
+				pts[j*2] = fx;
+				pts[j*2+1] = fy;
+			}
+			nvg__addPoints(ctx, pts, count);
+		}
+	}
+#endif
+	nvg__addPoint(ctx, x4, y4, type);
+}
+#endif
 
 static void nvg__flattenPaths(NVGcontext* ctx)
 {
@@ -1337,41 +1834,37 @@ static void nvg__flattenPaths(NVGcontext* ctx)
 		return;
 
 	// Flatten
-	i = 0;
-	while (i < ctx->ncommands) {
-		int cmd = (int)ctx->commands[i];
-		switch (cmd) {
+	p = ctx->commandPoints;
+	for (i = 0; i < ctx->ncommands; i++) {
+		switch (ctx->commands[i]) {
 		case NVG_MOVETO:
 			nvg__addPath(ctx);
-			p = &ctx->commands[i+1];
 			nvg__addPoint(ctx, p[0], p[1], NVG_PT_CORNER);
-			i += 3;
+			p += 2;
 			break;
 		case NVG_LINETO:
-			p = &ctx->commands[i+1];
 			nvg__addPoint(ctx, p[0], p[1], NVG_PT_CORNER);
-			i += 3;
+			p += 2;
 			break;
 		case NVG_BEZIERTO:
 			last = nvg__lastPoint(ctx);
+			cp1 = &p[0];
+			cp2 = &p[2];
+			p += 6;
 			if (last != NULL) {
-				cp1 = &ctx->commands[i+1];
-				cp2 = &ctx->commands[i+3];
-				p = &ctx->commands[i+5];
-				nvg__tesselateBezier(ctx, last->x,last->y, cp1[0],cp1[1], cp2[0],cp2[1], p[0],p[1], 0, NVG_PT_CORNER);
+#ifdef NVG_RECURSIVE_BEZIER
+				nvg__tesselateBezier(ctx, last->x,last->y, cp1[0],cp1[1], cp2[0],cp2[1], p[-2],p[-1], 0, NVG_PT_CORNER);
+#else
+				nvg__flattenBezier(ctx, last->x,last->y, cp1[0],cp1[1], cp2[0],cp2[1], p[-2],p[-1], NVG_PT_CORNER);
+#endif
 			}
-			i += 7;
 			break;
 		case NVG_CLOSE:
 			nvg__closePath(ctx);
-			i++;
 			break;
 		case NVG_WINDING:
-			nvg__pathWinding(ctx, (int)ctx->commands[i+1]);
-			i += 2;
+			nvg__pathWinding(ctx, ctx->commands[++i]);
 			break;
-		default:
-			i++;
 		}
 	}
 
@@ -1841,22 +2334,163 @@ static int nvg__expandStroke(NVGcontext* ctx, float w, float fringe, int lineCap
 	return 1;
 }
 
+static NVGvertex* nvg__fillVerts(NVGpath* path, NVGpoint* pts, float woff, int fringe, NVGvertex* dst)
+{
+	NVGpoint* p0;
+	NVGpoint* p1;
+	int j;
+
+	if (fringe) {
+		// Looping
+		p0 = &pts[path->count-1];
+		p1 = &pts[0];
+		for (j = 0; j < path->count; ++j) {
+			if (p1->flags & NVG_PT_BEVEL) {
+				float dlx0 = p0->dy;
+				float dly0 = -p0->dx;
+				float dlx1 = p1->dy;
+				float dly1 = -p1->dx;
+				if (p1->flags & NVG_PT_LEFT) {
+					float lx = p1->x + p1->dmx * woff;
+					float ly = p1->y + p1->dmy * woff;
+					nvg__vset(dst, lx, ly, 0.5f,1); dst++;
+				} else {
+					float lx0 = p1->x + dlx0 * woff;
+					float ly0 = p1->y + dly0 * woff;
+					float lx1 = p1->x + dlx1 * woff;
+					float ly1 = p1->y + dly1 * woff;
+					nvg__vset(dst, lx0, ly0, 0.5f,1); dst++;
+					nvg__vset(dst, lx1, ly1, 0.5f,1); dst++;
+				}
+			} else {
+				nvg__vset(dst, p1->x + (p1->dmx * woff), p1->y + (p1->dmy * woff), 0.5f,1); dst++;
+			}
+			p0 = p1++;
+		}
+	} else {
+		for (j = 0; j < path->count; ++j) {
+			nvg__vset(dst, pts[j].x, pts[j].y, 0.5f,1);
+			dst++;
+		}
+	}
+
+	return dst;
+}
+
+static int nvg__segmentsCross(const NVGvertex* a0, const NVGvertex* a1, const NVGvertex* b0, const NVGvertex* b1)
+{
+	float d0 = nvg__triarea2(a0->x,a0->y, a1->x,a1->y, b0->x,b0->y);
+	float d1 = nvg__triarea2(a0->x,a0->y, a1->x,a1->y, b1->x,b1->y);
+	float d2 = nvg__triarea2(b0->x,b0->y, b1->x,b1->y, a0->x,a0->y);
+	float d3 = nvg__triarea2(b0->x,b0->y, b1->x,b1->y, a1->x,a1->y);
+	return d0*d1 < 0.0f && d2*d3 < 0.0f;
+}
+
+static int nvg__pointInTriangle(const NVGvertex* p, const NVGvertex* a, const NVGvertex* b, const NVGvertex* c)
+{
+	// Points on the edges count as inside, except for the corners themselves.
+	if ((p->x == a->x && p->y == a->y) || (p->x == b->x && p->y == b->y) || (p->x == c->x && p->y == c->y))
+		return 0;
+	return nvg__triarea2(a->x,a->y, b->x,b->y, p->x,p->y) >= 0.0f &&
+		nvg__triarea2(b->x,b->y, c->x,c->y, p->x,p->y) >= 0.0f &&
+		nvg__triarea2(c->x,c->y, a->x,a->y, p->x,p->y) >= 0.0f;
+}
+
+// Triangulates the fill outline of a single counter clockwise path by ear clipping.
+// Writes a triangle list to dst and returns the number of vertices, or 0 if the
+// outline is not a simple polygon and has to be filled using the stencil buffer.
+// A simple polygon has the same inside for any winding rule, so the rule needs no care here.
+static int nvg__triangulateFill(NVGpath* path, NVGpoint* pts, float woff, int fringe, NVGvertex* dst)
+{
+	NVGvertex poly[NVG_MAX_TRIANGULATE_VERTS];
+	unsigned short idx[NVG_MAX_TRIANGULATE_VERTS];
+	int i, j, n, m, nverts = 0, tries;
+
+	n = (int)(nvg__fillVerts(path, pts, woff, fringe, poly) - poly);
+	if (n < 3) return 0;
+
+	// Self intersecting outlines need the winding rules of the stencil fill.
+	for (i = 0; i < n; i++) {
+		for (j = i+2; j < n; j++) {
+			if (i == 0 && j == n-1) continue;
+			if (nvg__segmentsCross(&poly[i], &poly[i+1], &poly[j], &poly[(j+1) % n]))
+				return 0;
+		}
+	}
+
+	for (i = 0; i < n; i++)
+		idx[i] = (unsigned short)i;
+
+	m = n;
+	i = 0;
+	tries = 0;
+	while (m > 3) {
+		const NVGvertex* a = &poly[idx[(i+m-1) % m]];
+		const NVGvertex* b = &poly[idx[i]];
+		const NVGvertex* c = &poly[idx[(i+1) % m]];
+		float area = nvg__triarea2(a->x,a->y, b->x,b->y, c->x,c->y);
+		int ear = area > 0.0f;
+
+		for (j = 0; ear && j < m; j++) {
+			const NVGvertex* p = &poly[idx[j]];
+			if (p != a && p != b && p != c && nvg__pointInTriangle(p, a, b, c))
+				ear = 0;
+		}
+		// Degenerate corners are clipped once no proper ear is left.
+		if (!ear && tries >= m && area == 0.0f)
+			ear = 1;
+
+		if (ear) {
+			dst[nverts++] = *a;
+			dst[nverts++] = *b;
+			dst[nverts++] = *c;
+			m--;
+			for (j = i; j < m; j++)
+				idx[j] = idx[j+1];
+			if (i >= m) i = 0;
+			tries = 0;
+		} else {
+			if (++tries >= 2*m)
+				return 0;
+			i = (i+1) % m;
+		}
+	}
+
+	if (nvg__triarea2(poly[idx[0]].x,poly[idx[0]].y, poly[idx[1]].x,poly[idx[1]].y, poly[idx[2]].x,poly[idx[2]].y) < 0.0f)
+		return 0;
+	dst[nverts++] = poly[idx[0]];
+	dst[nverts++] = poly[idx[1]];
+	dst[nverts++] = poly[idx[2]];
+
+	return nverts;
+}
+
 static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLimit)
 {
 	NVGpathCache* cache = ctx->cache;
 	NVGvertex* verts;
 	NVGvertex* dst;
-	int cverts, convex, i, j;
+	int cverts, convex, triangulate, i, j;
 	float aa = ctx->fringeWidth;
 	int fringe = w > 0.0f;
 
 	nvg__calculateJoins(ctx, w, lineJoin, miterLimit);
 
+	convex = cache->npaths == 1 && cache->paths[0].convex;
+	// Single concave paths can be triangulated and drawn like convex ones, if the back-end supports it.
+	// The half fringe of convex shapes is only exact at mitered corners, at bevels it overlaps the
+	// fill where the stencil would mask it. Paths with a fringe and bevels are left to the stencil fill.
+	triangulate = ctx->params.triangulateFills && cache->npaths == 1 && !convex &&
+		cache->paths[0].winding == NVG_CCW && (!fringe || cache->paths[0].nbevel == 0) &&
+		cache->paths[0].count <= NVG_MAX_TRIANGULATE_VERTS;
+
 	// Calculate max vertex usage.
 	cverts = 0;
 	for (i = 0; i < cache->npaths; i++) {
 		NVGpath* path = &cache->paths[i];
 		cverts += path->count + path->nbevel + 1;
+		if (triangulate)
+			cverts += (path->count + path->nbevel) * 3;
 		if (fringe)
 			cverts += (path->count + path->nbevel*5 + 1) * 2; // plus one for loop
 	}
@@ -1864,8 +2498,6 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
 	verts = nvg__allocTempVerts(ctx, cverts);
 	if (verts == NULL) return 0;
 
-	convex = cache->npaths == 1 && cache->paths[0].convex;
-
 	for (i = 0; i < cache->npaths; i++) {
 		NVGpath* path = &cache->paths[i];
 		NVGpoint* pts = &cache->points[path->first];
@@ -1879,39 +2511,16 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
 		dst = verts;
 		path->fill = dst;
 
-		if (fringe) {
-			// Looping
-			p0 = &pts[path->count-1];
-			p1 = &pts[0];
-			for (j = 0; j < path->count; ++j) {
-				if (p1->flags & NVG_PT_BEVEL) {
-					float dlx0 = p0->dy;
-					float dly0 = -p0->dx;
-					float dlx1 = p1->dy;
-					float dly1 = -p1->dx;
-					if (p1->flags & NVG_PT_LEFT) {
-						float lx = p1->x + p1->dmx * woff;
-						float ly = p1->y + p1->dmy * woff;
-						nvg__vset(dst, lx, ly, 0.5f,1); dst++;
-					} else {
-						float lx0 = p1->x + dlx0 * woff;
-						float ly0 = p1->y + dly0 * woff;
-						float lx1 = p1->x + dlx1 * woff;
-						float ly1 = p1->y + dly1 * woff;
-						nvg__vset(dst, lx0, ly0, 0.5f,1); dst++;
-						nvg__vset(dst, lx1, ly1, 0.5f,1); dst++;
-					}
-				} else {
-					nvg__vset(dst, p1->x + (p1->dmx * woff), p1->y + (p1->dmy * woff), 0.5f,1); dst++;
-				}
-				p0 = p1++;
-			}
-		} else {
-			for (j = 0; j < path->count; ++j) {
-				nvg__vset(dst, pts[j].x, pts[j].y, 0.5f,1);
-				dst++;
-			}
+		if (triangulate) {
+			int n = nvg__triangulateFill(path, pts, woff, fringe, dst);
+			if (n > 0)
+				dst += n;
+			else
+				triangulate = 0;
 		}
+		if (!triangulate)
+			dst = nvg__fillVerts(path, pts, woff, fringe, dst);
+		path->triangulated = triangulate;
 
 		path->nfill = (int)(dst - verts);
 		verts = dst;
@@ -1925,9 +2534,9 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
 			dst = verts;
 			path->stroke = dst;
 
-			// Create only half a fringe for convex shapes so that
+			// Create only half a fringe for convex and triangulated shapes so that
 			// the shape can be rendered without stenciling.
-			if (convex) {
+			if (convex || triangulate) {
 				lw = woff;	// This should generate the same vertex as fill inset above.
 				lu = 0.5f;	// Set outline fade at middle.
 			}
@@ -1961,42 +2570,199 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
 	return 1;
 }
 
-
-// Draw
-void nvgBeginPath(NVGcontext* ctx)
+// Expands a single convex path into fill and half fringe, calculating the miter extrusions in the
+// same pass. The output is identical to nvg__calculateJoins() followed by nvg__expandFill().
+// Returns 0 if the path is not convex or if any of the joins needs a bevel.
+static int nvg__expandConvexFill(NVGcontext* ctx, NVGpath* path, NVGpoint* pts, float w, float miterLimit)
 {
-	ctx->ncommands = 0;
-	nvg__clearPathCache(ctx);
-}
+	NVGvertex* verts;
+	NVGvertex* dst;
+	NVGpoint* p0;
+	NVGpoint* p1;
+	float iw = 0.0f;
+	float woff = 0.5f*ctx->fringeWidth;
+	int fringe = w > 0.0f;
+	int j;
 
-void nvgMoveTo(NVGcontext* ctx, float x, float y)
-{
-	float vals[] = { NVG_MOVETO, x, y };
-	nvg__appendCommands(ctx, vals, NVG_COUNTOF(vals));
-}
+	if (w > 0.0f) iw = 1.0f / w;
 
-void nvgLineTo(NVGcontext* ctx, float x, float y)
-{
-	float vals[] = { NVG_LINETO, x, y };
-	nvg__appendCommands(ctx, vals, NVG_COUNTOF(vals));
-}
+	p0 = &pts[path->count-1];
+	p1 = &pts[0];
+	for (j = 0; j < path->count; j++) {
+		float dlx0, dly0, dlx1, dly1, dmr2, limit;
+		dlx0 = p0->dy;
+		dly0 = -p0->dx;
+		dlx1 = p1->dy;
+		dly1 = -p1->dx;
+		p1->dmx = (dlx0 + dlx1) * 0.5f;
+		p1->dmy = (dly0 + dly1) * 0.5f;
+		dmr2 = p1->dmx*p1->dmx + p1->dmy*p1->dmy;
+		if (dmr2 > 0.000001f) {
+			float scale = 1.0f / dmr2;
+			if (scale > 600.0f) {
+				scale = 600.0f;
+			}
+			p1->dmx *= scale;
+			p1->dmy *= scale;
+		}
 
-void nvgBezierTo(NVGcontext* ctx, float c1x, float c1y, float c2x, float c2y, float x, float y)
-{
-	float vals[] = { NVG_BEZIERTO, c1x, c1y, c2x, c2y, x, y };
-	nvg__appendCommands(ctx, vals, NVG_COUNTOF(vals));
-}
+		// Every turn must be a left turn.
+		if (p1->dx * p0->dy - p0->dx * p1->dy <= 0.0f)
+			return 0;
 
-void nvgQuadTo(NVGcontext* ctx, float cx, float cy, float x, float y)
-{
-    float x0 = ctx->commandx;
-    float y0 = ctx->commandy;
-    float vals[] = { NVG_BEZIERTO,
-        x0 + 2.0f/3.0f*(cx - x0), y0 + 2.0f/3.0f*(cy - y0),
-        x + 2.0f/3.0f*(cx - x), y + 2.0f/3.0f*(cy - y),
-        x, y };
-    nvg__appendCommands(ctx, vals, NVG_COUNTOF(vals));
-}
+		if (fringe) {
+			limit = nvg__maxf(1.01f, nvg__minf(p0->len, p1->len) * iw);
+			if ((dmr2 * limit*limit) < 1.0f)
+				return 0;
+			if ((p1->flags & NVG_PT_CORNER) && (dmr2 * miterLimit*miterLimit) < 1.0f)
+				return 0;
+		}
+
+		p0 = p1++;
+	}
+
+	verts = nvg__allocTempVerts(ctx, fringe ? path->count*3 + 2 : path->count);
+	if (verts == NULL) return 0;
+
+	dst = verts;
+	path->fill = dst;
+	for (j = 0; j < path->count; j++) {
+		if (fringe) {
+			nvg__vset(dst, pts[j].x + (pts[j].dmx * woff), pts[j].y + (pts[j].dmy * woff), 0.5f,1); dst++;
+		} else {
+			nvg__vset(dst, pts[j].x, pts[j].y, 0.5f,1); dst++;
+		}
+	}
+	path->nfill = (int)(dst - verts);
+	verts = dst;
+
+	if (fringe) {
+		float rw = w - woff;
+		path->stroke = dst;
+		for (j = 0; j < path->count; j++) {
+			nvg__vset(dst, pts[j].x + (pts[j].dmx * woff), pts[j].y + (pts[j].dmy * woff), 0.5f,1); dst++;
+			nvg__vset(dst, pts[j].x - (pts[j].dmx * rw), pts[j].y - (pts[j].dmy * rw), 1,1); dst++;
+		}
+		nvg__vset(dst, verts[0].x, verts[0].y, 0.5f,1); dst++;
+		nvg__vset(dst, verts[1].x, verts[1].y, 1,1); dst++;
+		path->nstroke = (int)(dst - verts);
+	} else {
+		path->stroke = NULL;
+		path->nstroke = 0;
+	}
+
+	path->nbevel = 0;
+	path->convex = 1;
+
+	return 1;
+}
+
+// Expands a polygon path directly from the command points, without going through the path cache.
+// The points are prepared the same way as nvg__flattenPaths() does.
+static int nvg__expandPolygonFill(NVGcontext* ctx, NVGpath* path, float* bounds, float w, float miterLimit)
+{
+	NVGpoint pts[NVG_MAX_FAST_FILL_POINTS];
+	NVGpoint* p0;
+	NVGpoint* p1;
+	float* p = ctx->commandPoints;
+	float area;
+	int i, count = 0, winding = NVG_CCW;
+
+	for (i = 0; i < ctx->ncommands; i++) {
+		switch (ctx->commands[i]) {
+		case NVG_MOVETO:
+		case NVG_LINETO:
+			if (count == 0 || !nvg__ptEquals(pts[count-1].x,pts[count-1].y, p[0],p[1], ctx->distTol)) {
+				if (count == NVG_MAX_FAST_FILL_POINTS) return 0;
+				memset(&pts[count], 0, sizeof(NVGpoint));
+				pts[count].x = p[0];
+				pts[count].y = p[1];
+				pts[count].flags = NVG_PT_CORNER;
+				count++;
+			}
+			p += 2;
+			break;
+		case NVG_WINDING:
+			winding = ctx->commands[++i];
+			break;
+		}
+	}
+
+	if (count > 0 && nvg__ptEquals(pts[count-1].x,pts[count-1].y, pts[0].x,pts[0].y, ctx->distTol))
+		count--;
+	if (count < 3)
+		return 0;
+
+	area = nvg__polyArea(pts, count);
+	if (winding == NVG_CCW && area < 0.0f)
+		nvg__polyReverse(pts, count);
+	if (winding == NVG_CW && area > 0.0f)
+		nvg__polyReverse(pts, count);
+
+	bounds[0] = bounds[1] = 1e6f;
+	bounds[2] = bounds[3] = -1e6f;
+	p0 = &pts[count-1];
+	p1 = &pts[0];
+	for (i = 0; i < count; i++) {
+		p0->dx = p1->x - p0->x;
+		p0->dy = p1->y - p0->y;
+		p0->len = nvg__normalize(&p0->dx, &p0->dy);
+		bounds[0] = nvg__minf(bounds[0], p0->x);
+		bounds[1] = nvg__minf(bounds[1], p0->y);
+		bounds[2] = nvg__maxf(bounds[2], p0->x);
+		bounds[3] = nvg__maxf(bounds[3], p0->y);
+		p0 = p1++;
+	}
+
+	memset(path, 0, sizeof(*path));
+	path->count = count;
+	path->closed = 1;
+	path->winding = winding;
+
+	return nvg__expandConvexFill(ctx, path, pts, w, miterLimit);
+}
+
+
+// Draw
+void nvgBeginPath(NVGcontext* ctx)
+{
+	ctx->ncommands = 0;
+	ctx->ncommandPoints = 0;
+	nvg__clearPathCache(ctx);
+}
+
+void nvgMoveTo(NVGcontext* ctx, float x, float y)
+{
+	unsigned char cmds[] = { NVG_MOVETO };
+	float pts[] = { x, y };
+	nvg__appendCommands(ctx, cmds, NVG_COUNTOF(cmds), pts, NVG_COUNTOF(pts)/2);
+}
+
+void nvgLineTo(NVGcontext* ctx, float x, float y)
+{
+	unsigned char cmds[] = { NVG_LINETO };
+	float pts[] = { x, y };
+	nvg__appendCommands(ctx, cmds, NVG_COUNTOF(cmds), pts, NVG_COUNTOF(pts)/2);
+}
+
+void nvgBezierTo(NVGcontext* ctx, float c1x, float c1y, float c2x, float c2y, float x, float y)
+{
+	unsigned char cmds[] = { NVG_BEZIERTO };
+	float pts[] = { c1x, c1y, c2x, c2y, x, y };
+	nvg__appendCommands(ctx, cmds, NVG_COUNTOF(cmds), pts, NVG_COUNTOF(pts)/2);
+}
+
+void nvgQuadTo(NVGcontext* ctx, float cx, float cy, float x, float y)
+{
+    float x0 = ctx->commandx;
+    float y0 = ctx->commandy;
+    unsigned char cmds[] = { NVG_BEZIERTO };
+    float pts[] = {
+        x0 + 2.0f/3.0f*(cx - x0), y0 + 2.0f/3.0f*(cy - y0),
+        x + 2.0f/3.0f*(cx - x), y + 2.0f/3.0f*(cy - y),
+        x, y };
+    nvg__appendCommands(ctx, cmds, NVG_COUNTOF(cmds), pts, NVG_COUNTOF(pts)/2);
+}
 
 void nvgArcTo(NVGcontext* ctx, float x1, float y1, float x2, float y2, float radius)
 {
@@ -2056,14 +2822,14 @@ void nvgArcTo(NVGcontext* ctx, float x1, float y1, float x2, float y2, float rad
 
 void nvgClosePath(NVGcontext* ctx)
 {
-	float vals[] = { NVG_CLOSE };
-	nvg__appendCommands(ctx, vals, NVG_COUNTOF(vals));
+	unsigned char cmds[] = { NVG_CLOSE };
+	nvg__appendCommands(ctx, cmds, NVG_COUNTOF(cmds), NULL, 0);
 }
 
 void nvgPathWinding(NVGcontext* ctx, int dir)
 {
-	float vals[] = { NVG_WINDING, (float)dir };
-	nvg__appendCommands(ctx, vals, NVG_COUNTOF(vals));
+	unsigned char cmds[] = { NVG_WINDING, (unsigned char)dir };
+	nvg__appendCommands(ctx, cmds, NVG_COUNTOF(cmds), NULL, 0);
 }
 
 void nvgArc(NVGcontext* ctx, float cx, float cy, float r, float a0, float a1, int dir)
@@ -2071,8 +2837,9 @@ void nvgArc(NVGcontext* ctx, float cx, float cy, float r, float a0, float a1, in
 	float a = 0, da = 0, hda = 0, kappa = 0;
 	float dx = 0, dy = 0, x = 0, y = 0, tanx = 0, tany = 0;
 	float px = 0, py = 0, ptanx = 0, ptany = 0;
-	float vals[3 + 5*7 + 100];
-	int i, ndivs, nvals;
+	unsigned char cmds[1 + 5];
+	float pts[(1 + 5*3) * 2];
+	int i, ndivs, ncmds, npts;
 	int move = ctx->ncommands > 0 ? NVG_LINETO : NVG_MOVETO;
 
 	// Clamp angles
@@ -2099,7 +2866,8 @@ void nvgArc(NVGcontext* ctx, float cx, float cy, float r, float a0, float a1, in
 	if (dir == NVG_CCW)
 		kappa = -kappa;
 
-	nvals = 0;
+	ncmds = 0;
+	npts = 0;
 	for (i = 0; i <= ndivs; i++) {
 		a = a0 + da * (i/(float)ndivs);
 		dx = nvg__cosf(a);
@@ -2110,17 +2878,19 @@ void nvgArc(NVGcontext* ctx, float cx, float cy, float r, float a0, float a1, in
 		tany = dx*r*kappa;
 
 		if (i == 0) {
-			vals[nvals++] = (float)move;
-			vals[nvals++] = x;
-			vals[nvals++] = y;
+			cmds[ncmds++] = (unsigned char)move;
+			pts[npts*2+0] = x;
+			pts[npts*2+1] = y;
+			npts++;
 		} else {
-			vals[nvals++] = NVG_BEZIERTO;
-			vals[nvals++] = px+ptanx;
-			vals[nvals++] = py+ptany;
-			vals[nvals++] = x-tanx;
-			vals[nvals++] = y-tany;
-			vals[nvals++] = x;
-			vals[nvals++] = y;
+			cmds[ncmds++] = NVG_BEZIERTO;
+			pts[npts*2+0] = px+ptanx;
+			pts[npts*2+1] = py+ptany;
+			pts[npts*2+2] = x-tanx;
+			pts[npts*2+3] = y-tany;
+			pts[npts*2+4] = x;
+			pts[npts*2+5] = y;
+			npts += 3;
 		}
 		px = x;
 		py = y;
@@ -2128,19 +2898,19 @@ void nvgArc(NVGcontext* ctx, float cx, float cy, float r, float a0, float a1, in
 		ptany = tany;
 	}
 
-	nvg__appendCommands(ctx, vals, nvals);
+	nvg__appendCommands(ctx, cmds, ncmds, pts, npts);
 }
 
 void nvgRect(NVGcontext* ctx, float x, float y, float w, float h)
 {
-	float vals[] = {
-		NVG_MOVETO, x,y,
-		NVG_LINETO, x,y+h,
-		NVG_LINETO, x+w,y+h,
-		NVG_LINETO, x+w,y,
-		NVG_CLOSE
+	unsigned char cmds[] = { NVG_MOVETO, NVG_LINETO, NVG_LINETO, NVG_LINETO, NVG_CLOSE };
+	float pts[] = {
+		x,y,
+		x,y+h,
+		x+w,y+h,
+		x+w,y
 	};
-	nvg__appendCommands(ctx, vals, NVG_COUNTOF(vals));
+	nvg__appendCommands(ctx, cmds, NVG_COUNTOF(cmds), pts, NVG_COUNTOF(pts)/2);
 }
 
 void nvgRoundedRect(NVGcontext* ctx, float x, float y, float w, float h, float r)
@@ -2160,33 +2930,42 @@ void nvgRoundedRectVarying(NVGcontext* ctx, float x, float y, float w, float h,
 		float rxBR = nvg__minf(radBottomRight, halfw) * nvg__signf(w), ryBR = nvg__minf(radBottomRight, halfh) * nvg__signf(h);
 		float rxTR = nvg__minf(radTopRight, halfw) * nvg__signf(w), ryTR = nvg__minf(radTopRight, halfh) * nvg__signf(h);
 		float rxTL = nvg__minf(radTopLeft, halfw) * nvg__signf(w), ryTL = nvg__minf(radTopLeft, halfh) * nvg__signf(h);
-		float vals[] = {
-			NVG_MOVETO, x, y + ryTL,
-			NVG_LINETO, x, y + h - ryBL,
-			NVG_BEZIERTO, x, y + h - ryBL*(1 - NVG_KAPPA90), x + rxBL*(1 - NVG_KAPPA90), y + h, x + rxBL, y + h,
-			NVG_LINETO, x + w - rxBR, y + h,
-			NVG_BEZIERTO, x + w - rxBR*(1 - NVG_KAPPA90), y + h, x + w, y + h - ryBR*(1 - NVG_KAPPA90), x + w, y + h - ryBR,
-			NVG_LINETO, x + w, y + ryTR,
-			NVG_BEZIERTO, x + w, y + ryTR*(1 - NVG_KAPPA90), x + w - rxTR*(1 - NVG_KAPPA90), y, x + w - rxTR, y,
-			NVG_LINETO, x + rxTL, y,
-			NVG_BEZIERTO, x + rxTL*(1 - NVG_KAPPA90), y, x, y + ryTL*(1 - NVG_KAPPA90), x, y + ryTL,
-			NVG_CLOSE
+		unsigned char cmds[] = {
+			NVG_MOVETO, NVG_LINETO, NVG_BEZIERTO, NVG_LINETO, NVG_BEZIERTO,
+			NVG_LINETO, NVG_BEZIERTO, NVG_LINETO, NVG_BEZIERTO, NVG_CLOSE
+		};
+		int empty = ctx->ncommands == 0;
+		float pts[] = {
+			x, y + ryTL,
+			x, y + h - ryBL,
+			x, y + h - ryBL*(1 - NVG_KAPPA90), x + rxBL*(1 - NVG_KAPPA90), y + h, x + rxBL, y + h,
+			x + w - rxBR, y + h,
+			x + w - rxBR*(1 - NVG_KAPPA90), y + h, x + w, y + h - ryBR*(1 - NVG_KAPPA90), x + w, y + h - ryBR,
+			x + w, y + ryTR,
+			x + w, y + ryTR*(1 - NVG_KAPPA90), x + w - rxTR*(1 - NVG_KAPPA90), y, x + w - rxTR, y,
+			x + rxTL, y,
+			x + rxTL*(1 - NVG_KAPPA90), y, x, y + ryTL*(1 - NVG_KAPPA90), x, y + ryTL
 		};
-		nvg__appendCommands(ctx, vals, NVG_COUNTOF(vals));
+		nvg__appendCommands(ctx, cmds, NVG_COUNTOF(cmds), pts, NVG_COUNTOF(pts)/2);
+		if (empty)
+			ctx->pathClass = NVG_CLASS_CONVEX;
 	}
 }
 
 void nvgEllipse(NVGcontext* ctx, float cx, float cy, float rx, float ry)
 {
-	float vals[] = {
-		NVG_MOVETO, cx-rx, cy,
-		NVG_BEZIERTO, cx-rx, cy+ry*NVG_KAPPA90, cx-rx*NVG_KAPPA90, cy+ry, cx, cy+ry,
-		NVG_BEZIERTO, cx+rx*NVG_KAPPA90, cy+ry, cx+rx, cy+ry*NVG_KAPPA90, cx+rx, cy,
-		NVG_BEZIERTO, cx+rx, cy-ry*NVG_KAPPA90, cx+rx*NVG_KAPPA90, cy-ry, cx, cy-ry,
-		NVG_BEZIERTO, cx-rx*NVG_KAPPA90, cy-ry, cx-rx, cy-ry*NVG_KAPPA90, cx-rx, cy,
-		NVG_CLOSE
+	unsigned char cmds[] = { NVG_MOVETO, NVG_BEZIERTO, NVG_BEZIERTO, NVG_BEZIERTO, NVG_BEZIERTO, NVG_CLOSE };
+	int empty = ctx->ncommands == 0;
+	float pts[] = {
+		cx-rx, cy,
+		cx-rx, cy+ry*NVG_KAPPA90, cx-rx*NVG_KAPPA90, cy+ry, cx, cy+ry,
+		cx+rx*NVG_KAPPA90, cy+ry, cx+rx, cy+ry*NVG_KAPPA90, cx+rx, cy,
+		cx+rx, cy-ry*NVG_KAPPA90, cx+rx*NVG_KAPPA90, cy-ry, cx, cy-ry,
+		cx-rx*NVG_KAPPA90, cy-ry, cx-rx, cy-ry*NVG_KAPPA90, cx-rx, cy
 	};
-	nvg__appendCommands(ctx, vals, NVG_COUNTOF(vals));
+	nvg__appendCommands(ctx, cmds, NVG_COUNTOF(cmds), pts, NVG_COUNTOF(pts)/2);
+	if (empty)
+		ctx->pathClass = NVG_CLASS_CONVEX;
 }
 
 void nvgCircle(NVGcontext* ctx, float cx, float cy, float r)
@@ -2216,30 +2995,101 @@ void nvgDebugDumpPathCache(NVGcontext* ctx)
 	}
 }
 
+// Returns 1 if the current path, grown by ext, is completely outside of the view or the scissor.
+// The bounds are taken from the transformed command points, bezier curves are contained
+// in the hull of their control points.
+static int nvg__cullPath(NVGcontext* ctx, NVGstate* state, float ext)
+{
+	const float* p = ctx->commandPoints;
+	float bounds[4];
+	int i;
+
+	if (ctx->ncommandPoints == 0)
+		return 0;
+
+	bounds[0] = bounds[2] = p[0];
+	bounds[1] = bounds[3] = p[1];
+	for (i = 1; i < ctx->ncommandPoints; i++) {
+		bounds[0] = nvg__minf(bounds[0], p[i*2+0]);
+		bounds[1] = nvg__minf(bounds[1], p[i*2+1]);
+		bounds[2] = nvg__maxf(bounds[2], p[i*2+0]);
+		bounds[3] = nvg__maxf(bounds[3], p[i*2+1]);
+	}
+	bounds[0] -= ext;
+	bounds[1] -= ext;
+	bounds[2] += ext;
+	bounds[3] += ext;
+
+	if (bounds[2] < 0.0f || bounds[3] < 0.0f || bounds[0] > ctx->viewWidth || bounds[1] > ctx->viewHeight)
+		return 1;
+
+	if (state->scissor.extent[0] >= 0.0f) {
+		const float* t = state->scissor.xform;
+		float ex = state->scissor.extent[0] * nvg__absf(t[0]) + state->scissor.extent[1] * nvg__absf(t[2]);
+		float ey = state->scissor.extent[0] * nvg__absf(t[1]) + state->scissor.extent[1] * nvg__absf(t[3]);
+		if (bounds[2] < t[4]-ex || bounds[3] < t[5]-ey || bounds[0] > t[4]+ex || bounds[1] > t[5]+ey)
+			return 1;
+	}
+
+	return 0;
+}
+
 void nvgFill(NVGcontext* ctx)
 {
 	NVGstate* state = nvg__getState(ctx);
 	const NVGpath* path;
 	NVGpaint fillPaint = state->fill;
-	int i;
+	NVGpath polygon;
+	float polygonBounds[4];
+	const NVGpath* paths = ctx->cache->paths;
+	const float* bounds = ctx->cache->bounds;
+	int i, npaths = 0;
+	float w = 0.0f;
 
-	nvg__flattenPaths(ctx);
 	if (ctx->params.edgeAntiAlias && state->shapeAntiAlias)
-		nvg__expandFill(ctx, ctx->fringeWidth, NVG_MITER, 2.4f);
-	else
-		nvg__expandFill(ctx, 0.0f, NVG_MITER, 2.4f);
+		w = ctx->fringeWidth;
+
+	if (nvg__cullPath(ctx, state, ctx->fringeWidth)) {
+		ctx->culledFillCount++;
+		return;
+	}
+
+	// Keep the order with text drawn before, also before vertices are reserved from the back-end.
+	nvg__flushTextBatch(ctx);
+
+	// Single convex shapes skip the generic joins and fringe expansion,
+	// polygons are expanded straight from the command points.
+	if (ctx->pathClass == NVG_CLASS_POLYGON && ctx->cache->npaths == 0) {
+		if (nvg__expandPolygonFill(ctx, &polygon, polygonBounds, w, 2.4f)) {
+			paths = &polygon;
+			bounds = polygonBounds;
+			npaths = 1;
+		}
+	} else if (ctx->pathClass == NVG_CLASS_CONVEX) {
+		nvg__flattenPaths(ctx);
+		if (ctx->cache->npaths == 1 && nvg__expandConvexFill(ctx, &ctx->cache->paths[0], &ctx->cache->points[ctx->cache->paths[0].first], w, 2.4f))
+			npaths = 1;
+	}
+
+	if (npaths == 0) {
+		nvg__flattenPaths(ctx);
+		nvg__expandFill(ctx, w, NVG_MITER, 2.4f);
+		paths = ctx->cache->paths;
+		bounds = ctx->cache->bounds;
+		npaths = ctx->cache->npaths;
+	}
 
 	// Apply global alpha
 	fillPaint.innerColor.a *= state->alpha;
 	fillPaint.outerColor.a *= state->alpha;
 
 	ctx->params.renderFill(ctx->params.userPtr, &fillPaint, state->compositeOperation, &state->scissor, ctx->fringeWidth,
-						   ctx->cache->bounds, ctx->cache->paths, ctx->cache->npaths);
+						   bounds, paths, npaths);
 
 	// Count triangles
-	for (i = 0; i < ctx->cache->npaths; i++) {
-		path = &ctx->cache->paths[i];
-		ctx->fillTriCount += path->nfill-2;
+	for (i = 0; i < npaths; i++) {
+		path = &paths[i];
+		ctx->fillTriCount += path->triangulated ? path->nfill/3 : path->nfill-2;
 		ctx->fillTriCount += path->nstroke-2;
 		ctx->drawCallCount += 2;
 	}
@@ -2264,6 +3114,14 @@ void nvgStroke(NVGcontext* ctx)
 		strokeWidth = ctx->fringeWidth;
 	}
 
+	// Miter joins extend up to miterLimit half widths, square caps sqrt(2) half widths.
+	if (nvg__cullPath(ctx, state, strokeWidth*0.5f * nvg__maxf(state->miterLimit, 1.5f) + ctx->fringeWidth)) {
+		ctx->culledStrokeCount++;
+		return;
+	}
+
+	nvg__flushTextBatch(ctx);
+
 	// Apply global alpha
 	strokePaint.innerColor.a *= state->alpha;
 	strokePaint.outerColor.a *= state->alpha;
@@ -2328,6 +3186,8 @@ int nvgAddFallbackFont(NVGcontext* ctx, const char* baseFont, const char* fallba
 void nvgResetFallbackFontsId(NVGcontext* ctx, int baseFont)
 {
 	fonsResetFallbackFont(ctx->fs, baseFont);
+	// Cached runs may hold glyphs resolved through the old fallbacks.
+	nvg__clearTextCache(ctx->textCache);
 }
 
 void nvgResetFallbackFonts(NVGcontext* ctx, const char* baseFont)
@@ -2348,6 +3208,18 @@ void nvgFontBlur(NVGcontext* ctx, float blur)
 	state->fontBlur = blur;
 }
 
+void nvgTextSDF(NVGcontext* ctx, int enabled)
+{
+	NVGstate* state = nvg__getState(ctx);
+	state->textSDF = enabled;
+}
+
+void nvgTextSubpixel(NVGcontext* ctx, int enabled)
+{
+	NVGstate* state = nvg__getState(ctx);
+	state->textSubpixel = enabled;
+}
+
 void nvgTextLetterSpacing(NVGcontext* ctx, float spacing)
 {
 	NVGstate* state = nvg__getState(ctx);
@@ -2388,23 +3260,43 @@ static float nvg__getFontScale(NVGstate* state)
 	return nvg__minf(nvg__quantize(nvg__getAverageScale(state->xform), 0.01f), 4.0f);
 }
 
-static void nvg__flushTextTexture(NVGcontext* ctx)
+// Distance field glyphs need back-end support and are not blurred.
+static int nvg__textSDF(NVGcontext* ctx, NVGstate* state)
 {
-	int dirty[4];
+#ifdef FONS_USE_FREETYPE
+	NVG_NOTUSED(ctx);
+	NVG_NOTUSED(state);
+	return 0;
+#else
+	return state->textSDF && state->fontBlur == 0.0f && ctx->params.renderTrianglesSDF != NULL;
+#endif
+}
 
-	if (fonsValidateTexture(ctx->fs, dirty)) {
-		int fontImage = ctx->fontImages[ctx->fontImageIdx];
-		// Update texture
-		if (fontImage != 0) {
-			int iw, ih;
-			const unsigned char* data = fonsGetTextureData(ctx->fs, &iw, &ih);
-			int x = dirty[0];
-			int y = dirty[1];
-			int w = dirty[2] - dirty[0];
-			int h = dirty[3] - dirty[1];
-			ctx->params.renderUpdateTexture(ctx->params.userPtr, fontImage, x,y, w,h, data);
-		}
-	}
+// Subpixel glyph variants are rasterized by stb_truetype only, distance field glyphs do not need them.
+static int nvg__textSubpixel(NVGcontext* ctx, NVGstate* state)
+{
+#ifdef FONS_USE_FREETYPE
+	NVG_NOTUSED(ctx);
+	NVG_NOTUSED(state);
+	return 0;
+#else
+	return state->textSubpixel && state->fontBlur == 0.0f && !nvg__textSDF(ctx, state);
+#endif
+}
+
+// Measuring passes the text style to fontstash directly instead of through its state stack,
+// so that it does not modify the context and can run on several threads.
+static void nvg__fontState(NVGcontext* ctx, float scale, int align, FONSstate* fstate)
+{
+	NVGstate* state = nvg__getState(ctx);
+	fstate->font = state->fontId;
+	fstate->align = align;
+	fstate->size = state->fontSize*scale;
+	fstate->color = 0xffffffff;
+	fstate->blur = state->fontBlur*scale;
+	fstate->spacing = state->letterSpacing*scale;
+	fstate->sdf = nvg__textSDF(ctx, state);
+	fstate->subpixel = nvg__textSubpixel(ctx, state);
 }
 
 static int nvg__allocTextAtlas(NVGcontext* ctx)
@@ -2427,71 +3319,379 @@ static int nvg__allocTextAtlas(NVGcontext* ctx)
 		ctx->fontImages[ctx->fontImageIdx+1] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, iw, ih, 0, NULL);
 	}
 	++ctx->fontImageIdx;
-	fonsResetAtlas(ctx->fs, iw, ih);
+	// Glyphs used so far move to the new texture, the old one stays in use for text drawn before.
+	fonsCompactAtlas(ctx->fs, iw, ih);
+	// Cached runs point to glyphs in the old atlas.
+	nvg__clearTextCache(ctx->textCache);
 	return 1;
 }
 
-static void nvg__renderText(NVGcontext* ctx, NVGvertex* verts, int nverts)
+// Returns space for nverts vertices at the end of the text batch. The batch is flushed first if it
+// was drawn with an other atlas, paint, scissor or composite operation than the current state.
+// When the back-end can reserve vertices, the batch is built right in its vertex storage and the
+// triangles call skips the copy. Anything else drawn flushes the batch before it reaches the
+// back-end, so nothing is recorded behind the reservation while the batch grows.
+static NVGvertex* nvg__allocTextVerts(NVGcontext* ctx, int nverts, int sdf)
 {
 	NVGstate* state = nvg__getState(ctx);
+	NVGtextBatch* b = &ctx->textBatch;
 	NVGpaint paint = state->fill;
+	float sdfScale = 0.0f;
 
-	// Render triangles.
 	paint.image = ctx->fontImages[ctx->fontImageIdx];
 
 	// Apply global alpha
 	paint.innerColor.a *= state->alpha;
 	paint.outerColor.a *= state->alpha;
 
-	ctx->params.renderTriangles(ctx->params.userPtr, &paint, state->compositeOperation, &state->scissor, verts, nverts, ctx->fringeWidth);
+	if (sdf) {
+		// Screen pixels per pixel of the distance field glyphs, times field pixels per texel value.
+		float px = state->fontSize * nvg__getAverageScale(state->xform) * ctx->devicePxRatio / FONS_SDF_SIZE;
+		sdfScale = px * 255.0f * FONS_SDF_PAD / FONS_SDF_EDGE;
+	}
 
-	ctx->drawCallCount++;
+	if (b->nverts > 0 && (b->sdf != sdf || b->sdfScale != sdfScale ||
+		memcmp(&b->paint, &paint, sizeof(NVGpaint)) != 0 ||
+		memcmp(&b->compositeOperation, &state->compositeOperation, sizeof(NVGcompositeOperationState)) != 0 ||
+		memcmp(&b->scissor, &state->scissor, sizeof(NVGscissor)) != 0))
+		nvg__flushTextBatch(ctx);
+	if (b->nverts == 0) {
+		b->paint = paint;
+		b->compositeOperation = state->compositeOperation;
+		b->scissor = state->scissor;
+		b->sdf = sdf;
+		b->sdfScale = sdfScale;
+	}
+
+	if (ctx->params.renderReserveVerts != NULL && (b->nverts == 0 || b->reserved != NULL)) {
+		NVGvertex* verts = ctx->params.renderReserveVerts(ctx->params.userPtr, b->nverts + nverts);
+		if (verts != NULL) {
+			b->reserved = verts;
+			return &verts[b->nverts];
+		}
+	}
+
+	if (b->nverts + nverts > b->cverts) {
+		NVGvertex* verts;
+		int cverts = (b->nverts + nverts + 0xff) & ~0xff;
+		cverts = nvg__maxi(cverts, b->cverts * 2);
+		verts = (NVGvertex*)nvg__arenaRealloc(&ctx->arena, b->verts, sizeof(NVGvertex)*b->cverts, sizeof(NVGvertex)*cverts);
+		if (verts == NULL) return NULL;
+		b->verts = verts;
+		b->cverts = cverts;
+	}
+	if (b->reserved != NULL) {
+		// Out of back-end storage, the batch continues in the frame arena.
+		memcpy(b->verts, b->reserved, sizeof(NVGvertex)*b->nverts);
+		b->reserved = NULL;
+	}
+
+	return &b->verts[b->nverts];
+}
+
+// Adds the vertices written to the space from nvg__allocTextVerts() to the batch.
+static void nvg__renderText(NVGcontext* ctx, int nverts)
+{
+	ctx->textBatch.nverts += nverts;
 	ctx->textTriCount += nverts/3;
 }
 
+static unsigned int nvg__hashTextRun(const char* string, int n, int font, int align, float size, float spacing, float blur, int sdf, int subpixel)
+{
+	// FNV-1a over the string followed by the style.
+	unsigned int h = 2166136261u;
+	float style[3];
+	int i;
+	for (i = 0; i < n; i++)
+		h = (h ^ (unsigned char)string[i]) * 16777619u;
+	style[0] = size; style[1] = spacing; style[2] = blur;
+	for (i = 0; i < (int)sizeof(style); i++)
+		h = (h ^ ((const unsigned char*)style)[i]) * 16777619u;
+	h = (h ^ (unsigned int)font) * 16777619u;
+	h = (h ^ (unsigned int)align) * 16777619u;
+	h = (h ^ (unsigned int)sdf) * 16777619u;
+	h = (h ^ (unsigned int)subpixel) * 16777619u;
+	return h;
+}
+
+static void nvg__unlinkTextRun(NVGtextCache* c, int i)
+{
+	NVGtextRun* run = &c->runs[i];
+	if (run->prev != -1) c->runs[run->prev].succ = run->succ;
+	else c->head = run->succ;
+	if (run->succ != -1) c->runs[run->succ].prev = run->prev;
+	else c->tail = run->prev;
+}
+
+static void nvg__pushTextRun(NVGtextCache* c, int i)
+{
+	NVGtextRun* run = &c->runs[i];
+	run->prev = -1;
+	run->succ = c->head;
+	if (c->head != -1) c->runs[c->head].prev = i;
+	else c->tail = i;
+	c->head = i;
+}
+
+static NVGtextRun* nvg__findTextRun(NVGtextCache* c, unsigned int hash, const char* string, int n,
+									int font, int align, float size, float spacing, float blur, int sdf, int subpixel)
+{
+	int i = c->lut[hash & (NVG_TEXT_CACHE_LUT-1)];
+	while (i != -1) {
+		NVGtextRun* run = &c->runs[i];
+		if (run->hash == hash && run->ntext == n && run->font == font && run->align == align &&
+			run->size == size && run->spacing == spacing && run->blur == blur && run->sdf == sdf &&
+			run->subpixel == subpixel && memcmp(run->text, string, n) == 0) {
+			if (c->head != i) {
+				nvg__unlinkTextRun(c, i);
+				nvg__pushTextRun(c, i);
+			}
+			return run;
+		}
+		i = run->next;
+	}
+	return NULL;
+}
+
+// Stores the quads just shaped in c->quads, replacing the least recently used run if the cache is full.
+static void nvg__addTextRun(NVGtextCache* c, unsigned int hash, const char* string, int n,
+							int font, int align, float size, float spacing, float blur, int sdf, int subpixel,
+							int nquads, float width, float valign)
+{
+	NVGtextRun* run;
+	int i, *prev;
+
+	i = c->nruns < NVG_TEXT_CACHE_RUNS ? c->nruns : c->tail;
+	run = &c->runs[i];
+
+	// Grow the buffers first, the old run stays valid if that fails.
+	if (n > run->ctext) {
+		char* text = (char*)realloc(run->text, n);
+		if (text == NULL) return;
+		run->text = text;
+		run->ctext = n;
+	}
+	if (nquads > run->cquads) {
+		NVGtextQuad* quads = (NVGtextQuad*)realloc(run->quads, sizeof(NVGtextQuad) * nquads);
+		if (quads == NULL) return;
+		run->quads = quads;
+		run->cquads = nquads;
+	}
+
+	if (i == c->nruns) {
+		c->nruns++;
+	} else {
+		nvg__unlinkTextRun(c, i);
+		prev = &c->lut[run->hash & (NVG_TEXT_CACHE_LUT-1)];
+		while (*prev != i)
+			prev = &c->runs[*prev].next;
+		*prev = run->next;
+	}
+
+	memcpy(run->text, string, n);
+	memcpy(run->quads, c->quads, sizeof(NVGtextQuad) * nquads);
+	run->hash = hash;
+	run->ntext = n;
+	run->nquads = nquads;
+	run->font = font;
+	run->align = align;
+	run->size = size;
+	run->spacing = spacing;
+	run->blur = blur;
+	run->sdf = sdf;
+	run->subpixel = subpixel;
+	run->width = width;
+	run->valign = valign;
+
+	run->next = c->lut[hash & (NVG_TEXT_CACHE_LUT-1)];
+	c->lut[hash & (NVG_TEXT_CACHE_LUT-1)] = i;
+	nvg__pushTextRun(c, i);
+}
+
+// Marks the glyphs of a cached run as drawn, returns 0 if any of them is no longer in the atlas.
+static int nvg__touchTextRun(NVGcontext* ctx, NVGtextRun* run)
+{
+	int i;
+	for (i = 0; i < run->nquads; i++) {
+		if (!fonsTouchGlyph(ctx->fs, run->quads[i].entry, run->quads[i].serial))
+			return 0;
+	}
+	return 1;
+}
+
+// Moves a run whose glyphs have been evicted to the end of the LRU list, where it is replaced first.
+static void nvg__dropTextRun(NVGtextCache* c, int i)
+{
+	NVGtextRun* run = &c->runs[i];
+	run->ntext = -1; // Never matches.
+	if (c->tail == i) return;
+	nvg__unlinkTextRun(c, i);
+	run->prev = c->tail;
+	run->succ = -1;
+	c->runs[c->tail].succ = i;
+	c->tail = i;
+}
+
+// Emits a cached run at the specified location, the same way nvgText() lays out the quads.
+static float nvg__renderTextRun(NVGcontext* ctx, NVGtextRun* run, float x, float y, float scale)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGvertex* verts;
+	float invscale = 1.0f / scale;
+	float ox = x*scale, oy = y*scale, px = ox, bx, by;
+	int i, nverts = 0;
+
+	// The run was laid out from an origin with the same subpixel phase.
+	if (run->subpixel)
+		ox = px = floorf(ox * FONS_SUBPIXEL_STEPS + 0.5f) / FONS_SUBPIXEL_STEPS;
+
+	if (run->align & NVG_ALIGN_LEFT) {
+		// empty
+	} else if (run->align & NVG_ALIGN_RIGHT) {
+		ox -= run->width;
+	} else if (run->align & NVG_ALIGN_CENTER) {
+		ox -= run->width * 0.5f;
+	}
+	oy += run->valign;
+	bx = run->sdf ? ox : floorf(run->subpixel ? px : ox);
+	by = run->sdf ? oy : floorf(oy);
+
+	verts = nvg__allocTextVerts(ctx, run->nquads * 6, run->sdf);
+	if (verts == NULL) return x;
+
+	for (i = 0; i < run->nquads; i++) {
+		NVGtextQuad* q = &run->quads[i];
+		float c[4*2];
+		// Transform corners.
+		nvgTransformPoint(&c[0],&c[1], state->xform, (bx+q->x0)*invscale, (by+q->y0)*invscale);
+		nvgTransformPoint(&c[2],&c[3], state->xform, (bx+q->x1)*invscale, (by+q->y0)*invscale);
+		nvgTransformPoint(&c[4],&c[5], state->xform, (bx+q->x1)*invscale, (by+q->y1)*invscale);
+		nvgTransformPoint(&c[6],&c[7], state->xform, (bx+q->x0)*invscale, (by+q->y1)*invscale);
+		// Create triangles
+		nvg__vset(&verts[nverts], c[0], c[1], q->s0, q->t0); nverts++;
+		nvg__vset(&verts[nverts], c[4], c[5], q->s1, q->t1); nverts++;
+		nvg__vset(&verts[nverts], c[2], c[3], q->s1, q->t0); nverts++;
+		nvg__vset(&verts[nverts], c[0], c[1], q->s0, q->t0); nverts++;
+		nvg__vset(&verts[nverts], c[6], c[7], q->s0, q->t1); nverts++;
+		nvg__vset(&verts[nverts], c[4], c[5], q->s1, q->t1); nverts++;
+	}
+
+	nvg__renderText(ctx, nverts);
+
+	return (ox + run->width) / scale;
+}
+
 float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char* end)
 {
 	NVGstate* state = nvg__getState(ctx);
+	NVGtextCache* tc = ctx->textCache;
 	FONStextIter iter, prevIter;
 	FONSquad q;
 	NVGvertex* verts;
+	NVGtextRun* run;
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
+	float size, spacing, blur, bx, by, ox, oy, px;
+	unsigned int hash = 0;
 	int cverts = 0;
 	int nverts = 0;
+	int nquads = 0;
+	int cacheable = 0;
+	int sdf, subpixel = 0;
 
 	if (end == NULL)
 		end = string + strlen(string);
 
 	if (state->fontId == FONS_INVALID) return x;
 
-	fonsSetSize(ctx->fs, state->fontSize*scale);
-	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
-	fonsSetBlur(ctx->fs, state->fontBlur*scale);
+	size = state->fontSize*scale;
+	spacing = state->letterSpacing*scale;
+	blur = state->fontBlur*scale;
+	sdf = nvg__textSDF(ctx, state);
+	px = x*scale;
+	if (nvg__textSubpixel(ctx, state)) {
+		// Snap the origin to the subpixel grid, so runs drawn at the same phase share their layout.
+		float q = floorf(px * FONS_SUBPIXEL_STEPS + 0.5f);
+		px = q / FONS_SUBPIXEL_STEPS;
+		subpixel = 1 + ((int)q & (FONS_SUBPIXEL_STEPS-1));
+	}
+
+	if (string < end && end - string <= NVG_TEXT_CACHE_MAX_CHARS) {
+		hash = nvg__hashTextRun(string, (int)(end - string), state->fontId, state->textAlign, size, spacing, blur, sdf, subpixel);
+		run = nvg__findTextRun(tc, hash, string, (int)(end - string), state->fontId, state->textAlign, size, spacing, blur, sdf, subpixel);
+		if (run != NULL) {
+			if (nvg__touchTextRun(ctx, run)) {
+				tc->hits++;
+				return nvg__renderTextRun(ctx, run, x, y, scale);
+			}
+			nvg__dropTextRun(tc, (int)(run - tc->runs));
+		}
+		tc->misses++;
+		cacheable = 1;
+	}
+
+	fonsSetSize(ctx->fs, size);
+	fonsSetSpacing(ctx->fs, spacing);
+	fonsSetBlur(ctx->fs, blur);
 	fonsSetAlign(ctx->fs, state->textAlign);
 	fonsSetFont(ctx->fs, state->fontId);
+	fonsSetSDF(ctx->fs, sdf);
+	fonsSetSubpixel(ctx->fs, subpixel != 0);
 
 	cverts = nvg__maxi(2, (int)(end - string)) * 6; // conservative estimate.
-	verts = nvg__allocTempVerts(ctx, cverts);
+	verts = nvg__allocTextVerts(ctx, cverts, sdf);
 	if (verts == NULL) return x;
 
-	fonsTextIterInit(ctx->fs, &iter, x*scale, y*scale, string, end, FONS_GLYPH_BITMAP_REQUIRED);
+	if (cacheable && cverts/6 > tc->cquads) {
+		NVGtextQuad* quads = (NVGtextQuad*)realloc(tc->quads, sizeof(NVGtextQuad) * (cverts/6));
+		if (quads != NULL) {
+			tc->quads = quads;
+			tc->cquads = cverts/6;
+		} else {
+			cacheable = 0;
+		}
+	}
+
+	if (subpixel) {
+		// Lay out from the pixel of the origin, so that the glyphs land on the same offsets at any position.
+		bx = floorf(px);
+		fonsTextIterInit(ctx->fs, &iter, px - bx, y*scale, string, end, FONS_GLYPH_BITMAP_REQUIRED);
+	} else {
+		fonsTextIterInit(ctx->fs, &iter, px, y*scale, string, end, FONS_GLYPH_BITMAP_REQUIRED);
+		bx = sdf ? iter.x : floorf(iter.x);
+	}
+	ox = iter.x;
+	oy = iter.y;
+	by = sdf ? oy : floorf(oy);
 	prevIter = iter;
 	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
 		float c[4*2];
 		if (iter.prevGlyphIndex == -1) { // can not retrieve glyph?
-			if (nverts != 0) {
-				nvg__renderText(ctx, verts, nverts);
-				nverts = 0;
-			}
+			// The run spans several atlases, do not cache it.
+			cacheable = 0;
+			nvg__renderText(ctx, nverts);
+			nverts = 0;
 			if (!nvg__allocTextAtlas(ctx))
 				break; // no memory :(
+			// The rest is drawn with the new atlas.
+			verts = nvg__allocTextVerts(ctx, cverts, sdf);
+			if (verts == NULL)
+				break;
 			iter = prevIter;
 			fonsTextIterNext(ctx->fs, &iter, &q); // try again
 			if (iter.prevGlyphIndex == -1) // still can not find glyph?
 				break;
 		}
 		prevIter = iter;
+		if (iter.pending) {
+			// Drawn once rasterized, do not cache the run without it.
+			cacheable = 0;
+			continue;
+		}
+		if (subpixel) {
+			q.x0 += bx;
+			q.x1 += bx;
+		}
 		// Transform corners.
 		nvgTransformPoint(&c[0],&c[1], state->xform, q.x0*invscale, q.y0*invscale);
 		nvgTransformPoint(&c[2],&c[3], state->xform, q.x1*invscale, q.y0*invscale);
@@ -2506,47 +3706,58 @@ float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char*
 			nvg__vset(&verts[nverts], c[6], c[7], q.s0, q.t1); nverts++;
 			nvg__vset(&verts[nverts], c[4], c[5], q.s1, q.t1); nverts++;
 		}
+		if (cacheable) {
+			NVGtextQuad* tq = &tc->quads[nquads++];
+			tq->x0 = q.x0 - bx; tq->y0 = q.y0 - by; tq->s0 = q.s0; tq->t0 = q.t0;
+			tq->x1 = q.x1 - bx; tq->y1 = q.y1 - by; tq->s1 = q.s1; tq->t1 = q.t1;
+			tq->entry = iter.entry; tq->serial = iter.serial;
+		}
 	}
 
-	// TODO: add back-end bit to do this just once per frame.
-	nvg__flushTextTexture(ctx);
+	if (cacheable) {
+		// Bitmap pen advances are whole pixels, round away the error of the origin.
+		nvg__addTextRun(tc, hash, string, (int)(end - string), state->fontId, state->textAlign, size, spacing, blur, sdf, subpixel,
+						nquads, sdf || subpixel ? iter.nextx - ox : floorf(iter.nextx - ox + 0.5f), oy - y*scale);
+	}
 
-	nvg__renderText(ctx, verts, nverts);
+	nvg__renderText(ctx, nverts);
 
-	return iter.nextx / scale;
+	return (subpixel ? bx + iter.nextx : iter.nextx) / scale;
 }
 
-void nvgTextBox(NVGcontext* ctx, float x, float y, float breakRowWidth, const char* string, const char* end)
+void nvgTextCacheStats(NVGcontext* ctx, int* hits, int* misses)
 {
-	NVGstate* state = nvg__getState(ctx);
-	NVGtextRow rows[2];
-	int nrows = 0, i;
-	int oldAlign = state->textAlign;
-	int haling = state->textAlign & (NVG_ALIGN_LEFT | NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT);
-	int valign = state->textAlign & (NVG_ALIGN_TOP | NVG_ALIGN_MIDDLE | NVG_ALIGN_BOTTOM | NVG_ALIGN_BASELINE);
-	float lineh = 0;
+	if (hits != NULL) *hits = ctx->textCache->hits;
+	if (misses != NULL) *misses = ctx->textCache->misses;
+}
 
-	if (state->fontId == FONS_INVALID) return;
+void nvgTextAsyncGlyphs(NVGcontext* ctx, int enabled)
+{
+	fonsSetAsyncGlyphs(ctx->fs, enabled);
+}
 
-	nvgTextMetrics(ctx, NULL, NULL, &lineh);
+int nvgRasterizeGlyphs(NVGcontext* ctx, int maxGlyphs)
+{
+	return fonsRasterizeGlyphs(ctx->fs, maxGlyphs);
+}
 
-	state->textAlign = NVG_ALIGN_LEFT | valign;
+int nvgPrewarmGlyphs(NVGcontext* ctx, unsigned int first, unsigned int last)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	int ret;
 
-	while ((nrows = nvgTextBreakLines(ctx, string, end, breakRowWidth, rows, 2))) {
-		for (i = 0; i < nrows; i++) {
-			NVGtextRow* row = &rows[i];
-			if (haling & NVG_ALIGN_LEFT)
-				nvgText(ctx, x, y, row->start, row->end);
-			else if (haling & NVG_ALIGN_CENTER)
-				nvgText(ctx, x + breakRowWidth*0.5f - row->width*0.5f, y, row->start, row->end);
-			else if (haling & NVG_ALIGN_RIGHT)
-				nvgText(ctx, x + breakRowWidth - row->width, y, row->start, row->end);
-			y += lineh * state->lineHeight;
-		}
-		string = rows[nrows-1].next;
-	}
+	if (state->fontId == FONS_INVALID) return 0;
 
-	state->textAlign = oldAlign;
+	fonsSetSize(ctx->fs, state->fontSize*scale);
+	fonsSetBlur(ctx->fs, state->fontBlur*scale);
+	fonsSetFont(ctx->fs, state->fontId);
+	fonsSetSDF(ctx->fs, nvg__textSDF(ctx, state));
+	fonsSetSubpixel(ctx->fs, nvg__textSubpixel(ctx, state));
+
+	ret = fonsPrewarmGlyphs(ctx->fs, first, last);
+
+	return ret;
 }
 
 int nvgTextGlyphPositions(NVGcontext* ctx, float x, float y, const char* string, const char* end, NVGglyphPosition* positions, int maxPositions)
@@ -2554,7 +3765,8 @@ int nvgTextGlyphPositions(NVGcontext* ctx, float x, float y, const char* string,
 	NVGstate* state = nvg__getState(ctx);
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
-	FONStextIter iter, prevIter;
+	FONSstate fstate;
+	FONStextIter iter;
 	FONSquad q;
 	int npos = 0;
 
@@ -2566,20 +3778,11 @@ int nvgTextGlyphPositions(NVGcontext* ctx, float x, float y, const char* string,
 	if (string == end)
 		return 0;
 
-	fonsSetSize(ctx->fs, state->fontSize*scale);
-	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
-	fonsSetBlur(ctx->fs, state->fontBlur*scale);
-	fonsSetAlign(ctx->fs, state->textAlign);
-	fonsSetFont(ctx->fs, state->fontId);
+	nvg__fontState(ctx, scale, state->textAlign, &fstate);
 
-	fonsTextIterInit(ctx->fs, &iter, x*scale, y*scale, string, end, FONS_GLYPH_BITMAP_OPTIONAL);
-	prevIter = iter;
+	// Metrics only, the glyphs need no space in the atlas.
+	fonsTextIterInitState(ctx->fs, &fstate, &iter, x*scale, y*scale, string, end, FONS_GLYPH_BITMAP_OPTIONAL);
 	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
-		if (iter.prevGlyphIndex < 0 && nvg__allocTextAtlas(ctx)) { // can not retrieve glyph?
-			iter = prevIter;
-			fonsTextIterNext(ctx->fs, &iter, &q); // try again
-		}
-		prevIter = iter;
 		positions[npos].str = iter.str;
 		positions[npos].x = iter.x * invscale;
 		positions[npos].minx = nvg__minf(iter.x, q.x0) * invscale;
@@ -2599,12 +3802,15 @@ enum NVGcodepointType {
 	NVG_CJK_CHAR,
 };
 
-int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows)
+// The previous codepoint continues a \r\n or \n\r pair when breaking resumes after a new line.
+static int nvg__textBreakLines(NVGcontext* ctx, int align, const char* string, const char* end, float breakRowWidth,
+							   NVGtextRow* rows, int maxRows, unsigned int pcodepoint)
 {
 	NVGstate* state = nvg__getState(ctx);
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
-	FONStextIter iter, prevIter;
+	FONSstate fstate;
+	FONStextIter iter;
 	FONSquad q;
 	int nrows = 0;
 	float rowStartX = 0;
@@ -2614,13 +3820,11 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 	const char* rowStart = NULL;
 	const char* rowEnd = NULL;
 	const char* wordStart = NULL;
-	float wordStartX = 0;
-	float wordMinX = 0;
 	const char* breakEnd = NULL;
 	float breakWidth = 0;
 	float breakMaxX = 0;
+	const char* resume = NULL;
 	int type = NVG_SPACE, ptype = NVG_SPACE;
-	unsigned int pcodepoint = 0;
 
 	if (maxRows == 0) return 0;
 	if (state->fontId == FONS_INVALID) return 0;
@@ -2630,22 +3834,14 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 
 	if (string == end) return 0;
 
-	fonsSetSize(ctx->fs, state->fontSize*scale);
-	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
-	fonsSetBlur(ctx->fs, state->fontBlur*scale);
-	fonsSetAlign(ctx->fs, state->textAlign);
-	fonsSetFont(ctx->fs, state->fontId);
+	// Rows are measured from their start, horizontal alignment does not change them.
+	nvg__fontState(ctx, scale, NVG_ALIGN_LEFT | (align & ~(NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT)), &fstate);
 
 	breakRowWidth *= scale;
 
-	fonsTextIterInit(ctx->fs, &iter, 0, 0, string, end, FONS_GLYPH_BITMAP_OPTIONAL);
-	prevIter = iter;
+	// Metrics only, the glyphs need no space in the atlas.
+	fonsTextIterInitState(ctx->fs, &fstate, &iter, 0, 0, string, end, FONS_GLYPH_BITMAP_OPTIONAL);
 	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
-		if (iter.prevGlyphIndex < 0 && nvg__allocTextAtlas(ctx)) { // can not retrieve glyph?
-			iter = prevIter;
-			fonsTextIterNext(ctx->fs, &iter, &q); // try again
-		}
-		prevIter = iter;
 		switch (iter.codepoint) {
 			case 9:			// \t
 			case 11:		// \v
@@ -2687,15 +3883,7 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 			nrows++;
 			if (nrows >= maxRows)
 				return nrows;
-			// Set null break point
-			breakEnd = rowStart;
-			breakWidth = 0.0;
-			breakMaxX = 0.0;
-			// Indicate to skip the white space at the beginning of the row.
-			rowStart = NULL;
-			rowEnd = NULL;
-			rowWidth = 0;
-			rowMinX = rowMaxX = 0;
+			resume = iter.next;
 		} else {
 			if (rowStart == NULL) {
 				// Skip white space until the beginning of the line
@@ -2708,8 +3896,6 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 					rowMinX = q.x0 - rowStartX;
 					rowMaxX = q.x1 - rowStartX;
 					wordStart = iter.str;
-					wordStartX = iter.x;
-					wordMinX = q.x0 - rowStartX;
 					// Set null break point
 					breakEnd = rowStart;
 					breakWidth = 0.0;
@@ -2733,8 +3919,6 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 				// track last beginning of a word
 				if ((ptype == NVG_SPACE && (type == NVG_CHAR || type == NVG_CJK_CHAR)) || type == NVG_CJK_CHAR) {
 					wordStart = iter.str;
-					wordStartX = iter.x;
-					wordMinX = q.x0;
 				}
 
 				// Break to new line when a character is beyond break width.
@@ -2751,15 +3935,7 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 						nrows++;
 						if (nrows >= maxRows)
 							return nrows;
-						rowStartX = iter.x;
-						rowStart = iter.str;
-						rowEnd = iter.next;
-						rowWidth = iter.nextx - rowStartX;
-						rowMinX = q.x0 - rowStartX;
-						rowMaxX = q.x1 - rowStartX;
-						wordStart = iter.str;
-						wordStartX = iter.x;
-						wordMinX = q.x0 - rowStartX;
+						resume = iter.str;
 					} else {
 						// Break the line from the end of the last word, and start new line from the beginning of the new.
 						rows[nrows].start = rowStart;
@@ -2771,24 +3947,25 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 						nrows++;
 						if (nrows >= maxRows)
 							return nrows;
-						// Update row
-						rowStartX = wordStartX;
-						rowStart = wordStart;
-						rowEnd = iter.next;
-						rowWidth = iter.nextx - rowStartX;
-						rowMinX = wordMinX - rowStartX;
-						rowMaxX = q.x1 - rowStartX;
+						resume = wordStart;
 					}
-					// Set null break point
-					breakEnd = rowStart;
-					breakWidth = 0.0;
-					breakMaxX = 0.0;
 				}
 			}
 		}
 
 		pcodepoint = iter.codepoint;
 		ptype = type;
+
+		if (resume != NULL) {
+			// Measure the next row as it is drawn, on its own without kerning against the previous one.
+			fonsTextIterInitState(ctx->fs, &fstate, &iter, 0, 0, resume, end, FONS_GLYPH_BITMAP_OPTIONAL);
+			resume = NULL;
+			// Indicate to skip the white space at the beginning of the row.
+			rowStart = NULL;
+			rowEnd = NULL;
+			rowWidth = 0;
+			rowMinX = rowMaxX = 0;
+		}
 	}
 
 	// Break the line from the end of the last word, and start new line from the beginning of the new.
@@ -2805,25 +3982,82 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 	return nrows;
 }
 
+int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows)
+{
+	return nvg__textBreakLines(ctx, nvg__getState(ctx)->textAlign, string, end, breakRowWidth, rows, maxRows, 0);
+}
+
+// Returns the new line character that ended a row, or 0 if the row was wrapped or ends the text.
+static unsigned int nvg__textRowNewline(const char* text, const char* next)
+{
+	const unsigned char* p = (const unsigned char*)next;
+	if (next - text >= 1 && (p[-1] == 10 || p[-1] == 13))
+		return p[-1];
+	if (next - text >= 2 && p[-2] == 0xc2 && p[-1] == 0x85) // NEL
+		return 0x85;
+	return 0;
+}
+
+// Horizontal offset of a row within the text box.
+static float nvg__textRowOffset(int haling, float breakRowWidth, float rowWidth)
+{
+	if (haling & NVG_ALIGN_LEFT)
+		return 0;
+	else if (haling & NVG_ALIGN_CENTER)
+		return breakRowWidth*0.5f - rowWidth*0.5f;
+	else if (haling & NVG_ALIGN_RIGHT)
+		return breakRowWidth - rowWidth;
+	return 0;
+}
+
+void nvgTextBox(NVGcontext* ctx, float x, float y, float breakRowWidth, const char* string, const char* end)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGtextRow rows[2];
+	const char* text = string;
+	unsigned int pcodepoint = 0;
+	int nrows = 0, i;
+	int oldAlign = state->textAlign;
+	int haling = state->textAlign & (NVG_ALIGN_LEFT | NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT);
+	int valign = state->textAlign & (NVG_ALIGN_TOP | NVG_ALIGN_MIDDLE | NVG_ALIGN_BOTTOM | NVG_ALIGN_BASELINE);
+	float lineh = 0;
+
+	if (state->fontId == FONS_INVALID) return;
+
+	nvgTextMetrics(ctx, NULL, NULL, &lineh);
+
+	state->textAlign = NVG_ALIGN_LEFT | valign;
+
+	while ((nrows = nvg__textBreakLines(ctx, state->textAlign, string, end, breakRowWidth, rows, 2, pcodepoint))) {
+		for (i = 0; i < nrows; i++) {
+			NVGtextRow* row = &rows[i];
+			if (haling & (NVG_ALIGN_LEFT | NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT))
+				nvgText(ctx, x + nvg__textRowOffset(haling, breakRowWidth, row->width), y, row->start, row->end);
+			y += lineh * state->lineHeight;
+		}
+		string = rows[nrows-1].next;
+		pcodepoint = nvg__textRowNewline(text, string);
+	}
+
+	state->textAlign = oldAlign;
+}
+
 float nvgTextBounds(NVGcontext* ctx, float x, float y, const char* string, const char* end, float* bounds)
 {
 	NVGstate* state = nvg__getState(ctx);
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
+	FONSstate fstate;
 	float width;
 
 	if (state->fontId == FONS_INVALID) return 0;
 
-	fonsSetSize(ctx->fs, state->fontSize*scale);
-	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
-	fonsSetBlur(ctx->fs, state->fontBlur*scale);
-	fonsSetAlign(ctx->fs, state->textAlign);
-	fonsSetFont(ctx->fs, state->fontId);
+	nvg__fontState(ctx, scale, state->textAlign, &fstate);
 
-	width = fonsTextBounds(ctx->fs, x*scale, y*scale, string, end, bounds);
+	width = fonsTextBoundsState(ctx->fs, &fstate, x*scale, y*scale, string, end, bounds);
 	if (bounds != NULL) {
 		// Use line bounds for height.
-		fonsLineBounds(ctx->fs, y*scale, &bounds[1], &bounds[3]);
+		fonsLineBoundsState(ctx->fs, &fstate, y*scale, &bounds[1], &bounds[3]);
 		bounds[0] *= invscale;
 		bounds[1] *= invscale;
 		bounds[2] *= invscale;
@@ -2836,14 +4070,16 @@ void nvgTextBoxBounds(NVGcontext* ctx, float x, float y, float breakRowWidth, co
 {
 	NVGstate* state = nvg__getState(ctx);
 	NVGtextRow rows[2];
+	const char* text = string;
+	unsigned int pcodepoint = 0;
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
 	int nrows = 0, i;
-	int oldAlign = state->textAlign;
 	int haling = state->textAlign & (NVG_ALIGN_LEFT | NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT);
 	int valign = state->textAlign & (NVG_ALIGN_TOP | NVG_ALIGN_MIDDLE | NVG_ALIGN_BOTTOM | NVG_ALIGN_BASELINE);
 	float lineh = 0, rminy = 0, rmaxy = 0;
 	float minx, miny, maxx, maxy;
+	FONSstate fstate;
 
 	if (state->fontId == FONS_INVALID) {
 		if (bounds != NULL)
@@ -2853,31 +4089,21 @@ void nvgTextBoxBounds(NVGcontext* ctx, float x, float y, float breakRowWidth, co
 
 	nvgTextMetrics(ctx, NULL, NULL, &lineh);
 
-	state->textAlign = NVG_ALIGN_LEFT | valign;
-
 	minx = maxx = x;
 	miny = maxy = y;
 
-	fonsSetSize(ctx->fs, state->fontSize*scale);
-	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
-	fonsSetBlur(ctx->fs, state->fontBlur*scale);
-	fonsSetAlign(ctx->fs, state->textAlign);
-	fonsSetFont(ctx->fs, state->fontId);
-	fonsLineBounds(ctx->fs, 0, &rminy, &rmaxy);
+	// Rows are measured left aligned.
+	nvg__fontState(ctx, scale, NVG_ALIGN_LEFT | valign, &fstate);
+	fonsLineBoundsState(ctx->fs, &fstate, 0, &rminy, &rmaxy);
 	rminy *= invscale;
 	rmaxy *= invscale;
 
-	while ((nrows = nvgTextBreakLines(ctx, string, end, breakRowWidth, rows, 2))) {
+	while ((nrows = nvg__textBreakLines(ctx, NVG_ALIGN_LEFT | valign, string, end, breakRowWidth, rows, 2, pcodepoint))) {
 		for (i = 0; i < nrows; i++) {
 			NVGtextRow* row = &rows[i];
-			float rminx, rmaxx, dx = 0;
+			float rminx, rmaxx, dx;
 			// Horizontal bounds
-			if (haling & NVG_ALIGN_LEFT)
-				dx = 0;
-			else if (haling & NVG_ALIGN_CENTER)
-				dx = breakRowWidth*0.5f - row->width*0.5f;
-			else if (haling & NVG_ALIGN_RIGHT)
-				dx = breakRowWidth - row->width;
+			dx = nvg__textRowOffset(haling, breakRowWidth, row->width);
 			rminx = x + row->minx + dx;
 			rmaxx = x + row->maxx + dx;
 			minx = nvg__minf(minx, rminx);
@@ -2889,9 +4115,216 @@ void nvgTextBoxBounds(NVGcontext* ctx, float x, float y, float breakRowWidth, co
 			y += lineh * state->lineHeight;
 		}
 		string = rows[nrows-1].next;
+		pcodepoint = nvg__textRowNewline(text, string);
 	}
 
-	state->textAlign = oldAlign;
+	if (bounds != NULL) {
+		bounds[0] = minx;
+		bounds[1] = miny;
+		bounds[2] = maxx;
+		bounds[3] = maxy;
+	}
+}
+
+NVGtextLayout* nvgCreateTextLayout(NVGcontext* ctx, float breakRowWidth)
+{
+	NVGtextLayout* layout = (NVGtextLayout*)malloc(sizeof(NVGtextLayout));
+	NVG_NOTUSED(ctx);
+	if (layout == NULL) return NULL;
+	memset(layout, 0, sizeof(NVGtextLayout));
+	layout->breakRowWidth = breakRowWidth;
+	layout->fstate.font = FONS_INVALID;
+	layout->dirty = 1;
+	return layout;
+}
+
+void nvgDeleteTextLayout(NVGcontext* ctx, NVGtextLayout* layout)
+{
+	NVG_NOTUSED(ctx);
+	if (layout == NULL) return;
+	free(layout->text);
+	free(layout->rows);
+	free(layout);
+}
+
+int nvgTextLayoutSetText(NVGcontext* ctx, NVGtextLayout* layout, const char* string, const char* end)
+{
+	if (end == NULL)
+		end = string + strlen(string);
+	if (layout->ntext == (int)(end - string) && (layout->ntext == 0 || memcmp(layout->text, string, layout->ntext) == 0))
+		return 1;
+	layout->ntext = 0;
+	layout->nrows = layout->nfinal = 0;
+	return nvgTextLayoutAppend(ctx, layout, string, end);
+}
+
+int nvgTextLayoutAppend(NVGcontext* ctx, NVGtextLayout* layout, const char* string, const char* end)
+{
+	int n;
+	NVG_NOTUSED(ctx);
+	if (end == NULL)
+		end = string + strlen(string);
+	n = (int)(end - string);
+	if (layout->ntext + n > layout->ctext) {
+		int ctext = nvg__maxi(layout->ntext + n, layout->ctext * 2);
+		char* text = (char*)realloc(layout->text, ctext);
+		if (text == NULL) return 0;
+		layout->text = text;
+		layout->ctext = ctext;
+	}
+	memcpy(layout->text + layout->ntext, string, n);
+	layout->ntext += n;
+	layout->dirty = 1;
+	return 1;
+}
+
+void nvgTextLayoutBreakWidth(NVGcontext* ctx, NVGtextLayout* layout, float breakRowWidth)
+{
+	NVG_NOTUSED(ctx);
+	if (layout->breakRowWidth == breakRowWidth) return;
+	layout->breakRowWidth = breakRowWidth;
+	layout->nrows = layout->nfinal = 0;
+	layout->dirty = 1;
+}
+
+// Breaks the rows of the layout that are out of date, and returns the number of rows.
+static int nvg__updateTextLayout(NVGcontext* ctx, NVGtextLayout* layout)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	const char* end = layout->text + layout->ntext;
+	const char* string;
+	unsigned int pcodepoint = 0;
+	NVGtextRow rows[64];
+	FONSstate fstate;
+	int i, nrows;
+
+	if (state->fontId == FONS_INVALID) return 0;
+
+	nvg__fontState(ctx, scale, NVG_ALIGN_LEFT, &fstate);
+	if (fstate.font != layout->fstate.font || fstate.size != layout->fstate.size ||
+		fstate.blur != layout->fstate.blur || fstate.spacing != layout->fstate.spacing ||
+		fstate.sdf != layout->fstate.sdf || fstate.subpixel != layout->fstate.subpixel || scale != layout->scale) {
+		layout->fstate = fstate;
+		layout->scale = scale;
+		layout->nrows = layout->nfinal = 0;
+		layout->dirty = 1;
+	}
+	if (!layout->dirty)
+		return layout->nrows;
+
+	// Rows ended by a new line are broken the same way whatever follows, resume after the last one.
+	layout->nrows = layout->nfinal;
+	string = layout->text;
+	if (layout->nfinal > 0) {
+		string = layout->text + layout->rows[layout->nfinal-1].next;
+		pcodepoint = nvg__textRowNewline(layout->text, string);
+	}
+
+	for (;;) {
+		int nkeep;
+		nrows = nvg__textBreakLines(ctx, NVG_ALIGN_LEFT, string, end, layout->breakRowWidth, rows, 64, pcodepoint);
+		if (layout->nrows + nrows > layout->crows) {
+			int crows = nvg__maxi(layout->nrows + nrows, nvg__maxi(64, layout->crows * 2));
+			NVGtextLayoutRow* lrows = (NVGtextLayoutRow*)realloc(layout->rows, sizeof(NVGtextLayoutRow) * crows);
+			if (lrows == NULL) return layout->nrows;
+			layout->rows = lrows;
+			layout->crows = crows;
+		}
+		// A full chunk may end mid-paragraph, break again from its last new line so the rows
+		// do not depend on where the chunks fall. Long paragraphs resume at the chunk end.
+		nkeep = nrows;
+		if (nrows == 64) {
+			for (i = nrows-1; i >= 0; i--) {
+				if (nvg__textRowNewline(layout->text, rows[i].next) != 0)
+					break;
+			}
+			if (i >= 0)
+				nkeep = i+1;
+		}
+		for (i = 0; i < nkeep; i++) {
+			NVGtextLayoutRow* row = &layout->rows[layout->nrows++];
+			row->start = (int)(rows[i].start - layout->text);
+			row->end = (int)(rows[i].end - layout->text);
+			row->next = (int)(rows[i].next - layout->text);
+			row->width = rows[i].width;
+			row->minx = rows[i].minx;
+			row->maxx = rows[i].maxx;
+			pcodepoint = nvg__textRowNewline(layout->text, rows[i].next);
+			if (pcodepoint != 0)
+				layout->nfinal = layout->nrows;
+		}
+		if (nrows < 64)
+			break;
+		string = rows[nkeep-1].next;
+	}
+
+	layout->dirty = 0;
+	return layout->nrows;
+}
+
+int nvgTextLayoutRowCount(NVGcontext* ctx, NVGtextLayout* layout)
+{
+	return nvg__updateTextLayout(ctx, layout);
+}
+
+int nvgTextLayoutRows(NVGcontext* ctx, NVGtextLayout* layout, int first, NVGtextRow* rows, int maxRows)
+{
+	int i, nrows = nvg__updateTextLayout(ctx, layout);
+	if (first < 0) first = 0;
+	for (i = 0; i < maxRows && first+i < nrows; i++) {
+		NVGtextLayoutRow* row = &layout->rows[first+i];
+		rows[i].start = layout->text + row->start;
+		rows[i].end = layout->text + row->end;
+		rows[i].next = layout->text + row->next;
+		rows[i].width = row->width;
+		rows[i].minx = row->minx;
+		rows[i].maxx = row->maxx;
+	}
+	return i;
+}
+
+void nvgTextLayoutBounds(NVGcontext* ctx, NVGtextLayout* layout, float x, float y, float* bounds)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	float invscale = 1.0f / scale;
+	int haling = state->textAlign & (NVG_ALIGN_LEFT | NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT);
+	int valign = state->textAlign & (NVG_ALIGN_TOP | NVG_ALIGN_MIDDLE | NVG_ALIGN_BOTTOM | NVG_ALIGN_BASELINE);
+	float lineh = 0, rminy = 0, rmaxy = 0;
+	float minx, miny, maxx, maxy;
+	FONSstate fstate;
+	int i, nrows;
+
+	if (state->fontId == FONS_INVALID) {
+		if (bounds != NULL)
+			bounds[0] = bounds[1] = bounds[2] = bounds[3] = 0.0f;
+		return;
+	}
+
+	nrows = nvg__updateTextLayout(ctx, layout);
+	nvgTextMetrics(ctx, NULL, NULL, &lineh);
+
+	minx = maxx = x;
+	miny = maxy = y;
+
+	nvg__fontState(ctx, scale, NVG_ALIGN_LEFT | valign, &fstate);
+	fonsLineBoundsState(ctx->fs, &fstate, 0, &rminy, &rmaxy);
+	rminy *= invscale;
+	rmaxy *= invscale;
+
+	for (i = 0; i < nrows; i++) {
+		NVGtextLayoutRow* row = &layout->rows[i];
+		float dx = nvg__textRowOffset(haling, layout->breakRowWidth, row->width);
+		minx = nvg__minf(minx, x + row->minx + dx);
+		maxx = nvg__maxf(maxx, x + row->maxx + dx);
+	}
+	if (nrows > 0) {
+		// Rows are evenly spaced, the first and last hold the vertical bounds.
+		float ly = y + (nrows-1) * lineh * state->lineHeight;
+		miny = nvg__minf(miny, nvg__minf(y, ly) + rminy);
+		maxy = nvg__maxf(maxy, nvg__maxf(y, ly) + rmaxy);
+	}
 
 	if (bounds != NULL) {
 		bounds[0] = minx;
@@ -2901,21 +4334,47 @@ void nvgTextBoxBounds(NVGcontext* ctx, float x, float y, float breakRowWidth, co
 	}
 }
 
+void nvgDrawTextLayout(NVGcontext* ctx, NVGtextLayout* layout, float x, float y, int first, int count)
+{
+	NVGstate* state = nvg__getState(ctx);
+	int oldAlign = state->textAlign;
+	int haling = state->textAlign & (NVG_ALIGN_LEFT | NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT);
+	int valign = state->textAlign & (NVG_ALIGN_TOP | NVG_ALIGN_MIDDLE | NVG_ALIGN_BOTTOM | NVG_ALIGN_BASELINE);
+	float lineh = 0;
+	int i, nrows;
+
+	nrows = nvg__updateTextLayout(ctx, layout);
+	if (first < 0) first = 0;
+	if (count < 0 || count > nrows - first) count = nrows - first;
+	if (count <= 0) return;
+
+	nvgTextMetrics(ctx, NULL, NULL, &lineh);
+
+	state->textAlign = NVG_ALIGN_LEFT | valign;
+
+	y += first * lineh * state->lineHeight;
+	for (i = first; i < first + count; i++) {
+		NVGtextLayoutRow* row = &layout->rows[i];
+		nvgText(ctx, x + nvg__textRowOffset(haling, layout->breakRowWidth, row->width), y,
+				layout->text + row->start, layout->text + row->end);
+		y += lineh * state->lineHeight;
+	}
+
+	state->textAlign = oldAlign;
+}
+
 void nvgTextMetrics(NVGcontext* ctx, float* ascender, float* descender, float* lineh)
 {
 	NVGstate* state = nvg__getState(ctx);
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
+	FONSstate fstate;
 
 	if (state->fontId == FONS_INVALID) return;
 
-	fonsSetSize(ctx->fs, state->fontSize*scale);
-	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
-	fonsSetBlur(ctx->fs, state->fontBlur*scale);
-	fonsSetAlign(ctx->fs, state->textAlign);
-	fonsSetFont(ctx->fs, state->fontId);
+	nvg__fontState(ctx, scale, state->textAlign, &fstate);
 
-	fonsVertMetrics(ctx->fs, ascender, descender, lineh);
+	fonsVertMetricsState(ctx->fs, &fstate, ascender, descender, lineh);
 	if (ascender != NULL)
 		*ascender *= invscale;
 	if (descender != NULL)
@@ -135,6 +135,8 @@ struct NVGtextRow {
 };
 typedef struct NVGtextRow NVGtextRow;
 
+typedef struct NVGtextLayout NVGtextLayout;
+
 enum NVGimageFlags {
     NVG_IMAGE_GENERATE_MIPMAPS	= 1<<0,     // Generate mipmaps during creation of the image.
 	NVG_IMAGE_REPEATX			= 1<<1,		// Repeat image in X direction.
@@ -160,6 +162,26 @@ void nvgCancelFrame(NVGcontext* ctx);
 // Ends drawing flushing remaining render state.
 void nvgEndFrame(NVGcontext* ctx);
 
+// Returns the number of fills and strokes skipped since nvgBeginFrame() because
+// they were entirely outside of the view or the scissor. Either pointer may be NULL.
+void nvgCulledCount(NVGcontext* ctx, int* fills, int* strokes);
+
+//
+// Frame memory
+//
+// The internal command, path and vertex buffers are allocated from a linear arena
+// which is reset by nvgBeginFrame(). The arena is grown to the high-water mark of the
+// previous frame, so once the scene settles, frames do not touch the heap.
+
+// Sets the memory block used for the frame arena. The memory must stay valid until the context
+// is deleted or an other block is set. If the block turns out to be too small, NanoVG replaces it
+// with an allocated one. Pass NULL to let NanoVG manage the memory. Must be called outside of
+// nvgBeginFrame() and nvgEndFrame().
+void nvgFrameArena(NVGcontext* ctx, void* mem, int size);
+
+// Returns the number of heap allocations made for the frame arena during the current frame.
+int nvgFrameAllocCount(NVGcontext* ctx);
+
 //
 // Composite operation
 //
@@ -540,6 +562,10 @@ void nvgStroke(NVGcontext* ctx);
 //		nvgRoundedRect(vg, bounds[0],bounds[1], bounds[2]-bounds[0], bounds[3]-bounds[1]);
 //		nvgFill(vg);
 //
+// The measure functions nvgTextBounds(), nvgTextBoxBounds(), nvgTextGlyphPositions(),
+// nvgTextMetrics() and nvgTextBreakLines() do not modify the context. They can be called
+// from several threads at once, as long as no other call uses the context meanwhile.
+//
 // Note: currently only solid color fill is supported for text.
 
 // Creates font by loading it from the disk from specified file name.
@@ -592,9 +618,42 @@ void nvgFontFaceId(NVGcontext* ctx, int font);
 // Sets the font face based on specified name of current text style.
 void nvgFontFace(NVGcontext* ctx, const char* font);
 
+// Sets whether the current text style is drawn with signed distance field glyphs. These are rasterized
+// once at a fixed size and scaled to any size, so zooming text does not add glyphs to the font atlas,
+// and glyphs are placed at fractional positions. Blurred text and back-ends without
+// distance field support keep using glyphs rasterized for each size.
+void nvgTextSDF(NVGcontext* ctx, int enabled);
+
+// Sets whether the glyphs of the current text style are placed at 1/FONS_SUBPIXEL_STEPS (a quarter)
+// pixel positions instead of whole pixels, so slowly moving or scaled text does not jitter. Each glyph
+// is rasterized once per offset it is drawn at, taking up to that many times the font atlas space.
+// Not used for blurred and distance field text, or with FreeType.
+void nvgTextSubpixel(NVGcontext* ctx, int enabled);
+
 // Draws text string at specified location. If end is specified only the sub-string up to the end is drawn.
 float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char* end);
 
+// Returns the number of nvgText() calls served from the shaped text cache and the number of calls
+// that had to shape their text, since the context was created. Strings are cached together with
+// the font, size, blur, letter spacing and align they were drawn with.
+void nvgTextCacheStats(NVGcontext* ctx, int* hits, int* misses);
+
+// Sets whether glyphs missing from the font atlas are rasterized right away inside nvgText(), or
+// queued for nvgRasterizeGlyphs(). Text is drawn without its queued glyphs until they are in the
+// atlas. Rasterized glyphs are added to the atlas at the end of the frame by nvgEndFrame(), or
+// earlier when the text moves to a new atlas, so they are drawn from the next frame on.
+void nvgTextAsyncGlyphs(NVGcontext* ctx, int enabled);
+
+// Rasterizes up to maxGlyphs queued glyphs, or all if maxGlyphs <= 0, and returns how many it did.
+// Can be called from worker threads at the same time as any other call except nvgDeleteInternal().
+int nvgRasterizeGlyphs(NVGcontext* ctx, int maxGlyphs);
+
+// Adds the glyphs of codepoints first to last in the current font, size and blur to the font atlas,
+// so that drawing them later does not need to rasterize. The size depends on the current transform.
+// With nvgTextSubpixel() on, each glyph is added at every subpixel offset, FONS_SUBPIXEL_STEPS
+// bitmaps per glyph. Returns 0 if the atlas is full.
+int nvgPrewarmGlyphs(NVGcontext* ctx, unsigned int first, unsigned int last);
+
 // Draws multi-line text string at specified location wrapped at the specified width. If end is specified only the sub-string up to the end is drawn.
 // White space is stripped at the beginning of the rows, the text is split at word boundaries or when new-line characters are encountered.
 // Words longer than the max width are slit at nearest character (i.e. no hyphenation).
@@ -622,8 +681,47 @@ void nvgTextMetrics(NVGcontext* ctx, float* ascender, float* descender, float* l
 // Breaks the specified text into lines. If end is specified only the sub-string will be used.
 // White space is stripped at the beginning of the rows, the text is split at word boundaries or when new-line characters are encountered.
 // Words longer than the max width are slit at nearest character (i.e. no hyphenation).
+// Each row is measured on its own, as it is drawn, without kerning against the previous row.
 int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows);
 
+// Text layouts keep a multi-line text string broken into rows, so that text drawn every frame is not
+// broken again unless the text, the break width or the text style changes. Rows are broken with the
+// current text style when the layout is measured or drawn. Appended text only breaks the rows after
+// the last new line again, which suits log and console panels. Like the measure functions,
+// nvgTextLayoutRowCount(), nvgTextLayoutRows() and nvgTextLayoutBounds() can be called from several
+// threads at once, as long as each layout is used by one thread and no other call uses the context
+// meanwhile. nvgDrawTextLayout() draws into the frame and is not thread-safe.
+
+// Creates an empty text layout wrapped at the specified width. Returns NULL if out of memory.
+NVGtextLayout* nvgCreateTextLayout(NVGcontext* ctx, float breakRowWidth);
+
+// Deletes the text layout.
+void nvgDeleteTextLayout(NVGcontext* ctx, NVGtextLayout* layout);
+
+// Sets the text of the layout, a copy is kept. If end is specified only the sub-string is used.
+// Setting the same text again keeps the rows. Returns 0 if out of memory.
+int nvgTextLayoutSetText(NVGcontext* ctx, NVGtextLayout* layout, const char* string, const char* end);
+
+// Appends text to the layout. If end is specified only the sub-string is used. Returns 0 if out of memory.
+int nvgTextLayoutAppend(NVGcontext* ctx, NVGtextLayout* layout, const char* string, const char* end);
+
+// Sets the width the rows of the layout are wrapped at.
+void nvgTextLayoutBreakWidth(NVGcontext* ctx, NVGtextLayout* layout, float breakRowWidth);
+
+// Returns the number of rows of the layout.
+int nvgTextLayoutRowCount(NVGcontext* ctx, NVGtextLayout* layout);
+
+// Copies up to maxRows rows of the layout starting at row first, and returns how many were copied.
+// The row pointers point to the text of the layout, and are valid until its text is changed.
+int nvgTextLayoutRows(NVGcontext* ctx, NVGtextLayout* layout, int first, NVGtextRow* rows, int maxRows);
+
+// Measures the text layout as nvgTextBoxBounds() does. Measured values are returned in local coordinate space.
+void nvgTextLayoutBounds(NVGcontext* ctx, NVGtextLayout* layout, float x, float y, float* bounds);
+
+// Draws the text layout at specified location as nvgTextBox() does. Only rows first to first+count-1
+// are drawn, or all rows from first on if count is negative, the first row of the layout is at y.
+void nvgDrawTextLayout(NVGcontext* ctx, NVGtextLayout* layout, float x, float y, int first, int count);
+
 //
 // Internal Render API
 //
@@ -654,12 +752,14 @@ struct NVGpath {
 	int nstroke;
 	int winding;
 	int convex;
+	int triangulated;	// Fill is a triangle list instead of a fan.
 };
 typedef struct NVGpath NVGpath;
 
 struct NVGparams {
 	void* userPtr;
 	int edgeAntiAlias;
+	int triangulateFills;	// Back-end can draw triangulated fills of single paths.
 	int (*renderCreate)(void* uptr);
 	int (*renderCreateTexture)(void* uptr, int type, int w, int h, int imageFlags, const unsigned char* data);
 	int (*renderDeleteTexture)(void* uptr, int image);
@@ -671,6 +771,13 @@ struct NVGparams {
 	void (*renderFill)(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, float fringe, const float* bounds, const NVGpath* paths, int npaths);
 	void (*renderStroke)(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths);
 	void (*renderTriangles)(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, const NVGvertex* verts, int nverts, float fringe);
+	// Optional. Like renderTriangles, but the alpha texture holds a distance field: coverage is
+	// clamp((texel - edge) * scale + 0.5, 0, 1). Text is drawn with distance field glyphs only when set.
+	void (*renderTrianglesSDF)(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, const NVGvertex* verts, int nverts, float fringe, float edge, float scale);
+	// Optional. Returns space for nverts vertices in the back-end's own vertex storage, or NULL.
+	// The expanded paths and batched text are written there and handed to the next render call, which can
+	// skip copying them. Reserving again before that call keeps the vertices written so far at the start.
+	NVGvertex* (*renderReserveVerts)(void* uptr, int nverts);
 	void (*renderDelete)(void* uptr);
 };
 typedef struct NVGparams NVGparams;
@@ -32,6 +32,21 @@ enum NVGcreateFlags {
 	NVG_STENCIL_STROKES	= 1<<1,
 	// Flag indicating that additional debug checks are done.
 	NVG_DEBUG 			= 1<<2,
+	// Flag indicating that vertices and uniforms are copied into a triple buffered, mapped GPU
+	// buffer instead of respecifying the buffers each frame (GL3 only).
+	NVG_RING_BUFFERS	= 1<<3,
+	// Flag indicating that concave fills are triangulated on the CPU and drawn without stencil
+	// when possible, so they can be batched with other calls.
+	NVG_TRIANGULATE_FILLS	= 1<<4,
+	// Flag indicating that small RGBA images without repeat or mipmaps are packed into shared
+	// atlas textures, so that calls using different images can be batched.
+	NVG_IMAGE_ATLAS		= 1<<5,
+	// Flag indicating that calls are drawn with shader programs specialized for their paint type
+	// and scissor, instead of one program branching on them for every fragment.
+	NVG_SHADER_VARIANTS	= 1<<6,
+	// Flag indicating that texture updates are staged through pixel buffer objects, so that
+	// the upload of the font atlas and of dynamic images overlaps with rendering (GL3 and GLES3 only).
+	NVG_ASYNC_UPLOADS	= 1<<7,
 };
 
 #if defined NANOVG_GL2_IMPLEMENTATION
@@ -113,6 +128,15 @@ enum NVGimageFlagsGL {
 #include <math.h>
 #include "nanovg.h"
 
+#if defined NANOVG_GL_RECORD && defined NANOVG_GL3
+// Route the GL calls through the recording function table.
+#define NANOVG_GL_RECORD_IMPLEMENTATION
+#include "nanovg_gl_record.h"
+#define glnvg__recordStat(field, n) (glnvgrec__stats.field += (n))
+#else
+#define glnvg__recordStat(field, n)
+#endif
+
 enum GLNVGuniformLoc {
 	GLNVG_LOC_VIEWSIZE,
 	GLNVG_LOC_TEX,
@@ -127,10 +151,38 @@ enum GLNVGshaderType {
 	NSVG_SHADER_IMG
 };
 
+// Paint kinds of the specialized shader programs, each compiled with and without scissor.
+enum GLNVGshaderVariant {
+	GLNVG_VARIANT_SIMPLE,
+	GLNVG_VARIANT_SOLID,
+	GLNVG_VARIANT_FILLGRAD,
+	GLNVG_VARIANT_FILLIMG,
+	GLNVG_VARIANT_IMG,
+	GLNVG_VARIANT_KINDS
+};
+#define GLNVG_VARIANT_COUNT (GLNVG_VARIANT_KINDS*2)
+
 #if NANOVG_GL_USE_UNIFORMBUFFER
 enum GLNVGuniformBindings {
 	GLNVG_FRAG_BINDING = 0,
 };
+
+// Max number of paints a merged draw call can address.
+#define GLNVG_MAX_MERGED_PAINTS 64
+#endif
+
+#if NANOVG_GL_USE_UNIFORMBUFFER && defined(GL_SYNC_GPU_COMMANDS_COMPLETE)
+#  define NANOVG_GL_USE_RING 1
+// Number of frames the CPU can record ahead of the GPU before waiting.
+#  define GLNVG_FRAMES 3
+#else
+#  define GLNVG_FRAMES 1
+#endif
+
+#if (defined NANOVG_GL3 || defined NANOVG_GLES3) && defined(GL_SYNC_GPU_COMMANDS_COMPLETE)
+#  define NANOVG_GL_USE_PBO 1
+// Number of staging buffers texture uploads rotate through.
+#  define GLNVG_PBO_COUNT 4
 #endif
 
 struct GLNVGshader {
@@ -138,6 +190,10 @@ struct GLNVGshader {
 	GLuint frag;
 	GLuint vert;
 	GLint loc[GLNVG_MAX_LOCS];
+	float view[2];	// View size last set on the program.
+#if !NANOVG_GL_USE_UNIFORMBUFFER
+	int fragOffset;	// Uniforms last uploaded to the program in this flush, -1 if none.
+#endif
 };
 typedef struct GLNVGshader GLNVGshader;
 
@@ -147,9 +203,36 @@ struct GLNVGtexture {
 	int width, height;
 	int type;
 	int flags;
+	int atlas;	// Index+1 of the atlas page holding the image, 0 if it has its own texture.
+	int x, y;	// Position in the atlas page.
 };
 typedef struct GLNVGtexture GLNVGtexture;
 
+#define GLNVG_ATLAS_SIZE 2048
+#define GLNVG_ATLAS_MAX_IMAGE 256
+
+struct GLNVGatlasNode {
+	short x, y, width;
+};
+typedef struct GLNVGatlasNode GLNVGatlasNode;
+
+struct GLNVGatlas {
+	GLuint tex;
+	int width, height;
+	GLNVGatlasNode* nodes;
+	int nnodes;
+	int cnodes;
+	int nimages;
+	int usedArea;	// Area of the live images.
+	int allocArea;	// Area handed out since the last reset, includes deleted images.
+};
+typedef struct GLNVGatlas GLNVGatlas;
+
+#if defined(NANOVG_GL3) || defined(NANOVG_GLES2) || defined(NANOVG_GLES3)
+// Compacting atlas pages copies the images through a framebuffer object.
+#  define NANOVG_GL_ATLAS_COMPACT 1
+#endif
+
 struct GLNVGblend
 {
 	GLenum srcRGB;
@@ -169,12 +252,18 @@ enum GLNVGcallType {
 
 struct GLNVGcall {
 	int type;
-	int image;
+	GLuint tex;		// Texture of the paint, resolved when the call is recorded.
 	int pathOffset;
 	int pathCount;
 	int triangleOffset;
 	int triangleCount;
 	int uniformOffset;
+	int vertexOffset;
+	int vertexCount;
+	int mergeCount;
+	int indexOffset;
+	int indexCount;
+	int variant;	// Shader variant of the call, -1 for the generic shader.
 	GLNVGblend blendFunc;
 };
 typedef struct GLNVGcall GLNVGcall;
@@ -202,10 +291,11 @@ struct GLNVGfragUniforms {
 		float strokeThr;
 		int texType;
 		int type;
+		float imageClamp[4];
 	#else
 		// note: after modifying layout or size of uniform array,
 		// don't forget to also update the fragment shader source!
-		#define NANOVG_GL_UNIFORMARRAY_SIZE 11
+		#define NANOVG_GL_UNIFORMARRAY_SIZE 12
 		union {
 			struct {
 				float scissorMat[12]; // matrices are actually 3 vec4s
@@ -221,6 +311,7 @@ struct GLNVGfragUniforms {
 				float strokeThr;
 				float texType;
 				float type;
+				float imageClamp[4];
 			};
 			float uniformArray[NANOVG_GL_UNIFORMARRAY_SIZE][4];
 		};
@@ -228,19 +319,73 @@ struct GLNVGfragUniforms {
 };
 typedef struct GLNVGfragUniforms GLNVGfragUniforms;
 
+#if NANOVG_GL_USE_RING
+struct GLNVGring {
+	GLenum target;
+	GLuint buf;
+	int slotSize;		// Bytes per frame.
+	int need;			// Largest frame which did not fit in a slot.
+	unsigned char* mem;	// Persistent mapping of the whole buffer, NULL if mapped per frame.
+};
+typedef struct GLNVGring GLNVGring;
+#endif
+
+// Buffers of one frame in flight, reused only once the GPU is done with them.
+struct GLNVGframe {
+	GLuint vertBuf;
+#if defined NANOVG_GL3
+	GLuint vertArr;
+	GLuint vertArrBuf;		// Buffer and offset the vertex array attributes point at.
+	size_t vertArrOffset;
+#endif
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	GLuint fragBuf;
+	GLuint paintBuf;
+	GLuint indexBuf;
+#endif
+#if NANOVG_GL_USE_RING
+	GLsync fence;			// Signaled when the GPU has consumed the frame.
+#endif
+};
+typedef struct GLNVGframe GLNVGframe;
+
+#if NANOVG_GL_USE_PBO
+struct GLNVGpbo {
+	GLuint buf;
+	int size;
+	GLsync fence;	// Signaled when the GPU has read the staged pixels.
+};
+typedef struct GLNVGpbo GLNVGpbo;
+#endif
+
 struct GLNVGcontext {
 	GLNVGshader shader;
+	GLNVGshader variants[GLNVG_VARIANT_COUNT];
+	GLNVGshader* curShader;
 	GLNVGtexture* textures;
 	float view[2];
 	int ntextures;
 	int ctextures;
 	int textureId;
-	GLuint vertBuf;
-#if defined NANOVG_GL3
-	GLuint vertArr;
-#endif
+	GLNVGatlas* atlases;
+	int natlases;
+	int catlases;
+	int atlasSize;
+	GLNVGframe frames[GLNVG_FRAMES];
+	int frame;
 #if NANOVG_GL_USE_UNIFORMBUFFER
-	GLuint fragBuf;
+	int maxMerge;
+	GLuint drawFragBuf;
+	int drawFragOffset;
+#endif
+#if NANOVG_GL_USE_RING
+	GLNVGring vertRing;
+	GLNVGring fragRing;
+	int ringPersistent;
+#endif
+#if NANOVG_GL_USE_PBO
+	GLNVGpbo pbos[GLNVG_PBO_COUNT];
+	int pboIndex;
 #endif
 	int fragSize;
 	int flags;
@@ -258,6 +403,12 @@ struct GLNVGcontext {
 	unsigned char* uniforms;
 	int cuniforms;
 	int nuniforms;
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	unsigned short* vertPaints;
+	GLuint* indices;
+	int cindices;
+	int nindices;
+#endif
 
 	// cached state
 	#if NANOVG_GL_USE_STATE_FILTER
@@ -266,7 +417,15 @@ struct GLNVGcontext {
 	GLenum stencilFunc;
 	GLint stencilFuncRef;
 	GLuint stencilFuncMask;
+	GLenum stencilOp[2][3];	// Front and back fail, depth fail and pass operations.
+	int stencilTest;
+	int cullFace;
+	int colorMask;
 	GLNVGblend blendFunc;
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	GLuint boundFragBuf;
+	int boundFragOffset;
+#endif
 	#endif
 
 	int dummyTex;
@@ -274,6 +433,7 @@ struct GLNVGcontext {
 typedef struct GLNVGcontext GLNVGcontext;
 
 static int glnvg__maxi(int a, int b) { return a > b ? a : b; }
+static int glnvg__mini(int a, int b) { return a < b ? a : b; }
 
 #ifdef NANOVG_GLES2
 static unsigned int glnvg__nearestPow2(unsigned int num)
@@ -329,6 +489,70 @@ static void glnvg__stencilFunc(GLNVGcontext* gl, GLenum func, GLint ref, GLuint
 	glStencilFunc(func, ref, mask);
 #endif
 }
+static void glnvg__stencilOp(GLNVGcontext* gl, GLenum face, GLenum sfail, GLenum dpfail, GLenum dppass)
+{
+#if NANOVG_GL_USE_STATE_FILTER
+	int i, first = face == GL_BACK ? 1 : 0, last = face == GL_FRONT ? 0 : 1, changed = 0;
+	for (i = first; i <= last; i++) {
+		if (gl->stencilOp[i][0] != sfail || gl->stencilOp[i][1] != dpfail || gl->stencilOp[i][2] != dppass) {
+			gl->stencilOp[i][0] = sfail;
+			gl->stencilOp[i][1] = dpfail;
+			gl->stencilOp[i][2] = dppass;
+			changed = 1;
+		}
+	}
+	if (!changed) return;
+#endif
+	if (face == GL_FRONT_AND_BACK)
+		glStencilOp(sfail, dpfail, dppass);
+	else
+		glStencilOpSeparate(face, sfail, dpfail, dppass);
+}
+
+static void glnvg__enable(GLenum cap, int* state, int enable)
+{
+#if NANOVG_GL_USE_STATE_FILTER
+	if (*state == enable) return;
+	*state = enable;
+#else
+	NVG_NOTUSED(state);
+#endif
+	if (enable)
+		glEnable(cap);
+	else
+		glDisable(cap);
+}
+
+static void glnvg__stencilTest(GLNVGcontext* gl, int enable)
+{
+#if NANOVG_GL_USE_STATE_FILTER
+	glnvg__enable(GL_STENCIL_TEST, &gl->stencilTest, enable);
+#else
+	glnvg__enable(GL_STENCIL_TEST, NULL, enable);
+#endif
+}
+
+static void glnvg__cullFace(GLNVGcontext* gl, int enable)
+{
+#if NANOVG_GL_USE_STATE_FILTER
+	glnvg__enable(GL_CULL_FACE, &gl->cullFace, enable);
+#else
+	glnvg__enable(GL_CULL_FACE, NULL, enable);
+#endif
+}
+
+static void glnvg__colorMask(GLNVGcontext* gl, int enable)
+{
+#if NANOVG_GL_USE_STATE_FILTER
+	if (gl->colorMask == enable) return;
+	gl->colorMask = enable;
+#endif
+	if (enable)
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	else
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+}
+
 static void glnvg__blendFuncSeparate(GLNVGcontext* gl, const GLNVGblend* blend)
 {
 #if NANOVG_GL_USE_STATE_FILTER
@@ -383,13 +607,338 @@ static GLNVGtexture* glnvg__findTexture(GLNVGcontext* gl, int id)
 	return NULL;
 }
 
-static int glnvg__deleteTexture(GLNVGcontext* gl, int id)
+// Returns the texture to bind for a paint image, the empty texture if there is none.
+static GLuint glnvg__paintTexture(GLNVGcontext* gl, int image)
+{
+	GLNVGtexture* tex = NULL;
+	if (image != 0)
+		tex = glnvg__findTexture(gl, image);
+	if (tex == NULL)
+		tex = glnvg__findTexture(gl, gl->dummyTex);
+	return tex != NULL ? tex->tex : 0;
+}
+
+// Skyline packer of the image atlas, forked from the fons__atlas functions of fontstash.h.
+// The skyline code is the same, fixes to it apply to both. Fontstash also reuses the space of
+// evicted glyphs through a list of free rectangles and grows its atlas in place, the image atlas
+// instead resets a page when it empties and repacks it in glnvg__atlasCompact().
+static int glnvg__atlasInsertNode(GLNVGatlas* atlas, int idx, int x, int y, int w)
+{
+	int i;
+	// Insert node
+	if (atlas->nnodes+1 > atlas->cnodes) {
+		GLNVGatlasNode* nodes;
+		int cnodes = atlas->cnodes == 0 ? 8 : atlas->cnodes * 2;
+		nodes = (GLNVGatlasNode*)realloc(atlas->nodes, sizeof(GLNVGatlasNode) * cnodes);
+		if (nodes == NULL)
+			return 0;
+		atlas->nodes = nodes;
+		atlas->cnodes = cnodes;
+	}
+	for (i = atlas->nnodes; i > idx; i--)
+		atlas->nodes[i] = atlas->nodes[i-1];
+	atlas->nodes[idx].x = (short)x;
+	atlas->nodes[idx].y = (short)y;
+	atlas->nodes[idx].width = (short)w;
+	atlas->nnodes++;
+
+	return 1;
+}
+
+static void glnvg__atlasRemoveNode(GLNVGatlas* atlas, int idx)
+{
+	int i;
+	if (atlas->nnodes == 0) return;
+	for (i = idx; i < atlas->nnodes-1; i++)
+		atlas->nodes[i] = atlas->nodes[i+1];
+	atlas->nnodes--;
+}
+
+static int glnvg__atlasReset(GLNVGatlas* atlas)
+{
+	atlas->nnodes = 0;
+	atlas->allocArea = 0;
+	// Init root node.
+	return glnvg__atlasInsertNode(atlas, 0, 0, 0, atlas->width);
+}
+
+static int glnvg__atlasAddSkylineLevel(GLNVGatlas* atlas, int idx, int x, int y, int w, int h)
+{
+	int i;
+
+	// Insert new node
+	if (glnvg__atlasInsertNode(atlas, idx, x, y+h, w) == 0)
+		return 0;
+
+	// Delete skyline segments that fall under the shadow of the new segment.
+	for (i = idx+1; i < atlas->nnodes; i++) {
+		if (atlas->nodes[i].x < atlas->nodes[i-1].x + atlas->nodes[i-1].width) {
+			int shrink = atlas->nodes[i-1].x + atlas->nodes[i-1].width - atlas->nodes[i].x;
+			atlas->nodes[i].x += (short)shrink;
+			atlas->nodes[i].width -= (short)shrink;
+			if (atlas->nodes[i].width <= 0) {
+				glnvg__atlasRemoveNode(atlas, i);
+				i--;
+			} else {
+				break;
+			}
+		} else {
+			break;
+		}
+	}
+
+	// Merge same height skyline segments that are next to each other.
+	for (i = 0; i < atlas->nnodes-1; i++) {
+		if (atlas->nodes[i].y == atlas->nodes[i+1].y) {
+			atlas->nodes[i].width += atlas->nodes[i+1].width;
+			glnvg__atlasRemoveNode(atlas, i+1);
+			i--;
+		}
+	}
+
+	return 1;
+}
+
+static int glnvg__atlasRectFits(GLNVGatlas* atlas, int i, int w, int h)
+{
+	// Checks if there is enough space at the location of skyline span 'i',
+	// and return the max height of all skyline spans under that at that location,
+	// (think tetris block being dropped at that position). Or -1 if no space found.
+	int x = atlas->nodes[i].x;
+	int y = atlas->nodes[i].y;
+	int spaceLeft;
+	if (x + w > atlas->width)
+		return -1;
+	spaceLeft = w;
+	while (spaceLeft > 0) {
+		if (i == atlas->nnodes) return -1;
+		y = glnvg__maxi(y, atlas->nodes[i].y);
+		if (y + h > atlas->height) return -1;
+		spaceLeft -= atlas->nodes[i].width;
+		++i;
+	}
+	return y;
+}
+
+static int glnvg__atlasAddRect(GLNVGatlas* atlas, int rw, int rh, int* rx, int* ry)
+{
+	int besth = atlas->height, bestw = atlas->width, besti = -1;
+	int bestx = -1, besty = -1, i;
+
+	// Bottom left fit heuristic.
+	for (i = 0; i < atlas->nnodes; i++) {
+		int y = glnvg__atlasRectFits(atlas, i, rw, rh);
+		if (y != -1) {
+			if (y + rh < besth || (y + rh == besth && atlas->nodes[i].width < bestw)) {
+				besti = i;
+				bestw = atlas->nodes[i].width;
+				besth = y + rh;
+				bestx = atlas->nodes[i].x;
+				besty = y;
+			}
+		}
+	}
+
+	if (besti == -1)
+		return 0;
+
+	// Perform the actual packing.
+	if (glnvg__atlasAddSkylineLevel(atlas, besti, bestx, besty, rw, rh) == 0)
+		return 0;
+
+	*rx = bestx;
+	*ry = besty;
+	atlas->allocArea += rw * rh;
+
+	return 1;
+}
+
+static GLuint glnvg__atlasCreateTexture(GLNVGcontext* gl, int w, int h)
+{
+	GLuint tex = 0;
+	glGenTextures(1, &tex);
+	glnvg__bindTexture(gl, tex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glnvg__bindTexture(gl, 0);
+	return tex;
+}
+
+static GLNVGatlas* glnvg__atlasAddPage(GLNVGcontext* gl)
+{
+	GLNVGatlas* atlas;
+	if (gl->natlases+1 > gl->catlases) {
+		GLNVGatlas* atlases;
+		int catlases = glnvg__maxi(gl->natlases+1, 4) + gl->catlases/2; // 1.5x Overallocate
+		atlases = (GLNVGatlas*)realloc(gl->atlases, sizeof(GLNVGatlas)*catlases);
+		if (atlases == NULL) return NULL;
+		gl->atlases = atlases;
+		gl->catlases = catlases;
+	}
+	atlas = &gl->atlases[gl->natlases];
+	memset(atlas, 0, sizeof(*atlas));
+	atlas->width = gl->atlasSize;
+	atlas->height = gl->atlasSize;
+	if (glnvg__atlasReset(atlas) == 0) {
+		free(atlas->nodes);
+		return NULL;
+	}
+	atlas->tex = glnvg__atlasCreateTexture(gl, atlas->width, atlas->height);
+	gl->natlases++;
+	return atlas;
+}
+
+#if NANOVG_GL_ATLAS_COMPACT
+static int glnvg__cmpTextureHeight(const void* a, const void* b)
+{
+	const GLNVGtexture* ta = *(const GLNVGtexture* const*)a;
+	const GLNVGtexture* tb = *(const GLNVGtexture* const*)b;
+	return tb->height - ta->height;
+}
+
+// Repacks the live images of an atlas page into a new texture, reclaiming the space of deleted images.
+static int glnvg__atlasCompact(GLNVGcontext* gl, int page)
 {
+	GLNVGatlas* atlas = &gl->atlases[page];
+	GLNVGatlas packed;
+	GLNVGtexture** images = NULL;
+	int* pos = NULL;
+	int i, n = 0, ret = 0;
+	GLint prevFBO = 0;
+	GLuint fbo = 0, tex = 0;
+
+	images = (GLNVGtexture**)malloc(sizeof(GLNVGtexture*) * atlas->nimages);
+	pos = (int*)malloc(sizeof(int) * 2 * atlas->nimages);
+	memset(&packed, 0, sizeof(packed));
+	packed.width = atlas->width;
+	packed.height = atlas->height;
+	if (images == NULL || pos == NULL || glnvg__atlasReset(&packed) == 0)
+		goto error;
+
+	for (i = 0; i < gl->ntextures && n < atlas->nimages; i++) {
+		if (gl->textures[i].atlas == page+1)
+			images[n++] = &gl->textures[i];
+	}
+
+	// Pack tallest first, bail out before touching the page if they do not fit.
+	qsort(images, n, sizeof(GLNVGtexture*), glnvg__cmpTextureHeight);
+	for (i = 0; i < n; i++) {
+		if (glnvg__atlasAddRect(&packed, images[i]->width, images[i]->height, &pos[i*2], &pos[i*2+1]) == 0)
+			goto error;
+	}
+
+	tex = glnvg__atlasCreateTexture(gl, atlas->width, atlas->height);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFBO);
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlas->tex, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		glDeleteTextures(1, &tex);
+		goto error;
+	}
+	glnvg__bindTexture(gl, tex);
+	for (i = 0; i < n; i++) {
+		GLNVGtexture* img = images[i];
+		glCopyTexSubImage2D(GL_TEXTURE_2D, 0, pos[i*2], pos[i*2+1], img->x, img->y, img->width, img->height);
+		img->tex = tex;
+		img->x = pos[i*2];
+		img->y = pos[i*2+1];
+	}
+	glnvg__bindTexture(gl, 0);
+
+	glDeleteTextures(1, &atlas->tex);
+	free(atlas->nodes);
+	packed.tex = tex;
+	packed.nimages = atlas->nimages;
+	packed.usedArea = atlas->usedArea;
+	*atlas = packed;
+	packed.nodes = NULL;
+	ret = 1;
+
+error:
+	if (fbo != 0) {
+		glBindFramebuffer(GL_FRAMEBUFFER, prevFBO);
+		glDeleteFramebuffers(1, &fbo);
+	}
+	free(packed.nodes);
+	free(images);
+	free(pos);
+	return ret;
+}
+#endif
+
+static int glnvg__atlasAlloc(GLNVGcontext* gl, GLNVGtexture* tex, int w, int h)
+{
+	GLNVGatlas* atlas = NULL;
 	int i;
+
+	for (i = 0; i < gl->natlases; i++) {
+		if (glnvg__atlasAddRect(&gl->atlases[i], w, h, &tex->x, &tex->y)) {
+			atlas = &gl->atlases[i];
+			break;
+		}
+	}
+
+#if NANOVG_GL_ATLAS_COMPACT
+	// Reclaim deleted images from the most fragmented page. The images move, so this
+	// can only be done when no recorded call refers to the old locations.
+	if (atlas == NULL && gl->ncalls == 0) {
+		int best = -1, bestWaste = w * h;
+		for (i = 0; i < gl->natlases; i++) {
+			int waste = gl->atlases[i].allocArea - gl->atlases[i].usedArea;
+			if (waste >= bestWaste) {
+				best = i;
+				bestWaste = waste;
+			}
+		}
+		if (best != -1 && glnvg__atlasCompact(gl, best) &&
+			glnvg__atlasAddRect(&gl->atlases[best], w, h, &tex->x, &tex->y))
+			atlas = &gl->atlases[best];
+	}
+#endif
+
+	if (atlas == NULL) {
+		atlas = glnvg__atlasAddPage(gl);
+		if (atlas == NULL || glnvg__atlasAddRect(atlas, w, h, &tex->x, &tex->y) == 0)
+			return 0;
+	}
+
+	tex->atlas = (int)(atlas - gl->atlases) + 1;
+	tex->tex = atlas->tex;
+	atlas->nimages++;
+	atlas->usedArea += w * h;
+
+	return 1;
+}
+
+static void glnvg__atlasFree(GLNVGcontext* gl, GLNVGtexture* tex)
+{
+	GLNVGatlas* atlas = &gl->atlases[tex->atlas-1];
+	atlas->nimages--;
+	atlas->usedArea -= tex->width * tex->height;
+	// The skyline can not give back single rectangles, but an empty page can be reused as a whole.
+	if (atlas->nimages == 0)
+		glnvg__atlasReset(atlas);
+}
+
+static int glnvg__deleteTexture(GLNVGcontext* gl, int id)
+{
+	int i, j;
 	for (i = 0; i < gl->ntextures; i++) {
 		if (gl->textures[i].id == id) {
-			if (gl->textures[i].tex != 0 && (gl->textures[i].flags & NVG_IMAGE_NODELETE) == 0)
+			if (gl->textures[i].atlas != 0) {
+				glnvg__atlasFree(gl, &gl->textures[i]);
+			} else if (gl->textures[i].tex != 0 && (gl->textures[i].flags & NVG_IMAGE_NODELETE) == 0) {
+				// Calls recorded with the image draw with the empty texture, like a missing image.
+				for (j = 0; j < gl->ncalls; j++) {
+					if (gl->calls[j].tex == gl->textures[i].tex)
+						gl->calls[j].tex = glnvg__paintTexture(gl, 0);
+				}
 				glDeleteTextures(1, &gl->textures[i].tex);
+			}
 			memset(&gl->textures[i], 0, sizeof(gl->textures[i]));
 			return 1;
 		}
@@ -465,6 +1014,7 @@ static int glnvg__createShader(GLNVGshader* shader, const char* name, const char
 
 	glBindAttribLocation(prog, 0, "vertex");
 	glBindAttribLocation(prog, 1, "tcoord");
+	glBindAttribLocation(prog, 2, "paint");
 
 	glLinkProgram(prog);
 	glGetProgramiv(prog, GL_LINK_STATUS, &status);
@@ -502,12 +1052,172 @@ static void glnvg__getUniforms(GLNVGshader* shader)
 #endif
 }
 
+#if NANOVG_GL_USE_RING
+// Waits until the GPU is done with the buffers of the current frame.
+static void glnvg__frameWait(GLNVGcontext* gl)
+{
+	GLNVGframe* frame = &gl->frames[gl->frame];
+	if (frame->fence == NULL) return;
+	while (glClientWaitSync(frame->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+	glDeleteSync(frame->fence);
+	frame->fence = NULL;
+}
+
+static int glnvg__ringInit(GLNVGcontext* gl, GLNVGring* ring, GLenum target, int slotSize)
+{
+	GLsizeiptr size = (GLsizeiptr)slotSize * GLNVG_FRAMES;
+
+	memset(ring, 0, sizeof(*ring));
+	ring->target = target;
+	ring->slotSize = slotSize;
+
+	glGenBuffers(1, &ring->buf);
+	glBindBuffer(target, ring->buf);
+#ifdef GL_MAP_PERSISTENT_BIT
+	if (gl->ringPersistent) {
+		glBufferStorage(target, size, NULL, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
+		ring->mem = (unsigned char*)glMapBufferRange(target, 0, size,
+			GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+	} else
+#endif
+	{
+		glBufferData(target, size, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(target, 0);
+
+#ifdef GL_MAP_PERSISTENT_BIT
+	if (gl->ringPersistent && ring->mem == NULL)
+		return 0;
+#endif
+	return 1;
+}
+
+static void glnvg__ringDelete(GLNVGring* ring)
+{
+	if (ring->buf == 0) return;
+	if (ring->mem != NULL) {
+		glBindBuffer(ring->target, ring->buf);
+		glUnmapBuffer(ring->target);
+		glBindBuffer(ring->target, 0);
+	}
+	glDeleteBuffers(1, &ring->buf);
+	memset(ring, 0, sizeof(*ring));
+}
+
+// Copies the frame's data into the current slot, pad is the room needed past the data.
+// The frame is built in the context's arrays, which also makes the copy the only write to
+// the mapping. Returns 0 if it does not fit, the ring is grown at the end of the frame.
+static int glnvg__ringUpload(GLNVGcontext* gl, GLNVGring* ring, const void* data, int size, int pad)
+{
+	GLintptr offset = (GLintptr)gl->frame * ring->slotSize;
+	unsigned char* dst;
+	int ok = 1;
+
+	if (size + pad > ring->slotSize) {
+		ring->need = glnvg__maxi(ring->need, size + pad);
+		return 0;
+	}
+	if (size == 0) return 1;
+
+	glBindBuffer(ring->target, ring->buf);
+	if (ring->mem != NULL) {
+		memcpy(ring->mem + offset, data, size);
+		glFlushMappedBufferRange(ring->target, offset, size);
+	} else {
+		// The fences guarantee that the GPU is done with the slot, no need to synchronize.
+		dst = (unsigned char*)glMapBufferRange(ring->target, offset, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (dst != NULL) {
+			memcpy(dst, data, size);
+			ok = glUnmapBuffer(ring->target) == GL_TRUE;
+		} else {
+			ok = 0;
+		}
+	}
+	glBindBuffer(ring->target, 0);
+	return ok;
+}
+
+// Recreates a ring which was too small for a frame, with room to spare.
+static int glnvg__ringGrow(GLNVGcontext* gl, GLNVGring* ring)
+{
+	GLenum target = ring->target;
+	int slotSize;
+	if (ring->need <= ring->slotSize) return 1;
+	slotSize = ring->need + ring->need/2;
+	glnvg__ringDelete(ring);
+	return glnvg__ringInit(gl, ring, target, slotSize);
+}
+
+// Frees the rings, the following frames are uploaded with buffer data.
+static void glnvg__ringShutdown(GLNVGcontext* gl)
+{
+	glnvg__ringDelete(&gl->vertRing);
+	glnvg__ringDelete(&gl->fragRing);
+}
+
+static int glnvg__hasBufferStorage(void)
+{
+	GLint major = 0, minor = 0, n = 0, i;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major > 4 || (major == 4 && minor >= 4))
+		return 1;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+	for (i = 0; i < n; i++) {
+		const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (ext != NULL && strcmp(ext, "GL_ARB_buffer_storage") == 0)
+			return 1;
+	}
+	return 0;
+}
+#endif
+
+static void glnvg__initShader(GLNVGshader* shader)
+{
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	glUniformBlockBinding(shader->prog, shader->loc[GLNVG_LOC_FRAG], GLNVG_FRAG_BINDING);
+#endif
+	glUseProgram(shader->prog);
+	glUniform1i(shader->loc[GLNVG_LOC_TEX], 0);
+	glUseProgram(0);
+}
+
+static int glnvg__createVariants(GLNVGcontext* gl, const char* header, const char* opts, const char* vshader, const char* fshader)
+{
+	// Paint type is fixed, and code for the other types and for the stroke mask is compiled out.
+	static const char* kinds[GLNVG_VARIANT_KINDS] = {
+		"#define PAINT_TYPE 2\n#define NO_STROKE_MASK 1\n",	// Simple
+		"#define PAINT_TYPE 0\n#define SOLID_PAINT 1\n",	// Solid color
+		"#define PAINT_TYPE 0\n",							// Gradient
+		"#define PAINT_TYPE 1\n",							// Image
+		"#define PAINT_TYPE 3\n#define NO_STROKE_MASK 1\n",	// Textured tris
+	};
+	char vopts[512];
+	int i;
+
+	for (i = 0; i < GLNVG_VARIANT_COUNT; i++) {
+		int kind = i / 2, scissor = i & 1;
+		// The stencil pass does not write color, scissor does not matter.
+		if (kind == GLNVG_VARIANT_SIMPLE && scissor) continue;
+		snprintf(vopts, sizeof(vopts), "%s%s%s", opts, kinds[kind], scissor ? "" : "#define NO_SCISSOR 1\n");
+		if (glnvg__createShader(&gl->variants[i], "variant", header, vopts, vshader, fshader) == 0)
+			return 0;
+		glnvg__getUniforms(&gl->variants[i]);
+		glnvg__initShader(&gl->variants[i]);
+	}
+
+	return 1;
+}
+
 static int glnvg__renderCreateTexture(void* uptr, int type, int w, int h, int imageFlags, const unsigned char* data);
+static int glnvg__renderUpdateTexture(void* uptr, int image, int x, int y, int w, int h, const unsigned char* data);
 
 static int glnvg__renderCreate(void* uptr)
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
-	int align = 4;
+	int align = 4, i;
+	char opts[256];
 
 	// TODO: mediump float may not be enough for GLES2 in iOS.
 	// see the following discussion: https://github.com/memononen/nanovg/issues/46
@@ -528,7 +1238,7 @@ static int glnvg__renderCreate(void* uptr)
 #if NANOVG_GL_USE_UNIFORMBUFFER
 	"#define USE_UNIFORMBUFFER 1\n"
 #else
-	"#define UNIFORMARRAY_SIZE 11\n"
+	"#define UNIFORMARRAY_SIZE 12\n"
 #endif
 	"\n";
 
@@ -546,9 +1256,16 @@ static int glnvg__renderCreate(void* uptr)
 		"	varying vec2 ftcoord;\n"
 		"	varying vec2 fpos;\n"
 		"#endif\n"
+		"#ifdef USE_UNIFORMBUFFER\n"
+		"	in float paint;\n"
+		"	flat out int fpaint;\n"
+		"#endif\n"
 		"void main(void) {\n"
 		"	ftcoord = tcoord;\n"
 		"	fpos = vertex;\n"
+		"#ifdef USE_UNIFORMBUFFER\n"
+		"	fpaint = int(paint);\n"
+		"#endif\n"
 		"	gl_Position = vec4(2.0*vertex.x/viewSize.x - 1.0, 1.0 - 2.0*vertex.y/viewSize.y, 0, 1);\n"
 		"}\n";
 
@@ -562,7 +1279,7 @@ static int glnvg__renderCreate(void* uptr)
 		"#endif\n"
 		"#ifdef NANOVG_GL3\n"
 		"#ifdef USE_UNIFORMBUFFER\n"
-		"	layout(std140) uniform frag {\n"
+		"	struct Frag {\n"
 		"		mat3 scissorMat;\n"
 		"		mat3 paintMat;\n"
 		"		vec4 innerCol;\n"
@@ -576,7 +1293,27 @@ static int glnvg__renderCreate(void* uptr)
 		"		float strokeThr;\n"
 		"		int texType;\n"
 		"		int type;\n"
+		"		vec4 imageClamp;\n"
+		"		vec4 padding[FRAG_PADDING];\n"
 		"	};\n"
+		"	layout(std140) uniform frag {\n"
+		"		Frag frags[FRAG_COUNT];\n"
+		"	};\n"
+		"	flat in int fpaint;\n"
+		"	#define scissorMat frags[fpaint].scissorMat\n"
+		"	#define paintMat frags[fpaint].paintMat\n"
+		"	#define innerCol frags[fpaint].innerCol\n"
+		"	#define outerCol frags[fpaint].outerCol\n"
+		"	#define scissorExt frags[fpaint].scissorExt\n"
+		"	#define scissorScale frags[fpaint].scissorScale\n"
+		"	#define extent frags[fpaint].extent\n"
+		"	#define radius frags[fpaint].radius\n"
+		"	#define feather frags[fpaint].feather\n"
+		"	#define strokeMult frags[fpaint].strokeMult\n"
+		"	#define strokeThr frags[fpaint].strokeThr\n"
+		"	#define texType frags[fpaint].texType\n"
+		"	#define type frags[fpaint].type\n"
+		"	#define imageClamp frags[fpaint].imageClamp\n"
 		"#else\n" // NANOVG_GL3 && !USE_UNIFORMBUFFER
 		"	uniform vec4 frag[UNIFORMARRAY_SIZE];\n"
 		"#endif\n"
@@ -604,6 +1341,11 @@ static int glnvg__renderCreate(void* uptr)
 		"	#define strokeThr frag[10].y\n"
 		"	#define texType int(frag[10].z)\n"
 		"	#define type int(frag[10].w)\n"
+		"	#define imageClamp frag[11]\n"
+		"#endif\n"
+		"#ifdef PAINT_TYPE\n"
+		"	#undef type\n"
+		"	#define type PAINT_TYPE\n"
 		"#endif\n"
 		"\n"
 		"float sdroundrect(vec2 pt, vec2 ext, float rad) {\n"
@@ -627,24 +1369,32 @@ static int glnvg__renderCreate(void* uptr)
 		"\n"
 		"void main(void) {\n"
 		"   vec4 result;\n"
+		"#ifdef NO_SCISSOR\n"
+		"	float scissor = 1.0;\n"
+		"#else\n"
 		"	float scissor = scissorMask(fpos);\n"
-		"#ifdef EDGE_AA\n"
+		"#endif\n"
+		"#if defined(EDGE_AA) && !defined(NO_STROKE_MASK)\n"
 		"	float strokeAlpha = strokeMask();\n"
 		"	if (strokeAlpha < strokeThr) discard;\n"
 		"#else\n"
 		"	float strokeAlpha = 1.0;\n"
 		"#endif\n"
 		"	if (type == 0) {			// Gradient\n"
+		"#ifdef SOLID_PAINT\n"
+		"		vec4 color = innerCol;\n"
+		"#else\n"
 		"		// Calculate gradient color using box gradient\n"
 		"		vec2 pt = (paintMat * vec3(fpos,1.0)).xy;\n"
 		"		float d = clamp((sdroundrect(pt, extent, radius) + feather*0.5) / feather, 0.0, 1.0);\n"
 		"		vec4 color = mix(innerCol,outerCol,d);\n"
+		"#endif\n"
 		"		// Combine alpha\n"
 		"		color *= strokeAlpha * scissor;\n"
 		"		result = color;\n"
 		"	} else if (type == 1) {		// Image\n"
 		"		// Calculate color fron texture\n"
-		"		vec2 pt = (paintMat * vec3(fpos,1.0)).xy / extent;\n"
+		"		vec2 pt = clamp((paintMat * vec3(fpos,1.0)).xy / extent, imageClamp.xy, imageClamp.zw);\n"
 		"#ifdef NANOVG_GL3\n"
 		"		vec4 color = texture(tex, pt);\n"
 		"#else\n"
@@ -667,6 +1417,8 @@ static int glnvg__renderCreate(void* uptr)
 		"#endif\n"
 		"		if (texType == 1) color = vec4(color.xyz*color.w,color.w);"
 		"		if (texType == 2) color = vec4(color.x);"
+		"		// Distance field, radius is the value at the edge and feather converts values to pixels.\n"
+		"		if (texType == 3) color = vec4(clamp((color.x - radius) * feather + 0.5, 0.0, 1.0));\n"
 		"		color *= scissor;\n"
 		"		result = color * innerCol;\n"
 		"	}\n"
@@ -679,30 +1431,92 @@ static int glnvg__renderCreate(void* uptr)
 
 	glnvg__checkError(gl, "init");
 
-	if (gl->flags & NVG_ANTIALIAS) {
-		if (glnvg__createShader(&gl->shader, "shader", shaderHeader, "#define EDGE_AA 1\n", fillVertShader, fillFragShader) == 0)
-			return 0;
-	} else {
-		if (glnvg__createShader(&gl->shader, "shader", shaderHeader, NULL, fillVertShader, fillFragShader) == 0)
-			return 0;
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+#endif
+	gl->fragSize = sizeof(GLNVGfragUniforms) + align - sizeof(GLNVGfragUniforms) % align;
+	opts[0] = '\0';
+
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	{
+		// The uniform block is an array of paints, pad the paint struct so that
+		// the std140 array stride matches the aligned offsets of the calls.
+		GLint maxBlockSize = 16384;
+		gl->fragSize = (gl->fragSize + 15) & ~15;
+		glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBlockSize);
+		gl->maxMerge = glnvg__mini(GLNVG_MAX_MERGED_PAINTS, maxBlockSize / gl->fragSize);
+		snprintf(opts, sizeof(opts), "#define FRAG_COUNT %d\n#define FRAG_PADDING %d\n",
+				 gl->maxMerge, (int)(gl->fragSize - sizeof(GLNVGfragUniforms)) / 16);
 	}
+#endif
+
+	if (gl->flags & NVG_ANTIALIAS)
+		strcat(opts, "#define EDGE_AA 1\n");
+
+	if (glnvg__createShader(&gl->shader, "shader", shaderHeader, opts, fillVertShader, fillFragShader) == 0)
+		return 0;
 
 	glnvg__checkError(gl, "uniform locations");
 	glnvg__getUniforms(&gl->shader);
+	glnvg__initShader(&gl->shader);
+
+	if (gl->flags & NVG_SHADER_VARIANTS) {
+		if (glnvg__createVariants(gl, shaderHeader, opts, fillVertShader, fillFragShader) == 0)
+			return 0;
+	}
 
-	// Create dynamic vertex array
+	// Create dynamic vertex arrays, one set per frame in flight.
+	for (i = 0; i < GLNVG_FRAMES; i++) {
+		GLNVGframe* frame = &gl->frames[i];
 #if defined NANOVG_GL3
-	glGenVertexArrays(1, &gl->vertArr);
+		glGenVertexArrays(1, &frame->vertArr);
 #endif
-	glGenBuffers(1, &gl->vertBuf);
+		glGenBuffers(1, &frame->vertBuf);
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
-	// Create UBOs
-	glUniformBlockBinding(gl->shader.prog, gl->shader.loc[GLNVG_LOC_FRAG], GLNVG_FRAG_BINDING);
-	glGenBuffers(1, &gl->fragBuf);
-	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+		// Create UBOs
+		glGenBuffers(1, &frame->fragBuf);
+		// Per vertex paint index and indices for merged calls.
+		glGenBuffers(1, &frame->paintBuf);
+		glGenBuffers(1, &frame->indexBuf);
 #endif
-	gl->fragSize = sizeof(GLNVGfragUniforms) + align - sizeof(GLNVGfragUniforms) % align;
+
+#if defined NANOVG_GL3
+		// Attribute arrays, the paint index pointer and the index buffer are vertex array state, set them once.
+		glBindVertexArray(frame->vertArr);
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
+		glBindBuffer(GL_ARRAY_BUFFER, frame->paintBuf);
+		glVertexAttribPointer(2, 1, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(unsigned short), (const GLvoid*)(size_t)0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, frame->indexBuf);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
+	}
+
+#if NANOVG_GL_USE_PBO
+	if (gl->flags & NVG_ASYNC_UPLOADS) {
+		int i;
+		for (i = 0; i < GLNVG_PBO_COUNT; i++)
+			glGenBuffers(1, &gl->pbos[i].buf);
+	}
+#endif
+
+#if NANOVG_GL_USE_RING
+	if (gl->flags & NVG_RING_BUFFERS) {
+#ifdef GL_MAP_PERSISTENT_BIT
+		gl->ringPersistent = glnvg__hasBufferStorage();
+#endif
+		if (glnvg__ringInit(gl, &gl->vertRing, GL_ARRAY_BUFFER, 65536 * sizeof(NVGvertex)) == 0)
+			return 0;
+		if (glnvg__ringInit(gl, &gl->fragRing, GL_UNIFORM_BUFFER, (1024 + gl->maxMerge) * gl->fragSize) == 0)
+			return 0;
+	}
+#endif
+
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &gl->atlasSize);
+	gl->atlasSize = glnvg__mini(GLNVG_ATLAS_SIZE, gl->atlasSize);
 
 	// Some platforms does not allow to have samples to unset textures.
 	// Create empty one which is bound when there's no texture specified.
@@ -722,6 +1536,20 @@ static int glnvg__renderCreateTexture(void* uptr, int type, int w, int h, int im
 
 	if (tex == NULL) return 0;
 
+	// Small images which are sampled like the atlas textures share them.
+	if ((gl->flags & NVG_IMAGE_ATLAS) && type == NVG_TEXTURE_RGBA &&
+		w <= GLNVG_ATLAS_MAX_IMAGE && h <= GLNVG_ATLAS_MAX_IMAGE &&
+		(imageFlags & (NVG_IMAGE_GENERATE_MIPMAPS | NVG_IMAGE_REPEATX | NVG_IMAGE_REPEATY | NVG_IMAGE_NEAREST)) == 0 &&
+		glnvg__atlasAlloc(gl, tex, w, h)) {
+		tex->width = w;
+		tex->height = h;
+		tex->type = type;
+		tex->flags = imageFlags;
+		if (data != NULL)
+			glnvg__renderUpdateTexture(gl, tex->id, 0, 0, w, h, data);
+		return tex->id;
+	}
+
 #ifdef NANOVG_GLES2
 	// Check for non-power of 2.
 	if (glnvg__nearestPow2(w) != (unsigned int)w || glnvg__nearestPow2(h) != (unsigned int)h) {
@@ -827,12 +1655,72 @@ static int glnvg__renderDeleteTexture(void* uptr, int image)
 	return glnvg__deleteTexture(gl, image);
 }
 
+#if NANOVG_GL_USE_PBO
+// Copies the rectangle to a free staging buffer and uploads the texture from it, the copy
+// to the texture happens when the GPU gets to it. Returns 0 if all staging buffers are
+// still in use, the caller then uploads directly instead of waiting.
+static int glnvg__pboUpload(GLNVGcontext* gl, GLNVGtexture* tex, int x, int y, int w, int h, const unsigned char* data)
+{
+	int bpp = tex->type == NVG_TEXTURE_RGBA ? 4 : 1;
+	int i, rowSize = w * bpp, size = rowSize * h;
+	GLNVGpbo* pbo = NULL;
+	unsigned char* dst;
+
+	for (i = 0; i < GLNVG_PBO_COUNT; i++) {
+		GLNVGpbo* p = &gl->pbos[(gl->pboIndex + i) % GLNVG_PBO_COUNT];
+		if (p->fence != NULL) {
+			if (glClientWaitSync(p->fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+				continue;
+			glDeleteSync(p->fence);
+			p->fence = NULL;
+		}
+		pbo = p;
+		gl->pboIndex = (gl->pboIndex + i + 1) % GLNVG_PBO_COUNT;
+		break;
+	}
+	if (pbo == NULL) return 0;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo->buf);
+	if (size > pbo->size) {
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+		pbo->size = size;
+	}
+	dst = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (dst == NULL) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return 0;
+	}
+	for (i = 0; i < h; i++)
+		memcpy(&dst[i * rowSize], &data[((y + i) * tex->width + x) * bpp], rowSize);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	glnvg__bindTexture(gl, tex->tex);
+	glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+	if (tex->type == NVG_TEXTURE_RGBA)
+		glTexSubImage2D(GL_TEXTURE_2D, 0, tex->x+x,tex->y+y, w,h, GL_RGBA, GL_UNSIGNED_BYTE, (const GLvoid*)0);
+	else
+		glTexSubImage2D(GL_TEXTURE_2D, 0, tex->x+x,tex->y+y, w,h, GL_RED, GL_UNSIGNED_BYTE, (const GLvoid*)0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glnvg__bindTexture(gl, 0);
+
+	pbo->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	return 1;
+}
+#endif
+
 static int glnvg__renderUpdateTexture(void* uptr, int image, int x, int y, int w, int h, const unsigned char* data)
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
 	GLNVGtexture* tex = glnvg__findTexture(gl, image);
 
 	if (tex == NULL) return 0;
+#if NANOVG_GL_USE_PBO
+	if ((gl->flags & NVG_ASYNC_UPLOADS) && glnvg__pboUpload(gl, tex, x, y, w, h, data))
+		return 1;
+#endif
 	glnvg__bindTexture(gl, tex->tex);
 
 	glPixelStorei(GL_UNPACK_ALIGNMENT,1);
@@ -852,12 +1740,12 @@ static int glnvg__renderUpdateTexture(void* uptr, int image, int x, int y, int w
 #endif
 
 	if (tex->type == NVG_TEXTURE_RGBA)
-		glTexSubImage2D(GL_TEXTURE_2D, 0, x,y, w,h, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, tex->x+x,tex->y+y, w,h, GL_RGBA, GL_UNSIGNED_BYTE, data);
 	else
 #if defined(NANOVG_GLES2) || defined(NANOVG_GL2)
-		glTexSubImage2D(GL_TEXTURE_2D, 0, x,y, w,h, GL_LUMINANCE, GL_UNSIGNED_BYTE, data);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, tex->x+x,tex->y+y, w,h, GL_LUMINANCE, GL_UNSIGNED_BYTE, data);
 #else
-		glTexSubImage2D(GL_TEXTURE_2D, 0, x,y, w,h, GL_RED, GL_UNSIGNED_BYTE, data);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, tex->x+x,tex->y+y, w,h, GL_RED, GL_UNSIGNED_BYTE, data);
 #endif
 
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
@@ -953,6 +1841,23 @@ static int glnvg__convertPaint(GLNVGcontext* gl, GLNVGfragUniforms* frag, NVGpai
 		}
 		frag->type = NSVG_SHADER_FILLIMG;
 
+		if (tex->atlas != 0) {
+			// Map the image to its rectangle in the atlas page, and keep the filtering inside it.
+			GLNVGatlas* atlas = &gl->atlases[tex->atlas-1];
+			float m[6];
+			nvgTransformScale(m, tex->width / (float)atlas->width, tex->height / (float)atlas->height);
+			m[4] = tex->x / (float)atlas->width * frag->extent[0];
+			m[5] = tex->y / (float)atlas->height * frag->extent[1];
+			nvgTransformMultiply(invxform, m);
+			frag->imageClamp[0] = (tex->x + 0.5f) / atlas->width;
+			frag->imageClamp[1] = (tex->y + 0.5f) / atlas->height;
+			frag->imageClamp[2] = (tex->x + tex->width - 0.5f) / atlas->width;
+			frag->imageClamp[3] = (tex->y + tex->height - 0.5f) / atlas->height;
+		} else {
+			frag->imageClamp[0] = frag->imageClamp[1] = -1.0e4f;
+			frag->imageClamp[2] = frag->imageClamp[3] = 1.0e4f;
+		}
+
 		#if NANOVG_GL_USE_UNIFORMBUFFER
 		if (tex->type == NVG_TEXTURE_RGBA)
 			frag->texType = (tex->flags & NVG_IMAGE_PREMULTIPLIED) ? 0 : 1;
@@ -979,24 +1884,29 @@ static int glnvg__convertPaint(GLNVGcontext* gl, GLNVGfragUniforms* frag, NVGpai
 
 static GLNVGfragUniforms* nvg__fragUniformPtr(GLNVGcontext* gl, int i);
 
-static void glnvg__setUniforms(GLNVGcontext* gl, int uniformOffset, int image)
+static void glnvg__setUniforms(GLNVGcontext* gl, int uniformOffset, GLuint tex)
 {
-	GLNVGtexture* tex = NULL;
 #if NANOVG_GL_USE_UNIFORMBUFFER
-	glBindBufferRange(GL_UNIFORM_BUFFER, GLNVG_FRAG_BINDING, gl->fragBuf, uniformOffset, sizeof(GLNVGfragUniforms));
+	int offset = gl->drawFragOffset + uniformOffset;
+#if NANOVG_GL_USE_STATE_FILTER
+	if (gl->boundFragBuf != gl->drawFragBuf || gl->boundFragOffset != offset) {
+		gl->boundFragBuf = gl->drawFragBuf;
+		gl->boundFragOffset = offset;
+		glBindBufferRange(GL_UNIFORM_BUFFER, GLNVG_FRAG_BINDING, gl->drawFragBuf, offset, gl->maxMerge * gl->fragSize);
+	}
 #else
-	GLNVGfragUniforms* frag = nvg__fragUniformPtr(gl, uniformOffset);
-	glUniform4fv(gl->shader.loc[GLNVG_LOC_FRAG], NANOVG_GL_UNIFORMARRAY_SIZE, &(frag->uniformArray[0][0]));
+	glBindBufferRange(GL_UNIFORM_BUFFER, GLNVG_FRAG_BINDING, gl->drawFragBuf, offset, gl->maxMerge * gl->fragSize);
 #endif
-
-	if (image != 0) {
-		tex = glnvg__findTexture(gl, image);
-	}
-	// If no image is set, use empty texture
-	if (tex == NULL) {
-		tex = glnvg__findTexture(gl, gl->dummyTex);
+#else
+	// Uniforms are program state, upload only if the program has other values.
+	if (gl->curShader->fragOffset != uniformOffset) {
+		GLNVGfragUniforms* frag = nvg__fragUniformPtr(gl, uniformOffset);
+		gl->curShader->fragOffset = uniformOffset;
+		glUniform4fv(gl->curShader->loc[GLNVG_LOC_FRAG], NANOVG_GL_UNIFORMARRAY_SIZE, &(frag->uniformArray[0][0]));
 	}
-	glnvg__bindTexture(gl, tex != NULL ? tex->tex : 0);
+#endif
+
+	glnvg__bindTexture(gl, tex);
 	glnvg__checkError(gl, "tex paint tex");
 }
 
@@ -1008,37 +1918,53 @@ static void glnvg__renderViewport(void* uptr, float width, float height, float d
 	gl->view[1] = height;
 }
 
+static void glnvg__useShader(GLNVGcontext* gl, int variant)
+{
+	GLNVGshader* shader = variant < 0 ? &gl->shader : &gl->variants[variant];
+	if (gl->curShader == shader) return;
+	gl->curShader = shader;
+	glUseProgram(shader->prog);
+	if (shader->view[0] != gl->view[0] || shader->view[1] != gl->view[1]) {
+		shader->view[0] = gl->view[0];
+		shader->view[1] = gl->view[1];
+		glUniform2fv(shader->loc[GLNVG_LOC_VIEWSIZE], 1, gl->view);
+	}
+}
+
 static void glnvg__fill(GLNVGcontext* gl, GLNVGcall* call)
 {
 	GLNVGpath* paths = &gl->paths[call->pathOffset];
 	int i, npaths = call->pathCount;
 
 	// Draw shapes
-	glEnable(GL_STENCIL_TEST);
+	glnvg__stencilTest(gl, 1);
 	glnvg__stencilMask(gl, 0xff);
 	glnvg__stencilFunc(gl, GL_ALWAYS, 0, 0xff);
-	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glnvg__colorMask(gl, 0);
 
 	// set bindpoint for solid loc
-	glnvg__setUniforms(gl, call->uniformOffset, 0);
+	// The stencil pass does not sample, the call's texture is bound already for the cover pass.
+	glnvg__useShader(gl, call->variant < 0 ? -1 : GLNVG_VARIANT_SIMPLE*2);
+	glnvg__setUniforms(gl, call->uniformOffset, call->tex);
 	glnvg__checkError(gl, "fill simple");
 
-	glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP);
-	glStencilOpSeparate(GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP);
-	glDisable(GL_CULL_FACE);
+	glnvg__stencilOp(gl, GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP);
+	glnvg__stencilOp(gl, GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP);
+	glnvg__cullFace(gl, 0);
 	for (i = 0; i < npaths; i++)
 		glDrawArrays(GL_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount);
-	glEnable(GL_CULL_FACE);
+	glnvg__cullFace(gl, 1);
 
 	// Draw anti-aliased pixels
-	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glnvg__colorMask(gl, 1);
 
-	glnvg__setUniforms(gl, call->uniformOffset + gl->fragSize, call->image);
+	glnvg__useShader(gl, call->variant);
+	glnvg__setUniforms(gl, call->uniformOffset + gl->fragSize, call->tex);
 	glnvg__checkError(gl, "fill fill");
 
 	if (gl->flags & NVG_ANTIALIAS) {
 		glnvg__stencilFunc(gl, GL_EQUAL, 0x00, 0xff);
-		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+		glnvg__stencilOp(gl, GL_FRONT_AND_BACK, GL_KEEP, GL_KEEP, GL_KEEP);
 		// Draw fringes
 		for (i = 0; i < npaths; i++)
 			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
@@ -1046,10 +1972,10 @@ static void glnvg__fill(GLNVGcontext* gl, GLNVGcall* call)
 
 	// Draw fill
 	glnvg__stencilFunc(gl, GL_NOTEQUAL, 0x0, 0xff);
-	glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
+	glnvg__stencilOp(gl, GL_FRONT_AND_BACK, GL_ZERO, GL_ZERO, GL_ZERO);
 	glDrawArrays(GL_TRIANGLE_STRIP, call->triangleOffset, call->triangleCount);
 
-	glDisable(GL_STENCIL_TEST);
+	// Stencil test is left on, the next call not using it turns it off.
 }
 
 static void glnvg__convexFill(GLNVGcontext* gl, GLNVGcall* call)
@@ -1057,11 +1983,16 @@ static void glnvg__convexFill(GLNVGcontext* gl, GLNVGcall* call)
 	GLNVGpath* paths = &gl->paths[call->pathOffset];
 	int i, npaths = call->pathCount;
 
-	glnvg__setUniforms(gl, call->uniformOffset, call->image);
+	glnvg__stencilTest(gl, 0);
+	glnvg__useShader(gl, call->variant);
+	glnvg__setUniforms(gl, call->uniformOffset, call->tex);
 	glnvg__checkError(gl, "convex fill");
 
+	if (call->triangleCount > 0)
+		glDrawArrays(GL_TRIANGLES, call->triangleOffset, call->triangleCount);
 	for (i = 0; i < npaths; i++) {
-		glDrawArrays(GL_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount);
+		if (paths[i].fillCount > 0)
+			glDrawArrays(GL_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount);
 		// Draw fringes
 		if (paths[i].strokeCount > 0) {
 			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
@@ -1074,41 +2005,42 @@ static void glnvg__stroke(GLNVGcontext* gl, GLNVGcall* call)
 	GLNVGpath* paths = &gl->paths[call->pathOffset];
 	int npaths = call->pathCount, i;
 
+	glnvg__useShader(gl, call->variant);
+
 	if (gl->flags & NVG_STENCIL_STROKES) {
 
-		glEnable(GL_STENCIL_TEST);
+		glnvg__stencilTest(gl, 1);
 		glnvg__stencilMask(gl, 0xff);
 
 		// Fill the stroke base without overlap
 		glnvg__stencilFunc(gl, GL_EQUAL, 0x0, 0xff);
-		glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
-		glnvg__setUniforms(gl, call->uniformOffset + gl->fragSize, call->image);
+		glnvg__stencilOp(gl, GL_FRONT_AND_BACK, GL_KEEP, GL_KEEP, GL_INCR);
+		glnvg__setUniforms(gl, call->uniformOffset + gl->fragSize, call->tex);
 		glnvg__checkError(gl, "stroke fill 0");
 		for (i = 0; i < npaths; i++)
 			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
 
 		// Draw anti-aliased pixels.
-		glnvg__setUniforms(gl, call->uniformOffset, call->image);
+		glnvg__setUniforms(gl, call->uniformOffset, call->tex);
 		glnvg__stencilFunc(gl, GL_EQUAL, 0x00, 0xff);
-		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+		glnvg__stencilOp(gl, GL_FRONT_AND_BACK, GL_KEEP, GL_KEEP, GL_KEEP);
 		for (i = 0; i < npaths; i++)
 			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
 
 		// Clear stencil buffer.
-		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glnvg__colorMask(gl, 0);
 		glnvg__stencilFunc(gl, GL_ALWAYS, 0x0, 0xff);
-		glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
+		glnvg__stencilOp(gl, GL_FRONT_AND_BACK, GL_ZERO, GL_ZERO, GL_ZERO);
 		glnvg__checkError(gl, "stroke fill 1");
 		for (i = 0; i < npaths; i++)
 			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
-		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-
-		glDisable(GL_STENCIL_TEST);
+		glnvg__colorMask(gl, 1);
 
 //		glnvg__convertPaint(gl, nvg__fragUniformPtr(gl, call->uniformOffset + gl->fragSize), paint, scissor, strokeWidth, fringe, 1.0f - 0.5f/255.0f);
 
 	} else {
-		glnvg__setUniforms(gl, call->uniformOffset, call->image);
+		glnvg__stencilTest(gl, 0);
+		glnvg__setUniforms(gl, call->uniformOffset, call->tex);
 		glnvg__checkError(gl, "stroke fill");
 		// Draw Strokes
 		for (i = 0; i < npaths; i++)
@@ -1118,18 +2050,35 @@ static void glnvg__stroke(GLNVGcontext* gl, GLNVGcall* call)
 
 static void glnvg__triangles(GLNVGcontext* gl, GLNVGcall* call)
 {
-	glnvg__setUniforms(gl, call->uniformOffset, call->image);
+	glnvg__stencilTest(gl, 0);
+	glnvg__useShader(gl, call->variant);
+	glnvg__setUniforms(gl, call->uniformOffset, call->tex);
 	glnvg__checkError(gl, "triangles fill");
 
 	glDrawArrays(GL_TRIANGLES, call->triangleOffset, call->triangleCount);
 }
 
+#if NANOVG_GL_USE_UNIFORMBUFFER
+static void glnvg__merged(GLNVGcontext* gl, GLNVGcall* call)
+{
+	glnvg__stencilTest(gl, 0);
+	glnvg__useShader(gl, call->variant);
+	glnvg__setUniforms(gl, call->uniformOffset, call->tex);
+	glnvg__checkError(gl, "merged fill");
+
+	glDrawElements(GL_TRIANGLES, call->indexCount, GL_UNSIGNED_INT, (const GLvoid*)(call->indexOffset * sizeof(GLuint)));
+}
+#endif
+
 static void glnvg__renderCancel(void* uptr) {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
 	gl->nverts = 0;
 	gl->npaths = 0;
 	gl->ncalls = 0;
 	gl->nuniforms = 0;
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	gl->nindices = 0;
+#endif
 }
 
 static GLenum glnvg_convertBlendFuncFactor(int factor)
@@ -1176,15 +2125,170 @@ static GLNVGblend glnvg__blendCompositeOperation(NVGcompositeOperationState op)
 	return blend;
 }
 
+#if NANOVG_GL_USE_UNIFORMBUFFER
+static int glnvg__allocIndices(GLNVGcontext* gl, int n)
+{
+	int ret = 0;
+	if (gl->nindices+n > gl->cindices) {
+		GLuint* indices;
+		int cindices = glnvg__maxi(gl->nindices + n, 4096) + gl->cindices/2; // 1.5x Overallocate
+		indices = (GLuint*)realloc(gl->indices, sizeof(GLuint) * cindices);
+		if (indices == NULL) return -1;
+		gl->indices = indices;
+		gl->cindices = cindices;
+	}
+	ret = gl->nindices;
+	gl->nindices += n;
+	return ret;
+}
+
+static int glnvg__mergeable(GLNVGcontext* gl, GLNVGcall* call)
+{
+	if (call->type == GLNVG_CONVEXFILL || call->type == GLNVG_TRIANGLES)
+		return 1;
+	if (call->type == GLNVG_STROKE && (gl->flags & NVG_STENCIL_STROKES) == 0)
+		return 1;
+	return 0;
+}
+
+static int glnvg__canMerge(GLNVGcontext* gl, GLNVGcall* first, GLNVGcall* call)
+{
+	return glnvg__mergeable(gl, call) &&
+		// Also true for images packed in the same atlas page.
+		call->tex == first->tex &&
+		call->blendFunc.srcRGB == first->blendFunc.srcRGB &&
+		call->blendFunc.dstRGB == first->blendFunc.dstRGB &&
+		call->blendFunc.srcAlpha == first->blendFunc.srcAlpha &&
+		call->blendFunc.dstAlpha == first->blendFunc.dstAlpha &&
+		call->uniformOffset - first->uniformOffset < gl->maxMerge * gl->fragSize;
+}
+
+static int glnvg__triangleIndexCount(GLNVGcontext* gl, GLNVGcall* call)
+{
+	GLNVGpath* paths = &gl->paths[call->pathOffset];
+	int i, count = 0;
+	if (call->type == GLNVG_TRIANGLES)
+		return call->triangleCount;
+	if (call->type == GLNVG_CONVEXFILL)
+		count += call->triangleCount;
+	for (i = 0; i < call->pathCount; i++) {
+		if (call->type == GLNVG_CONVEXFILL && paths[i].fillCount > 2)
+			count += (paths[i].fillCount - 2) * 3;
+		if (paths[i].strokeCount > 2)
+			count += (paths[i].strokeCount - 2) * 3;
+	}
+	return count;
+}
+
+static GLuint* glnvg__fanIndices(GLuint* dst, int offset, int count)
+{
+	int i;
+	for (i = 0; i < count-2; i++) {
+		*dst++ = offset;
+		*dst++ = offset+i+1;
+		*dst++ = offset+i+2;
+	}
+	return dst;
+}
+
+static GLuint* glnvg__stripIndices(GLuint* dst, int offset, int count)
+{
+	int i;
+	// Keep the winding of the triangles in the strip.
+	for (i = 0; i < count-2; i++) {
+		*dst++ = offset+i+(i&1);
+		*dst++ = offset+i+1-(i&1);
+		*dst++ = offset+i+2;
+	}
+	return dst;
+}
+
+// Coalesces runs of consecutive calls which are drawn without stencil and which share the
+// blend function and image into one indexed triangle draw. Each vertex gets the index of
+// its call's paint in the uniform block, relative to the first call of the run.
+static void glnvg__mergeCalls(GLNVGcontext* gl)
+{
+	int i, j, k;
+
+	gl->nindices = 0;
+
+	for (i = 0; i < gl->ncalls; i = j) {
+		GLNVGcall* first = &gl->calls[i];
+		int nindices = 0, offset;
+		GLuint* dst;
+
+		for (k = first->vertexOffset; k < first->vertexOffset + first->vertexCount; k++)
+			gl->vertPaints[k] = 0;
+		first->mergeCount = 1;
+
+		j = i+1;
+		if (!glnvg__mergeable(gl, first))
+			continue;
+		while (j < gl->ncalls && glnvg__canMerge(gl, first, &gl->calls[j]))
+			j++;
+		if (j - i < 2)
+			continue;
+
+		for (k = i; k < j; k++)
+			nindices += glnvg__triangleIndexCount(gl, &gl->calls[k]);
+		offset = glnvg__allocIndices(gl, nindices);
+		if (offset == -1) {
+			j = i+1;
+			continue;
+		}
+
+		first->mergeCount = j - i;
+		glnvg__recordStat(mergedCalls, j - i - 1);
+		first->indexOffset = offset;
+		first->indexCount = nindices;
+		// Runs mixing paint types are drawn with the generic shader.
+		for (k = i+1; k < j; k++) {
+			if (gl->calls[k].variant != first->variant)
+				first->variant = -1;
+		}
+
+		dst = &gl->indices[offset];
+		for (k = i; k < j; k++) {
+			GLNVGcall* call = &gl->calls[k];
+			GLNVGpath* paths = &gl->paths[call->pathOffset];
+			unsigned short paint = (unsigned short)((call->uniformOffset - first->uniformOffset) / gl->fragSize);
+			int v, p;
+			for (v = call->vertexOffset; v < call->vertexOffset + call->vertexCount; v++)
+				gl->vertPaints[v] = paint;
+			if (call->type == GLNVG_TRIANGLES || call->type == GLNVG_CONVEXFILL) {
+				for (v = 0; v < call->triangleCount; v++)
+					*dst++ = call->triangleOffset + v;
+			}
+			if (call->type != GLNVG_TRIANGLES) {
+				for (p = 0; p < call->pathCount; p++) {
+					if (call->type == GLNVG_CONVEXFILL && paths[p].fillCount > 2)
+						dst = glnvg__fanIndices(dst, paths[p].fillOffset, paths[p].fillCount);
+					if (paths[p].strokeCount > 2)
+						dst = glnvg__stripIndices(dst, paths[p].strokeOffset, paths[p].strokeCount);
+				}
+			}
+		}
+	}
+}
+#endif
+
 static void glnvg__renderFlush(void* uptr)
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
+	GLNVGframe* frame = &gl->frames[gl->frame];
+	size_t vertOffset = 0;
+	GLuint vertBuf;
 	int i;
 
 	if (gl->ncalls > 0) {
+#if NANOVG_GL_USE_RING
+		// Do not respecify buffers the GPU may still read, the driver would stall or copy.
+		glnvg__frameWait(gl);
+#endif
 
 		// Setup require GL state.
-		glUseProgram(gl->shader.prog);
+		gl->curShader = NULL;
+		glnvg__useShader(gl, -1);
 
 		glEnable(GL_CULL_FACE);
 		glCullFace(GL_BACK);
@@ -1193,51 +2297,109 @@ static void glnvg__renderFlush(void* uptr)
 		glDisable(GL_DEPTH_TEST);
 		glDisable(GL_SCISSOR_TEST);
 		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-		glStencilMask(0xffffffff);
-		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-		glStencilFunc(GL_ALWAYS, 0, 0xffffffff);
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, 0);
 		#if NANOVG_GL_USE_STATE_FILTER
-		gl->boundTexture = 0;
+		// Stencil state and the texture are always set before use, mark them unknown instead of resetting.
+		gl->boundTexture = 0xffffffff;
 		gl->stencilMask = 0xffffffff;
-		gl->stencilFunc = GL_ALWAYS;
+		gl->stencilFunc = GL_INVALID_ENUM;
 		gl->stencilFuncRef = 0;
 		gl->stencilFuncMask = 0xffffffff;
+		for (i = 0; i < 3; i++)
+			gl->stencilOp[0][i] = gl->stencilOp[1][i] = GL_INVALID_ENUM;
+		gl->stencilTest = 0;
+		gl->cullFace = 1;
+		gl->colorMask = 1;
 		gl->blendFunc.srcRGB = GL_INVALID_ENUM;
 		gl->blendFunc.srcAlpha = GL_INVALID_ENUM;
 		gl->blendFunc.dstRGB = GL_INVALID_ENUM;
 		gl->blendFunc.dstAlpha = GL_INVALID_ENUM;
+#if NANOVG_GL_USE_UNIFORMBUFFER
+		gl->boundFragBuf = 0;
+		gl->boundFragOffset = -1;
+#endif
+		#else
+		glStencilMask(0xffffffff);
+		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+		glStencilFunc(GL_ALWAYS, 0, 0xffffffff);
+		glBindTexture(GL_TEXTURE_2D, 0);
 		#endif
+#if !NANOVG_GL_USE_UNIFORMBUFFER
+		gl->shader.fragOffset = -1;
+		for (i = 0; i < GLNVG_VARIANT_COUNT; i++)
+			gl->variants[i].fragOffset = -1;
+#endif
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
-		// Upload ubo for frag shaders
-		glBindBuffer(GL_UNIFORM_BUFFER, gl->fragBuf);
-		glBufferData(GL_UNIFORM_BUFFER, gl->nuniforms * gl->fragSize, gl->uniforms, GL_STREAM_DRAW);
+		glnvg__mergeCalls(gl);
+
+		gl->drawFragBuf = frame->fragBuf;
+		gl->drawFragOffset = 0;
+#if NANOVG_GL_USE_RING
+		if (gl->fragRing.buf != 0 &&
+			glnvg__ringUpload(gl, &gl->fragRing, gl->uniforms, gl->nuniforms * gl->fragSize, gl->maxMerge * gl->fragSize)) {
+			gl->drawFragBuf = gl->fragRing.buf;
+			gl->drawFragOffset = gl->frame * gl->fragRing.slotSize;
+		} else
+#endif
+		{
+			// Upload ubo for frag shaders, the buffer is padded so that a full block can be bound at any call.
+			glBindBuffer(GL_UNIFORM_BUFFER, frame->fragBuf);
+			glBufferData(GL_UNIFORM_BUFFER, (gl->nuniforms + gl->maxMerge) * gl->fragSize, NULL, GL_STREAM_DRAW);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, gl->nuniforms * gl->fragSize, gl->uniforms);
+		}
 #endif
 
 		// Upload vertex data
 #if defined NANOVG_GL3
-		glBindVertexArray(gl->vertArr);
+		glBindVertexArray(frame->vertArr);
+#endif
+		vertBuf = frame->vertBuf;
+#if NANOVG_GL_USE_RING
+		if (gl->vertRing.buf != 0 && glnvg__ringUpload(gl, &gl->vertRing, gl->verts, gl->nverts * sizeof(NVGvertex), 0)) {
+			vertBuf = gl->vertRing.buf;
+			vertOffset = gl->frame * gl->vertRing.slotSize;
+		} else
 #endif
-		glBindBuffer(GL_ARRAY_BUFFER, gl->vertBuf);
-		glBufferData(GL_ARRAY_BUFFER, gl->nverts * sizeof(NVGvertex), gl->verts, GL_STREAM_DRAW);
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, frame->vertBuf);
+			glBufferData(GL_ARRAY_BUFFER, gl->nverts * sizeof(NVGvertex), gl->verts, GL_STREAM_DRAW);
+		}
+#if defined NANOVG_GL3
+		// The vertex array keeps the attribute setup, repoint it only when the vertices moved.
+		if (frame->vertArrBuf != vertBuf || frame->vertArrOffset != vertOffset) {
+			frame->vertArrBuf = vertBuf;
+			frame->vertArrOffset = vertOffset;
+			glBindBuffer(GL_ARRAY_BUFFER, vertBuf);
+			glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)vertOffset);
+			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(vertOffset + 2*sizeof(float)));
+		}
+#else
+		glBindBuffer(GL_ARRAY_BUFFER, vertBuf);
 		glEnableVertexAttribArray(0);
 		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(size_t)0);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(0 + 2*sizeof(float)));
-
-		// Set view and texture just once per frame.
-		glUniform1i(gl->shader.loc[GLNVG_LOC_TEX], 0);
-		glUniform2fv(gl->shader.loc[GLNVG_LOC_VIEWSIZE], 1, gl->view);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)vertOffset);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(vertOffset + 2*sizeof(float)));
+#endif
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
-		glBindBuffer(GL_UNIFORM_BUFFER, gl->fragBuf);
+		// Paint index attribute and index buffer binding are set up with the vertex array.
+		glBindBuffer(GL_ARRAY_BUFFER, frame->paintBuf);
+		glBufferData(GL_ARRAY_BUFFER, gl->nverts * sizeof(unsigned short), gl->vertPaints, GL_STREAM_DRAW);
+		if (gl->nindices > 0)
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, gl->nindices * sizeof(GLuint), gl->indices, GL_STREAM_DRAW);
 #endif
 
 		for (i = 0; i < gl->ncalls; i++) {
 			GLNVGcall* call = &gl->calls[i];
 			glnvg__blendFuncSeparate(gl,&call->blendFunc);
+#if NANOVG_GL_USE_UNIFORMBUFFER
+			if (call->mergeCount > 1) {
+				glnvg__merged(gl, call);
+				i += call->mergeCount-1;
+				continue;
+			}
+#endif
 			if (call->type == GLNVG_FILL)
 				glnvg__fill(gl, call);
 			else if (call->type == GLNVG_CONVEXFILL)
@@ -1248,15 +2410,30 @@ static void glnvg__renderFlush(void* uptr)
 				glnvg__triangles(gl, call);
 		}
 
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
 #if defined NANOVG_GL3
 		glBindVertexArray(0);
+#else
+		glDisableVertexAttribArray(0);
+		glDisableVertexAttribArray(1);
 #endif
-		glDisable(GL_CULL_FACE);
+		glnvg__stencilTest(gl, 0);
+		glnvg__cullFace(gl, 0);
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glUseProgram(0);
+		gl->curShader = NULL;
 		glnvg__bindTexture(gl, 0);
+
+#if NANOVG_GL_USE_RING
+		// Fence the frame and move on to the next set of buffers.
+		frame->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+		gl->frame = (gl->frame + 1) % GLNVG_FRAMES;
+#if NANOVG_GL_USE_RING
+		if (gl->vertRing.buf != 0 && (glnvg__ringGrow(gl, &gl->vertRing) == 0 || glnvg__ringGrow(gl, &gl->fragRing) == 0)) {
+			glnvg__checkError(gl, "ring buffers");
+			glnvg__ringShutdown(gl);
+		}
+#endif
 	}
 
 	// Reset calls
@@ -1264,6 +2441,9 @@ static void glnvg__renderFlush(void* uptr)
 	gl->npaths = 0;
 	gl->ncalls = 0;
 	gl->nuniforms = 0;
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	gl->nindices = 0;
+#endif
 }
 
 static int glnvg__maxVertCount(const NVGpath* paths, int npaths)
@@ -1314,6 +2494,14 @@ static int glnvg__allocVerts(GLNVGcontext* gl, int n)
 	if (gl->nverts+n > gl->cverts) {
 		NVGvertex* verts;
 		int cverts = glnvg__maxi(gl->nverts + n, 4096) + gl->cverts/2; // 1.5x Overallocate
+#if NANOVG_GL_USE_UNIFORMBUFFER
+		{
+			unsigned short* vertPaints = (unsigned short*)realloc(gl->vertPaints, sizeof(unsigned short) * cverts);
+			if (vertPaints == NULL) return -1;
+			gl->vertPaints = vertPaints;
+		}
+#endif
+		// Grown last, so that the vertices, also the reserved ones past nverts, stay where they are on failure.
 		verts = (NVGvertex*)realloc(gl->verts, sizeof(NVGvertex) * cverts);
 		if (verts == NULL) return -1;
 		gl->verts = verts;
@@ -1353,6 +2541,43 @@ static void glnvg__vset(NVGvertex* vtx, float x, float y, float u, float v)
 	vtx->v = v;
 }
 
+// Returns true if the vertices were written by the expander to the space handed out by renderReserveVerts.
+static int glnvg__vertsInPlace(GLNVGcontext* gl, const NVGvertex* verts)
+{
+	return gl->verts != NULL && verts == &gl->verts[gl->nverts];
+}
+
+// Copies vertices the expander wrote elsewhere, which is what writing in place avoids.
+static void glnvg__copyVerts(GLNVGcontext* gl, int offset, const NVGvertex* verts, int nverts)
+{
+	memcpy(&gl->verts[offset], verts, sizeof(NVGvertex) * nverts);
+	glnvg__recordStat(vertexCopyBytes, (long long)sizeof(NVGvertex) * nverts);
+}
+
+static NVGvertex* glnvg__renderReserveVerts(void* uptr, int nverts)
+{
+	GLNVGcontext* gl = (GLNVGcontext*)uptr;
+	// Make room at the end of the vertex buffer, the next render call takes what it uses.
+	if (glnvg__allocVerts(gl, nverts) == -1) return NULL;
+	gl->nverts -= nverts;
+	return &gl->verts[gl->nverts];
+}
+
+// Picks the specialized shader for a paint, or -1 to draw with the generic shader.
+static int glnvg__paintVariant(GLNVGcontext* gl, int kind, NVGpaint* paint, NVGscissor* scissor)
+{
+	int scissored = scissor->extent[0] >= -0.5f && scissor->extent[1] >= -0.5f;
+	if ((gl->flags & NVG_SHADER_VARIANTS) == 0)
+		return -1;
+	if (kind == GLNVG_VARIANT_FILLGRAD) {
+		if (paint->image != 0)
+			kind = GLNVG_VARIANT_FILLIMG;
+		else if (memcmp(&paint->innerColor, &paint->outerColor, sizeof(NVGcolor)) == 0)
+			kind = GLNVG_VARIANT_SOLID;
+	}
+	return kind*2 + scissored;
+}
+
 static void glnvg__renderFill(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, float fringe,
 							  const float* bounds, const NVGpath* paths, int npaths)
 {
@@ -1360,19 +2585,22 @@ static void glnvg__renderFill(void* uptr, NVGpaint* paint, NVGcompositeOperation
 	GLNVGcall* call = glnvg__allocCall(gl);
 	NVGvertex* quad;
 	GLNVGfragUniforms* frag;
-	int i, maxverts, offset;
+	int i, maxverts, offset, inplace;
 
 	if (call == NULL) return;
 
+	inplace = npaths > 0 && glnvg__vertsInPlace(gl, paths[0].nfill > 0 ? paths[0].fill : paths[0].stroke);
+
 	call->type = GLNVG_FILL;
 	call->triangleCount = 4;
 	call->pathOffset = glnvg__allocPaths(gl, npaths);
 	if (call->pathOffset == -1) goto error;
 	call->pathCount = npaths;
-	call->image = paint->image;
+	call->tex = glnvg__paintTexture(gl, paint->image);
+	call->variant = glnvg__paintVariant(gl, GLNVG_VARIANT_FILLGRAD, paint, scissor);
 	call->blendFunc = glnvg__blendCompositeOperation(compositeOperation);
 
-	if (npaths == 1 && paths[0].convex)
+	if (npaths == 1 && (paths[0].convex || paths[0].triangulated))
 	{
 		call->type = GLNVG_CONVEXFILL;
 		call->triangleCount = 0;	// Bounding box fill quad not needed for convex fill
@@ -1382,21 +2610,32 @@ static void glnvg__renderFill(void* uptr, NVGpaint* paint, NVGcompositeOperation
 	maxverts = glnvg__maxVertCount(paths, npaths) + call->triangleCount;
 	offset = glnvg__allocVerts(gl, maxverts);
 	if (offset == -1) goto error;
+	call->vertexOffset = offset;
+	call->vertexCount = maxverts;
 
 	for (i = 0; i < npaths; i++) {
 		GLNVGpath* copy = &gl->paths[call->pathOffset + i];
 		const NVGpath* path = &paths[i];
 		memset(copy, 0, sizeof(GLNVGpath));
-		if (path->nfill > 0) {
+		if (path->nfill > 0 && path->triangulated) {
+			// Triangulated fill is drawn as a list.
+			call->triangleOffset = offset;
+			call->triangleCount = path->nfill;
+			if (!inplace)
+				glnvg__copyVerts(gl, offset, path->fill, path->nfill);
+			offset += path->nfill;
+		} else if (path->nfill > 0) {
 			copy->fillOffset = offset;
 			copy->fillCount = path->nfill;
-			memcpy(&gl->verts[offset], path->fill, sizeof(NVGvertex) * path->nfill);
+			if (!inplace)
+				glnvg__copyVerts(gl, offset, path->fill, path->nfill);
 			offset += path->nfill;
 		}
 		if (path->nstroke > 0) {
 			copy->strokeOffset = offset;
 			copy->strokeCount = path->nstroke;
-			memcpy(&gl->verts[offset], path->stroke, sizeof(NVGvertex) * path->nstroke);
+			if (!inplace)
+				glnvg__copyVerts(gl, offset, path->stroke, path->nstroke);
 			offset += path->nstroke;
 		}
 	}
@@ -1440,21 +2679,26 @@ static void glnvg__renderStroke(void* uptr, NVGpaint* paint, NVGcompositeOperati
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
 	GLNVGcall* call = glnvg__allocCall(gl);
-	int i, maxverts, offset;
+	int i, maxverts, offset, inplace;
 
 	if (call == NULL) return;
 
+	inplace = npaths > 0 && glnvg__vertsInPlace(gl, paths[0].stroke);
+
 	call->type = GLNVG_STROKE;
 	call->pathOffset = glnvg__allocPaths(gl, npaths);
 	if (call->pathOffset == -1) goto error;
 	call->pathCount = npaths;
-	call->image = paint->image;
+	call->tex = glnvg__paintTexture(gl, paint->image);
+	call->variant = glnvg__paintVariant(gl, GLNVG_VARIANT_FILLGRAD, paint, scissor);
 	call->blendFunc = glnvg__blendCompositeOperation(compositeOperation);
 
 	// Allocate vertices for all the paths.
 	maxverts = glnvg__maxVertCount(paths, npaths);
 	offset = glnvg__allocVerts(gl, maxverts);
 	if (offset == -1) goto error;
+	call->vertexOffset = offset;
+	call->vertexCount = maxverts;
 
 	for (i = 0; i < npaths; i++) {
 		GLNVGpath* copy = &gl->paths[call->pathOffset + i];
@@ -1463,7 +2707,8 @@ static void glnvg__renderStroke(void* uptr, NVGpaint* paint, NVGcompositeOperati
 		if (path->nstroke) {
 			copy->strokeOffset = offset;
 			copy->strokeCount = path->nstroke;
-			memcpy(&gl->verts[offset], path->stroke, sizeof(NVGvertex) * path->nstroke);
+			if (!inplace)
+				glnvg__copyVerts(gl, offset, path->stroke, path->nstroke);
 			offset += path->nstroke;
 		}
 	}
@@ -1497,19 +2742,26 @@ static void glnvg__renderTriangles(void* uptr, NVGpaint* paint, NVGcompositeOper
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
 	GLNVGcall* call = glnvg__allocCall(gl);
 	GLNVGfragUniforms* frag;
+	int inplace;
 
 	if (call == NULL) return;
 
+	inplace = glnvg__vertsInPlace(gl, verts);
+
 	call->type = GLNVG_TRIANGLES;
-	call->image = paint->image;
+	call->tex = glnvg__paintTexture(gl, paint->image);
+	call->variant = glnvg__paintVariant(gl, GLNVG_VARIANT_IMG, paint, scissor);
 	call->blendFunc = glnvg__blendCompositeOperation(compositeOperation);
 
 	// Allocate vertices for all the paths.
 	call->triangleOffset = glnvg__allocVerts(gl, nverts);
 	if (call->triangleOffset == -1) goto error;
 	call->triangleCount = nverts;
+	call->vertexOffset = call->triangleOffset;
+	call->vertexCount = nverts;
 
-	memcpy(&gl->verts[call->triangleOffset], verts, sizeof(NVGvertex) * nverts);
+	if (!inplace)
+		glnvg__copyVerts(gl, call->triangleOffset, verts, nverts);
 
 	// Fill shader
 	call->uniformOffset = glnvg__allocFragUniforms(gl, 1);
@@ -1526,6 +2778,23 @@ error:
 	if (gl->ncalls > 0) gl->ncalls--;
 }
 
+static void glnvg__renderTrianglesSDF(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor,
+									  const NVGvertex* verts, int nverts, float fringe, float edge, float scale)
+{
+	GLNVGcontext* gl = (GLNVGcontext*)uptr;
+	GLNVGfragUniforms* frag;
+	int ncalls = gl->ncalls;
+
+	glnvg__renderTriangles(uptr, paint, compositeOperation, scissor, verts, nverts, fringe);
+	if (gl->ncalls == ncalls) return;
+
+	// Threshold the texture instead of using it as coverage.
+	frag = nvg__fragUniformPtr(gl, gl->calls[gl->ncalls-1].uniformOffset);
+	frag->texType = 3;
+	frag->radius = edge;
+	frag->feather = scale;
+}
+
 static void glnvg__renderDelete(void* uptr)
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
@@ -1533,28 +2802,65 @@ static void glnvg__renderDelete(void* uptr)
 	if (gl == NULL) return;
 
 	glnvg__deleteShader(&gl->shader);
+	for (i = 0; i < GLNVG_VARIANT_COUNT; i++)
+		glnvg__deleteShader(&gl->variants[i]);
 
+	for (i = 0; i < GLNVG_FRAMES; i++) {
+		GLNVGframe* frame = &gl->frames[i];
 #if NANOVG_GL3
 #if NANOVG_GL_USE_UNIFORMBUFFER
-	if (gl->fragBuf != 0)
-		glDeleteBuffers(1, &gl->fragBuf);
+		if (frame->fragBuf != 0)
+			glDeleteBuffers(1, &frame->fragBuf);
+		if (frame->paintBuf != 0)
+			glDeleteBuffers(1, &frame->paintBuf);
+		if (frame->indexBuf != 0)
+			glDeleteBuffers(1, &frame->indexBuf);
+#endif
+		if (frame->vertArr != 0)
+			glDeleteVertexArrays(1, &frame->vertArr);
 #endif
-	if (gl->vertArr != 0)
-		glDeleteVertexArrays(1, &gl->vertArr);
+		if (frame->vertBuf != 0)
+			glDeleteBuffers(1, &frame->vertBuf);
+#if NANOVG_GL_USE_RING
+		if (frame->fence != NULL)
+			glDeleteSync(frame->fence);
 #endif
-	if (gl->vertBuf != 0)
-		glDeleteBuffers(1, &gl->vertBuf);
+	}
 
 	for (i = 0; i < gl->ntextures; i++) {
-		if (gl->textures[i].tex != 0 && (gl->textures[i].flags & NVG_IMAGE_NODELETE) == 0)
+		if (gl->textures[i].tex != 0 && gl->textures[i].atlas == 0 && (gl->textures[i].flags & NVG_IMAGE_NODELETE) == 0)
 			glDeleteTextures(1, &gl->textures[i].tex);
 	}
 	free(gl->textures);
 
+	for (i = 0; i < gl->natlases; i++) {
+		if (gl->atlases[i].tex != 0)
+			glDeleteTextures(1, &gl->atlases[i].tex);
+		free(gl->atlases[i].nodes);
+	}
+	free(gl->atlases);
+
+#if NANOVG_GL_USE_RING
+	glnvg__ringShutdown(gl);
+#endif
+
+#if NANOVG_GL_USE_PBO
+	for (i = 0; i < GLNVG_PBO_COUNT; i++) {
+		if (gl->pbos[i].fence != NULL)
+			glDeleteSync(gl->pbos[i].fence);
+		if (gl->pbos[i].buf != 0)
+			glDeleteBuffers(1, &gl->pbos[i].buf);
+	}
+#endif
+
 	free(gl->paths);
 	free(gl->verts);
 	free(gl->uniforms);
 	free(gl->calls);
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	free(gl->vertPaints);
+	free(gl->indices);
+#endif
 
 	free(gl);
 }
@@ -1588,9 +2894,12 @@ NVGcontext* nvgCreateGLES3(int flags)
 	params.renderFill = glnvg__renderFill;
 	params.renderStroke = glnvg__renderStroke;
 	params.renderTriangles = glnvg__renderTriangles;
+	params.renderTrianglesSDF = glnvg__renderTrianglesSDF;
+	params.renderReserveVerts = glnvg__renderReserveVerts;
 	params.renderDelete = glnvg__renderDelete;
 	params.userPtr = gl;
 	params.edgeAntiAlias = flags & NVG_ANTIALIAS ? 1 : 0;
+	params.triangulateFills = flags & NVG_TRIANGULATE_FILLS ? 1 : 0;
 
 	gl->flags = flags;
 
@@ -0,0 +1,945 @@
+//
+// Copyright (c) 2009-2013 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+#ifndef NANOVG_GL_RECORD_H
+#define NANOVG_GL_RECORD_H
+
+// Recording GL function table for the GL3 back-end.
+//
+// Defining NANOVG_GL_RECORD before including nanovg_gl.h with NANOVG_GL3_IMPLEMENTATION
+// routes every GL call of the back-end through counting wrappers. By default the wrappers
+// are stubs which emulate just enough of a GL driver (object names, buffer storage, mapping,
+// compile status) for the back-end to run without a GPU or a GL library. Defining
+// NANOVG_GL_RECORD_FORWARD as well makes the wrappers call the real GL functions.
+//
+// The GL headers still need to be included before nanovg_gl.h for the types and enums.
+//
+// Typical use is to reset the counters before a frame and write the report after it:
+//	nvgglRecordReset();
+//	nvgBeginFrame(vg, w, h, 1.0f); ... nvgEndFrame(vg);
+//	nvgglRecordReport(buf, sizeof(buf), "birds");
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct NVGglStats {
+	int drawCalls;			// glDrawArrays and glDrawElements.
+	int drawVertices;		// Vertices or indices drawn.
+	int stateChanges;		// Calls changing pipeline, binding or pixel store state.
+	int programChanges;		// glUseProgram.
+	int textureBinds;		// glBindTexture.
+	int bufferBinds;		// glBindBuffer and glBindBufferRange.
+	int uniformUploads;		// glUniform* and uniform block range binds.
+	int bufferUploads;		// Buffer data, sub data, write mappings and explicit flushes.
+	int textureUploads;		// glTexImage2D with data, glTexSubImage2D and copies.
+	int syncs;				// Fences created and waited on.
+	long long bufferBytes;	// Bytes uploaded to or mapped for writing in buffers, or flushed.
+	long long textureBytes;	// Bytes uploaded to textures.
+	// Counted by the back-end itself rather than by the GL wrappers.
+	int mergedCalls;		// Calls folded into the draw of a previous call by the merge pass.
+	long long vertexCopyBytes;	// Vertex bytes copied into the back-end, rather than written in place.
+};
+typedef struct NVGglStats NVGglStats;
+
+// Clears the counters.
+void nvgglRecordReset(void);
+
+// Returns the counters accumulated since the last reset.
+void nvgglRecordStats(NVGglStats* stats);
+
+// Writes the counters as a JSON object into dst, keys are always in the same order.
+// Returns the length of the report, or the length needed if size is too small.
+int nvgglRecordReport(char* dst, int size, const char* name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NANOVG_GL_RECORD_H
+
+#ifdef NANOVG_GL_RECORD_IMPLEMENTATION
+
+static NVGglStats glnvgrec__stats;
+
+void nvgglRecordReset(void)
+{
+	memset(&glnvgrec__stats, 0, sizeof(glnvgrec__stats));
+}
+
+void nvgglRecordStats(NVGglStats* stats)
+{
+	*stats = glnvgrec__stats;
+}
+
+int nvgglRecordReport(char* dst, int size, const char* name)
+{
+	const NVGglStats* s = &glnvgrec__stats;
+	return snprintf(dst, size,
+		"{\"name\": \"%s\", \"drawCalls\": %d, \"drawVertices\": %d, \"stateChanges\": %d, "
+		"\"programChanges\": %d, \"textureBinds\": %d, \"bufferBinds\": %d, \"uniformUploads\": %d, "
+		"\"bufferUploads\": %d, \"bufferBytes\": %lld, \"textureUploads\": %d, \"textureBytes\": %lld, "
+		"\"syncs\": %d, \"mergedCalls\": %d, \"copiedBytes\": %lld}",
+		name != NULL ? name : "", s->drawCalls, s->drawVertices, s->stateChanges,
+		s->programChanges, s->textureBinds, s->bufferBinds, s->uniformUploads,
+		s->bufferUploads, s->bufferBytes, s->textureUploads, s->textureBytes,
+		s->syncs, s->mergedCalls, s->vertexCopyBytes);
+}
+
+static int glnvgrec__pixelSize(GLenum format)
+{
+	return format == GL_RGBA ? 4 : 1;
+}
+
+#ifdef NANOVG_GL_RECORD_FORWARD
+#	define GLNVGREC_FORWARD(call) call
+#else
+#	define GLNVGREC_FORWARD(call)
+
+// Minimal driver state needed by the back-end when no GL is present.
+struct GLNVGrecBuffer {
+	unsigned char* data;
+	GLsizeiptr size;
+};
+typedef struct GLNVGrecBuffer GLNVGrecBuffer;
+
+struct GLNVGrecBinding {
+	GLenum target;
+	GLuint buf;
+};
+typedef struct GLNVGrecBinding GLNVGrecBinding;
+
+static GLuint glnvgrec__names = 0;
+static GLNVGrecBuffer* glnvgrec__buffers = NULL;
+static int glnvgrec__nbuffers = 0;
+static GLNVGrecBinding glnvgrec__bindings[8];
+static int glnvgrec__nbindings = 0;
+
+static GLuint glnvgrec__genName(void)
+{
+	return ++glnvgrec__names;
+}
+
+static GLNVGrecBuffer* glnvgrec__boundBuffer(GLenum target)
+{
+	int i;
+	for (i = 0; i < glnvgrec__nbindings; i++) {
+		if (glnvgrec__bindings[i].target == target) {
+			GLuint buf = glnvgrec__bindings[i].buf;
+			return buf != 0 && (int)buf <= glnvgrec__nbuffers ? &glnvgrec__buffers[buf-1] : NULL;
+		}
+	}
+	return NULL;
+}
+
+static void glnvgrec__setBinding(GLenum target, GLuint buf)
+{
+	int i;
+	for (i = 0; i < glnvgrec__nbindings; i++) {
+		if (glnvgrec__bindings[i].target == target) {
+			glnvgrec__bindings[i].buf = buf;
+			return;
+		}
+	}
+	if (glnvgrec__nbindings < (int)(sizeof(glnvgrec__bindings) / sizeof(glnvgrec__bindings[0]))) {
+		glnvgrec__bindings[glnvgrec__nbindings].target = target;
+		glnvgrec__bindings[glnvgrec__nbindings].buf = buf;
+		glnvgrec__nbindings++;
+	}
+}
+
+static void glnvgrec__allocStorage(GLenum target, GLsizeiptr size, const void* data)
+{
+	GLNVGrecBuffer* b = glnvgrec__boundBuffer(target);
+	unsigned char* mem;
+	if (b == NULL) return;
+	if (size > b->size) {
+		mem = (unsigned char*)realloc(b->data, size);
+		if (mem == NULL) return;
+		b->data = mem;
+	}
+	b->size = size;
+	if (data != NULL)
+		memcpy(b->data, data, size);
+}
+#endif
+
+// Objects
+
+static void glnvgrec__GenBuffers(GLsizei n, GLuint* buffers)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glGenBuffers(n, buffers);
+#else
+	GLsizei i;
+	for (i = 0; i < n; i++) {
+		GLuint buf = glnvgrec__genName();
+		if ((int)buf > glnvgrec__nbuffers) {
+			GLNVGrecBuffer* bufs = (GLNVGrecBuffer*)realloc(glnvgrec__buffers, sizeof(GLNVGrecBuffer) * buf);
+			if (bufs == NULL) {
+				buffers[i] = 0;
+				continue;
+			}
+			memset(&bufs[glnvgrec__nbuffers], 0, sizeof(GLNVGrecBuffer) * (buf - glnvgrec__nbuffers));
+			glnvgrec__buffers = bufs;
+			glnvgrec__nbuffers = (int)buf;
+		}
+		buffers[i] = buf;
+	}
+#endif
+}
+
+static void glnvgrec__DeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glDeleteBuffers(n, buffers);
+#else
+	GLsizei i;
+	for (i = 0; i < n; i++) {
+		if (buffers[i] != 0 && (int)buffers[i] <= glnvgrec__nbuffers) {
+			free(glnvgrec__buffers[buffers[i]-1].data);
+			glnvgrec__buffers[buffers[i]-1].data = NULL;
+			glnvgrec__buffers[buffers[i]-1].size = 0;
+		}
+	}
+#endif
+}
+
+static void glnvgrec__GenTextures(GLsizei n, GLuint* textures)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glGenTextures(n, textures);
+#else
+	GLsizei i;
+	for (i = 0; i < n; i++)
+		textures[i] = glnvgrec__genName();
+#endif
+}
+
+static void glnvgrec__DeleteTextures(GLsizei n, const GLuint* textures)
+{
+	NVG_NOTUSED(n);
+	NVG_NOTUSED(textures);
+	GLNVGREC_FORWARD(glDeleteTextures(n, textures));
+}
+
+static void glnvgrec__GenVertexArrays(GLsizei n, GLuint* arrays)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glGenVertexArrays(n, arrays);
+#else
+	GLsizei i;
+	for (i = 0; i < n; i++)
+		arrays[i] = glnvgrec__genName();
+#endif
+}
+
+static void glnvgrec__DeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+	NVG_NOTUSED(n);
+	NVG_NOTUSED(arrays);
+	GLNVGREC_FORWARD(glDeleteVertexArrays(n, arrays));
+}
+
+static void glnvgrec__GenFramebuffers(GLsizei n, GLuint* framebuffers)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glGenFramebuffers(n, framebuffers);
+#else
+	GLsizei i;
+	for (i = 0; i < n; i++)
+		framebuffers[i] = glnvgrec__genName();
+#endif
+}
+
+static void glnvgrec__DeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+{
+	NVG_NOTUSED(n);
+	NVG_NOTUSED(framebuffers);
+	GLNVGREC_FORWARD(glDeleteFramebuffers(n, framebuffers));
+}
+
+// Shaders
+
+static GLuint glnvgrec__CreateProgram(void)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	return glCreateProgram();
+#else
+	return glnvgrec__genName();
+#endif
+}
+
+static GLuint glnvgrec__CreateShader(GLenum type)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	return glCreateShader(type);
+#else
+	NVG_NOTUSED(type);
+	return glnvgrec__genName();
+#endif
+}
+
+static void glnvgrec__DeleteProgram(GLuint program)
+{
+	NVG_NOTUSED(program);
+	GLNVGREC_FORWARD(glDeleteProgram(program));
+}
+
+static void glnvgrec__DeleteShader(GLuint shader)
+{
+	NVG_NOTUSED(shader);
+	GLNVGREC_FORWARD(glDeleteShader(shader));
+}
+
+static void glnvgrec__ShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+{
+	NVG_NOTUSED(shader);
+	NVG_NOTUSED(count);
+	NVG_NOTUSED(string);
+	NVG_NOTUSED(length);
+	GLNVGREC_FORWARD(glShaderSource(shader, count, string, length));
+}
+
+static void glnvgrec__CompileShader(GLuint shader)
+{
+	NVG_NOTUSED(shader);
+	GLNVGREC_FORWARD(glCompileShader(shader));
+}
+
+static void glnvgrec__AttachShader(GLuint program, GLuint shader)
+{
+	NVG_NOTUSED(program);
+	NVG_NOTUSED(shader);
+	GLNVGREC_FORWARD(glAttachShader(program, shader));
+}
+
+static void glnvgrec__BindAttribLocation(GLuint program, GLuint index, const GLchar* name)
+{
+	NVG_NOTUSED(program);
+	NVG_NOTUSED(index);
+	NVG_NOTUSED(name);
+	GLNVGREC_FORWARD(glBindAttribLocation(program, index, name));
+}
+
+static void glnvgrec__LinkProgram(GLuint program)
+{
+	NVG_NOTUSED(program);
+	GLNVGREC_FORWARD(glLinkProgram(program));
+}
+
+static void glnvgrec__GetShaderiv(GLuint shader, GLenum pname, GLint* params)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glGetShaderiv(shader, pname, params);
+#else
+	NVG_NOTUSED(shader);
+	*params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+#endif
+}
+
+static void glnvgrec__GetProgramiv(GLuint program, GLenum pname, GLint* params)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glGetProgramiv(program, pname, params);
+#else
+	NVG_NOTUSED(program);
+	*params = pname == GL_LINK_STATUS ? GL_TRUE : 0;
+#endif
+}
+
+static void glnvgrec__GetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glGetShaderInfoLog(shader, bufSize, length, infoLog);
+#else
+	NVG_NOTUSED(shader);
+	if (length != NULL) *length = 0;
+	if (bufSize > 0) infoLog[0] = '\0';
+#endif
+}
+
+static void glnvgrec__GetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glGetProgramInfoLog(program, bufSize, length, infoLog);
+#else
+	NVG_NOTUSED(program);
+	if (length != NULL) *length = 0;
+	if (bufSize > 0) infoLog[0] = '\0';
+#endif
+}
+
+static GLint glnvgrec__GetUniformLocation(GLuint program, const GLchar* name)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	return glGetUniformLocation(program, name);
+#else
+	NVG_NOTUSED(program);
+	NVG_NOTUSED(name);
+	return 0;
+#endif
+}
+
+static GLuint glnvgrec__GetUniformBlockIndex(GLuint program, const GLchar* name)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	return glGetUniformBlockIndex(program, name);
+#else
+	NVG_NOTUSED(program);
+	NVG_NOTUSED(name);
+	return 0;
+#endif
+}
+
+static void glnvgrec__UniformBlockBinding(GLuint program, GLuint index, GLuint binding)
+{
+	NVG_NOTUSED(program);
+	NVG_NOTUSED(index);
+	NVG_NOTUSED(binding);
+	GLNVGREC_FORWARD(glUniformBlockBinding(program, index, binding));
+}
+
+static void glnvgrec__UseProgram(GLuint program)
+{
+	NVG_NOTUSED(program);
+	glnvgrec__stats.stateChanges++;
+	glnvgrec__stats.programChanges++;
+	GLNVGREC_FORWARD(glUseProgram(program));
+}
+
+static void glnvgrec__Uniform1i(GLint location, GLint v0)
+{
+	NVG_NOTUSED(location);
+	NVG_NOTUSED(v0);
+	glnvgrec__stats.uniformUploads++;
+	GLNVGREC_FORWARD(glUniform1i(location, v0));
+}
+
+static void glnvgrec__Uniform2fv(GLint location, GLsizei count, const GLfloat* value)
+{
+	NVG_NOTUSED(location);
+	NVG_NOTUSED(count);
+	NVG_NOTUSED(value);
+	glnvgrec__stats.uniformUploads++;
+	GLNVGREC_FORWARD(glUniform2fv(location, count, value));
+}
+
+// Queries
+
+static GLenum glnvgrec__GetError(void)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	return glGetError();
+#else
+	return GL_NO_ERROR;
+#endif
+}
+
+static void glnvgrec__GetIntegerv(GLenum pname, GLint* data)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glGetIntegerv(pname, data);
+#else
+	// Report a plain GL 3.3 implementation so that the recorded calls do not depend on the machine.
+	switch (pname) {
+	case GL_MAJOR_VERSION: *data = 3; break;
+	case GL_MINOR_VERSION: *data = 3; break;
+	case GL_MAX_TEXTURE_SIZE: *data = 16384; break;
+	case GL_MAX_UNIFORM_BLOCK_SIZE: *data = 65536; break;
+	case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: *data = 256; break;
+	default: *data = 0; break;
+	}
+#endif
+}
+
+static const GLubyte* glnvgrec__GetStringi(GLenum name, GLuint index)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	return glGetStringi(name, index);
+#else
+	NVG_NOTUSED(name);
+	NVG_NOTUSED(index);
+	return (const GLubyte*)"";
+#endif
+}
+
+static void glnvgrec__Finish(void)
+{
+	GLNVGREC_FORWARD(glFinish());
+}
+
+// Pipeline state
+
+static void glnvgrec__Enable(GLenum cap)
+{
+	NVG_NOTUSED(cap);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glEnable(cap));
+}
+
+static void glnvgrec__Disable(GLenum cap)
+{
+	NVG_NOTUSED(cap);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glDisable(cap));
+}
+
+static void glnvgrec__CullFace(GLenum mode)
+{
+	NVG_NOTUSED(mode);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glCullFace(mode));
+}
+
+static void glnvgrec__FrontFace(GLenum mode)
+{
+	NVG_NOTUSED(mode);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glFrontFace(mode));
+}
+
+static void glnvgrec__ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+	NVG_NOTUSED(red);
+	NVG_NOTUSED(green);
+	NVG_NOTUSED(blue);
+	NVG_NOTUSED(alpha);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glColorMask(red, green, blue, alpha));
+}
+
+static void glnvgrec__BlendFuncSeparate(GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha)
+{
+	NVG_NOTUSED(sfactorRGB);
+	NVG_NOTUSED(dfactorRGB);
+	NVG_NOTUSED(sfactorAlpha);
+	NVG_NOTUSED(dfactorAlpha);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glBlendFuncSeparate(sfactorRGB, dfactorRGB, sfactorAlpha, dfactorAlpha));
+}
+
+static void glnvgrec__StencilMask(GLuint mask)
+{
+	NVG_NOTUSED(mask);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glStencilMask(mask));
+}
+
+static void glnvgrec__StencilFunc(GLenum func, GLint ref, GLuint mask)
+{
+	NVG_NOTUSED(func);
+	NVG_NOTUSED(ref);
+	NVG_NOTUSED(mask);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glStencilFunc(func, ref, mask));
+}
+
+static void glnvgrec__StencilOp(GLenum fail, GLenum zfail, GLenum zpass)
+{
+	NVG_NOTUSED(fail);
+	NVG_NOTUSED(zfail);
+	NVG_NOTUSED(zpass);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glStencilOp(fail, zfail, zpass));
+}
+
+static void glnvgrec__StencilOpSeparate(GLenum face, GLenum sfail, GLenum dpfail, GLenum dppass)
+{
+	NVG_NOTUSED(face);
+	NVG_NOTUSED(sfail);
+	NVG_NOTUSED(dpfail);
+	NVG_NOTUSED(dppass);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glStencilOpSeparate(face, sfail, dpfail, dppass));
+}
+
+static void glnvgrec__PixelStorei(GLenum pname, GLint param)
+{
+	NVG_NOTUSED(pname);
+	NVG_NOTUSED(param);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glPixelStorei(pname, param));
+}
+
+// Vertex input
+
+static void glnvgrec__BindVertexArray(GLuint array)
+{
+	NVG_NOTUSED(array);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glBindVertexArray(array));
+}
+
+static void glnvgrec__EnableVertexAttribArray(GLuint index)
+{
+	NVG_NOTUSED(index);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glEnableVertexAttribArray(index));
+}
+
+static void glnvgrec__VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+	NVG_NOTUSED(index);
+	NVG_NOTUSED(size);
+	NVG_NOTUSED(type);
+	NVG_NOTUSED(normalized);
+	NVG_NOTUSED(stride);
+	NVG_NOTUSED(pointer);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glVertexAttribPointer(index, size, type, normalized, stride, pointer));
+}
+
+// Buffers
+
+static void glnvgrec__BindBuffer(GLenum target, GLuint buffer)
+{
+	glnvgrec__stats.stateChanges++;
+	glnvgrec__stats.bufferBinds++;
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glBindBuffer(target, buffer);
+#else
+	glnvgrec__setBinding(target, buffer);
+#endif
+}
+
+static void glnvgrec__BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	glnvgrec__stats.stateChanges++;
+	glnvgrec__stats.bufferBinds++;
+	if (target == GL_UNIFORM_BUFFER)
+		glnvgrec__stats.uniformUploads++;
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glBindBufferRange(target, index, buffer, offset, size);
+#else
+	NVG_NOTUSED(index);
+	NVG_NOTUSED(offset);
+	NVG_NOTUSED(size);
+	glnvgrec__setBinding(target, buffer);
+#endif
+}
+
+static void glnvgrec__BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+	if (data != NULL) {
+		glnvgrec__stats.bufferUploads++;
+		glnvgrec__stats.bufferBytes += size;
+	}
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glBufferData(target, size, data, usage);
+#else
+	NVG_NOTUSED(usage);
+	glnvgrec__allocStorage(target, size, data);
+#endif
+}
+
+static void glnvgrec__BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	glnvgrec__stats.bufferUploads++;
+	glnvgrec__stats.bufferBytes += size;
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glBufferSubData(target, offset, size, data);
+#else
+	{
+		GLNVGrecBuffer* b = glnvgrec__boundBuffer(target);
+		if (b != NULL && offset + size <= b->size)
+			memcpy(b->data + offset, data, size);
+	}
+#endif
+}
+
+#ifdef GL_MAP_PERSISTENT_BIT
+static void glnvgrec__BufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glBufferStorage(target, size, data, flags);
+#else
+	NVG_NOTUSED(flags);
+	glnvgrec__allocStorage(target, size, data);
+#endif
+}
+#endif
+
+static void* glnvgrec__MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	// With explicit flushes only the flushed ranges are uploaded.
+	if ((access & GL_MAP_WRITE_BIT) && (access & GL_MAP_FLUSH_EXPLICIT_BIT) == 0) {
+		glnvgrec__stats.bufferUploads++;
+		glnvgrec__stats.bufferBytes += length;
+	}
+#ifdef NANOVG_GL_RECORD_FORWARD
+	return glMapBufferRange(target, offset, length, access);
+#else
+	{
+		GLNVGrecBuffer* b = glnvgrec__boundBuffer(target);
+		if (b == NULL || offset + length > b->size) return NULL;
+		return b->data + offset;
+	}
+#endif
+}
+
+static void glnvgrec__FlushMappedBufferRange(GLenum target, GLintptr offset, GLsizeiptr length)
+{
+	glnvgrec__stats.bufferUploads++;
+	glnvgrec__stats.bufferBytes += length;
+#ifdef NANOVG_GL_RECORD_FORWARD
+	glFlushMappedBufferRange(target, offset, length);
+#else
+	NVG_NOTUSED(target);
+	NVG_NOTUSED(offset);
+#endif
+}
+
+static GLboolean glnvgrec__UnmapBuffer(GLenum target)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	return glUnmapBuffer(target);
+#else
+	NVG_NOTUSED(target);
+	return GL_TRUE;
+#endif
+}
+
+// Textures
+
+static void glnvgrec__ActiveTexture(GLenum texture)
+{
+	NVG_NOTUSED(texture);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glActiveTexture(texture));
+}
+
+static void glnvgrec__BindTexture(GLenum target, GLuint texture)
+{
+	NVG_NOTUSED(target);
+	NVG_NOTUSED(texture);
+	glnvgrec__stats.stateChanges++;
+	glnvgrec__stats.textureBinds++;
+	GLNVGREC_FORWARD(glBindTexture(target, texture));
+}
+
+static void glnvgrec__TexParameteri(GLenum target, GLenum pname, GLint param)
+{
+	NVG_NOTUSED(target);
+	NVG_NOTUSED(pname);
+	NVG_NOTUSED(param);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glTexParameteri(target, pname, param));
+}
+
+static void glnvgrec__TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+	NVG_NOTUSED(target);
+	NVG_NOTUSED(level);
+	NVG_NOTUSED(internalformat);
+	NVG_NOTUSED(border);
+	NVG_NOTUSED(type);
+	if (pixels != NULL) {
+		glnvgrec__stats.textureUploads++;
+		glnvgrec__stats.textureBytes += (long long)width * height * glnvgrec__pixelSize(format);
+	}
+	GLNVGREC_FORWARD(glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels));
+}
+
+static void glnvgrec__TexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+	NVG_NOTUSED(target);
+	NVG_NOTUSED(level);
+	NVG_NOTUSED(xoffset);
+	NVG_NOTUSED(yoffset);
+	NVG_NOTUSED(type);
+	NVG_NOTUSED(pixels);
+	glnvgrec__stats.textureUploads++;
+	glnvgrec__stats.textureBytes += (long long)width * height * glnvgrec__pixelSize(format);
+	GLNVGREC_FORWARD(glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels));
+}
+
+static void glnvgrec__CopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	NVG_NOTUSED(target);
+	NVG_NOTUSED(level);
+	NVG_NOTUSED(xoffset);
+	NVG_NOTUSED(yoffset);
+	NVG_NOTUSED(x);
+	NVG_NOTUSED(y);
+	glnvgrec__stats.textureUploads++;
+	glnvgrec__stats.textureBytes += (long long)width * height * 4;
+	GLNVGREC_FORWARD(glCopyTexSubImage2D(target, level, xoffset, yoffset, x, y, width, height));
+}
+
+static void glnvgrec__GenerateMipmap(GLenum target)
+{
+	NVG_NOTUSED(target);
+	GLNVGREC_FORWARD(glGenerateMipmap(target));
+}
+
+// Framebuffers
+
+static void glnvgrec__BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	NVG_NOTUSED(target);
+	NVG_NOTUSED(framebuffer);
+	glnvgrec__stats.stateChanges++;
+	GLNVGREC_FORWARD(glBindFramebuffer(target, framebuffer));
+}
+
+static void glnvgrec__FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
+{
+	NVG_NOTUSED(target);
+	NVG_NOTUSED(attachment);
+	NVG_NOTUSED(textarget);
+	NVG_NOTUSED(texture);
+	NVG_NOTUSED(level);
+	GLNVGREC_FORWARD(glFramebufferTexture2D(target, attachment, textarget, texture, level));
+}
+
+static GLenum glnvgrec__CheckFramebufferStatus(GLenum target)
+{
+#ifdef NANOVG_GL_RECORD_FORWARD
+	return glCheckFramebufferStatus(target);
+#else
+	NVG_NOTUSED(target);
+	return GL_FRAMEBUFFER_COMPLETE;
+#endif
+}
+
+// Drawing
+
+static void glnvgrec__DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	NVG_NOTUSED(mode);
+	NVG_NOTUSED(first);
+	glnvgrec__stats.drawCalls++;
+	glnvgrec__stats.drawVertices += count;
+	GLNVGREC_FORWARD(glDrawArrays(mode, first, count));
+}
+
+static void glnvgrec__DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+	NVG_NOTUSED(mode);
+	NVG_NOTUSED(type);
+	NVG_NOTUSED(indices);
+	glnvgrec__stats.drawCalls++;
+	glnvgrec__stats.drawVertices += count;
+	GLNVGREC_FORWARD(glDrawElements(mode, count, type, indices));
+}
+
+// Sync
+
+static GLsync glnvgrec__FenceSync(GLenum condition, GLbitfield flags)
+{
+	glnvgrec__stats.syncs++;
+#ifdef NANOVG_GL_RECORD_FORWARD
+	return glFenceSync(condition, flags);
+#else
+	NVG_NOTUSED(condition);
+	NVG_NOTUSED(flags);
+	return (GLsync)(size_t)glnvgrec__genName();
+#endif
+}
+
+static GLenum glnvgrec__ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+	glnvgrec__stats.syncs++;
+#ifdef NANOVG_GL_RECORD_FORWARD
+	return glClientWaitSync(sync, flags, timeout);
+#else
+	NVG_NOTUSED(sync);
+	NVG_NOTUSED(flags);
+	NVG_NOTUSED(timeout);
+	return GL_ALREADY_SIGNALED;
+#endif
+}
+
+static void glnvgrec__DeleteSync(GLsync sync)
+{
+	NVG_NOTUSED(sync);
+	GLNVGREC_FORWARD(glDeleteSync(sync));
+}
+
+#define glGenBuffers glnvgrec__GenBuffers
+#define glDeleteBuffers glnvgrec__DeleteBuffers
+#define glGenTextures glnvgrec__GenTextures
+#define glDeleteTextures glnvgrec__DeleteTextures
+#define glGenVertexArrays glnvgrec__GenVertexArrays
+#define glDeleteVertexArrays glnvgrec__DeleteVertexArrays
+#define glGenFramebuffers glnvgrec__GenFramebuffers
+#define glDeleteFramebuffers glnvgrec__DeleteFramebuffers
+#define glCreateProgram glnvgrec__CreateProgram
+#define glCreateShader glnvgrec__CreateShader
+#define glDeleteProgram glnvgrec__DeleteProgram
+#define glDeleteShader glnvgrec__DeleteShader
+#define glShaderSource glnvgrec__ShaderSource
+#define glCompileShader glnvgrec__CompileShader
+#define glAttachShader glnvgrec__AttachShader
+#define glBindAttribLocation glnvgrec__BindAttribLocation
+#define glLinkProgram glnvgrec__LinkProgram
+#define glGetShaderiv glnvgrec__GetShaderiv
+#define glGetProgramiv glnvgrec__GetProgramiv
+#define glGetShaderInfoLog glnvgrec__GetShaderInfoLog
+#define glGetProgramInfoLog glnvgrec__GetProgramInfoLog
+#define glGetUniformLocation glnvgrec__GetUniformLocation
+#define glGetUniformBlockIndex glnvgrec__GetUniformBlockIndex
+#define glUniformBlockBinding glnvgrec__UniformBlockBinding
+#define glUseProgram glnvgrec__UseProgram
+#define glUniform1i glnvgrec__Uniform1i
+#define glUniform2fv glnvgrec__Uniform2fv
+#define glGetError glnvgrec__GetError
+#define glGetIntegerv glnvgrec__GetIntegerv
+#define glGetStringi glnvgrec__GetStringi
+#define glFinish glnvgrec__Finish
+#define glEnable glnvgrec__Enable
+#define glDisable glnvgrec__Disable
+#define glCullFace glnvgrec__CullFace
+#define glFrontFace glnvgrec__FrontFace
+#define glColorMask glnvgrec__ColorMask
+#define glBlendFuncSeparate glnvgrec__BlendFuncSeparate
+#define glStencilMask glnvgrec__StencilMask
+#define glStencilFunc glnvgrec__StencilFunc
+#define glStencilOp glnvgrec__StencilOp
+#define glStencilOpSeparate glnvgrec__StencilOpSeparate
+#define glPixelStorei glnvgrec__PixelStorei
+#define glBindVertexArray glnvgrec__BindVertexArray
+#define glEnableVertexAttribArray glnvgrec__EnableVertexAttribArray
+#define glVertexAttribPointer glnvgrec__VertexAttribPointer
+#define glBindBuffer glnvgrec__BindBuffer
+#define glBindBufferRange glnvgrec__BindBufferRange
+#define glBufferData glnvgrec__BufferData
+#define glBufferSubData glnvgrec__BufferSubData
+#ifdef GL_MAP_PERSISTENT_BIT
+#define glBufferStorage glnvgrec__BufferStorage
+#endif
+#define glMapBufferRange glnvgrec__MapBufferRange
+#define glFlushMappedBufferRange glnvgrec__FlushMappedBufferRange
+#define glUnmapBuffer glnvgrec__UnmapBuffer
+#define glActiveTexture glnvgrec__ActiveTexture
+#define glBindTexture glnvgrec__BindTexture
+#define glTexParameteri glnvgrec__TexParameteri
+#define glTexImage2D glnvgrec__TexImage2D
+#define glTexSubImage2D glnvgrec__TexSubImage2D
+#define glCopyTexSubImage2D glnvgrec__CopyTexSubImage2D
+#define glGenerateMipmap glnvgrec__GenerateMipmap
+#define glBindFramebuffer glnvgrec__BindFramebuffer
+#define glFramebufferTexture2D glnvgrec__FramebufferTexture2D
+#define glCheckFramebufferStatus glnvgrec__CheckFramebufferStatus
+#define glDrawArrays glnvgrec__DrawArrays
+#define glDrawElements glnvgrec__DrawElements
+#define glFenceSync glnvgrec__FenceSync
+#define glClientWaitSync glnvgrec__ClientWaitSync
+#define glDeleteSync glnvgrec__DeleteSync
+
+#endif // NANOVG_GL_RECORD_IMPLEMENTATION